@@ -16,6 +16,8 @@
  */
 
 #include "arrow.h"
+#include "diagramscene.h"
+#include "edgelayer.h"
 #include "marriageitem.h"
 
 #include <math.h>
@@ -32,7 +34,8 @@ static int mDefaultLineWidth = 2;
 
 //! [0]
 Arrow::Arrow(DiagramItem *startItem, DiagramItem *endItem, QGraphicsItem *parent)
-    : QGraphicsLineItem(parent)
+    : QGraphicsLineItem(parent),
+      m_hidden(false)
 {
     myStartItem = startItem;
     myEndItem = endItem;
@@ -40,6 +43,7 @@ Arrow::Arrow(DiagramItem *startItem, DiagramItem *endItem, QGraphicsItem *parent
     myColor = Qt::black;
     int lineWidth = getDefaultLineWidth();
     setPen(QPen(myColor, lineWidth, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    updateShape();
 }
 //! [0]
 
@@ -58,10 +62,7 @@ QRectF Arrow::boundingRect() const
 //! [2]
 QPainterPath Arrow::shape() const
 {
-    // Get the original path.
-    QPainterPath path = QGraphicsLineItem::shape();
-    path.addPolygon(arrowHead);
-    return path;
+    return m_shape;
 
     // TEST: The code below makes the line click arrow wider,
     // but does not detect clicks on the arrowhead.
@@ -90,6 +91,13 @@ QColor Arrow::getColor() const
     return myColor;
 }
 
+void Arrow::setColor(const QColor &color)
+{
+    myColor = color;
+    update();
+    updateEdgeLayer();
+}
+
 //static QPainterPath pathScaled(QPainterPath path, double scale) {
 //    // Get translation coordinates.
 //    auto translateX = path.boundingRect().center().x();
@@ -112,13 +120,58 @@ QColor Arrow::getColor() const
 
 void Arrow::updatePosition()
 {
-    QGraphicsItem *startItem = myStartItem;
+    m_hidden = myStartItem->collidesWithItem(myEndItem);
+
+    QPointF startPos = myStartItem->pos();
     if (myStartItem->isMarried()) {
-        startItem = myStartItem->getMarriageItem();
+        startPos = myStartItem->getMarriageItemPos();
     }
 
-    QLineF line(mapFromItem(startItem, 0, 0), mapFromItem(myEndItem, 0, 0));
-    setLine(line);
+    // End the line where it enters the end person.
+    QLineF centerLine(startPos, myEndItem->pos());
+    QPolygonF endPolygon = myEndItem->polygon();
+    QPointF p1 = endPolygon.first() + myEndItem->pos();
+    QPointF p2;
+    QPointF intersectPoint = myEndItem->pos();
+    QPointF point;
+    QLineF polyLine;
+    for (int i = 1; i < endPolygon.count(); ++i) {
+        p2 = endPolygon.at(i) + myEndItem->pos();
+        polyLine = QLineF(p1, p2);
+        QLineF::IntersectType intersectType =
+            polyLine.intersect(centerLine, &point);
+        if (intersectType == QLineF::BoundedIntersection) {
+            intersectPoint = point;
+            break;
+        }
+        p1 = p2;
+    }
+
+    QLineF newLine(intersectPoint, startPos);
+    if (newLine != line()) {
+        setLine(newLine);
+    }
+
+    // Point the arrowhead along the line.
+    qreal arrowSize = 20;
+    arrowHead.clear();
+
+    if (newLine.length() > 0) {
+        double angle = ::acos(newLine.dx() / newLine.length());
+        if (newLine.dy() >= 0)
+            angle = (Pi * 2) - angle;
+
+        QPointF arrowP1 = newLine.p1() + QPointF(sin(angle + Pi / 3) * arrowSize,
+                                        cos(angle + Pi / 3) * arrowSize);
+        QPointF arrowP2 = newLine.p1() + QPointF(sin(angle + Pi - Pi / 3) * arrowSize,
+                                        cos(angle + Pi - Pi / 3) * arrowSize);
+
+        arrowHead << newLine.p1() << arrowP1 << arrowP2;
+    }
+
+    updateShape();
+    update();
+    updateEdgeLayer();
 }
 
 void Arrow::setLineWidth(int width)
@@ -126,6 +179,8 @@ void Arrow::setLineWidth(int width)
     QPen myPen = pen();
     myPen.setWidth(width);
     setPen(myPen);
+    updateShape();
+    updateEdgeLayer();
 }
 
 int Arrow::getDefaultLineWidth()
@@ -141,50 +196,15 @@ void Arrow::setDefaultLineWidth(int width)
 void Arrow::paint(QPainter *painter, const QStyleOptionGraphicsItem *,
           QWidget *)
 {
-    if (myStartItem->collidesWithItem(myEndItem))
+    // The geometry is worked out in updatePosition(), so only draw here.
+    if (m_hidden)
         return;
 
     QPen myPen = pen();
     myPen.setColor(myColor);
-    qreal arrowSize = 20;
     painter->setPen(myPen);
     painter->setBrush(myColor);
 
-    QPointF startPos = myStartItem->pos();
-    if (myStartItem->isMarried()) {
-        startPos = myStartItem->getMarriageItemPos();
-    }
-
-    QLineF centerLine(startPos, myEndItem->pos());
-    QPolygonF endPolygon = myEndItem->polygon();
-    QPointF p1 = endPolygon.first() + myEndItem->pos();
-    QPointF p2;
-    QPointF intersectPoint;
-    QLineF polyLine;
-    for (int i = 1; i < endPolygon.count(); ++i) {
-        p2 = endPolygon.at(i) + myEndItem->pos();
-        polyLine = QLineF(p1, p2);
-        QLineF::IntersectType intersectType =
-            polyLine.intersect(centerLine, &intersectPoint);
-        if (intersectType == QLineF::BoundedIntersection)
-            break;
-        p1 = p2;
-    }
-
-    setLine(QLineF(intersectPoint, startPos));
-
-    double angle = ::acos(line().dx() / line().length());
-    if (line().dy() >= 0)
-        angle = (Pi * 2) - angle;
-
-    QPointF arrowP1 = line().p1() + QPointF(sin(angle + Pi / 3) * arrowSize,
-                                    cos(angle + Pi / 3) * arrowSize);
-    QPointF arrowP2 = line().p1() + QPointF(sin(angle + Pi - Pi / 3) * arrowSize,
-                                    cos(angle + Pi - Pi / 3) * arrowSize);
-
-    arrowHead.clear();
-    arrowHead << line().p1() << arrowP1 << arrowP2;
-
     painter->drawLine(line());
     painter->drawPolygon(arrowHead);
     if (isSelected()) {
@@ -228,3 +248,44 @@ void Arrow::paint(QPainter *painter, const QStyleOptionGraphicsItem *,
     }
 }
 
+void Arrow::updateShape()
+{
+    // An arrow that is not drawn cannot be clicked.
+    if (m_hidden) {
+        m_shape = QPainterPath();
+        return;
+    }
+
+    m_shape = QGraphicsLineItem::shape();
+    m_shape.addPolygon(arrowHead);
+}
+
+///
+/// \brief Arrow::updateEdgeLayer Redraw the arrow in the edge layer of the scene, if it is drawn there.
+///
+void Arrow::updateEdgeLayer()
+{
+    auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+    if (diagramScene && diagramScene->edgeLayer()) {
+        diagramScene->edgeLayer()->updateArrow(this);
+    }
+}
+
+QVariant Arrow::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    // Keep the arrow registry of the scene up to date.
+    if (change == QGraphicsItem::ItemSceneChange) {
+        auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+        if (diagramScene) {
+            diagramScene->unregisterArrow(this);
+        }
+    }
+    else if (change == QGraphicsItem::ItemSceneHasChanged) {
+        auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+        if (diagramScene) {
+            diagramScene->registerArrow(this);
+        }
+    }
+
+    return QGraphicsLineItem::itemChange(change, value);
+}
@@ -19,6 +19,7 @@
 #define ARROW_H
 
 #include <QGraphicsLineItem>
+#include <QPainterPath>
 
 #include "diagramitem.h"
 
@@ -44,24 +45,40 @@ public:
     QRectF boundingRect() const override;
     QPainterPath shape() const override;
     QColor getColor() const;
-    void setColor(const QColor &color) { myColor = color; }
+    void setColor(const QColor &color);
     DiagramItem *startItem() const { return myStartItem; }
     DiagramItem *endItem() const { return myEndItem; }
 
+    /**
+     * @brief updatePosition Work out the line and arrowhead again. Call this
+     * when either person moves or changes size, so that painting only draws.
+     */
     void updatePosition();
     void setLineWidth(int width);
 
+    /**
+     * @brief hasLine Check if there is a line to draw, i.e. the persons do not overlap.
+     */
+    bool hasLine() const { return !m_hidden; }
+    const QPolygonF &arrowHeadPolygon() const { return arrowHead; }
+
     static int getDefaultLineWidth();
     static void setDefaultLineWidth(int width);
 
 protected:
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0) override;
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
 
 private:
+    void updateShape();
+    void updateEdgeLayer();
+
     DiagramItem *myStartItem;
     DiagramItem *myEndItem;
     QColor myColor;
     QPolygonF arrowHead;
+    QPainterPath m_shape;
+    bool m_hidden; ///< True if the persons overlap, so there is no line to draw.
 };
 //! [0]
 
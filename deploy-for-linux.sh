@@ -42,9 +42,6 @@ cd $DEST_DIR
 # Make the deployment.
 ~/Downloads/build-linuxdeployqt-Desktop-Debug/bin/linuxdeployqt "$DESKTOP_DIR/genealogy-maker.desktop" -verbose=2 -appimage -ignore-glob="/home/martin/*"
 
-# Copy the GEDCOM Python files.
-cp -R ../python-gedcom-1.0.0/ .
-
 # Copy the help files.
 cp -R ../doc/ .
 
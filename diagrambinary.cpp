@@ -0,0 +1,612 @@
+#include "diagrambinary.h"
+#include "diagramreader.h"
+#include "fileutils.h"
+
+#include <QFile>
+#include <QHash>
+#include <QIODevice>
+#include <QtEndian>
+
+#include <climits>
+#include <cstring>
+
+// The file starts with this signature.
+static const char magic[] = "GMDIAGRM";
+static const int magicSize = 8;
+static const quint32 formatVersion = 1;
+
+//
+// Header layout. The header is followed by the sections it lists.
+//
+// 0   magic
+// 8   u32 version
+// 12  u32 header size
+// 16  f64 width, as in the XML root element
+// 24  f64 height, as in the XML root element
+// 32  section table: u64 offset, u32 count, u32 record size for each section
+//
+static const int sectionTableOffset = 32;
+static const int sectionEntrySize = 16;
+
+enum Section {
+    StringIndexSection, ///< u32 offsets into the string data, one more than the strings.
+    StringDataSection, ///< UTF-8 string data.
+    PersonSection,
+    PhotoSection,
+    RelationshipSection,
+    MarriageSection,
+    SectionCount
+};
+
+static const int headerSize = sectionTableOffset + SectionCount * sectionEntrySize;
+
+//
+// Person record layout.
+//
+// 0   uuid (RFC 4122 bytes)
+// 16  f64 x, f64 y
+// 32  u32 string indices: first name, last name, name, bio, place of birth,
+//     country of birth, place of death, gender
+// 64  i64 date of birth, i64 date of death (Julian days)
+// 80  u32 fill color, text color, border color (ARGB)
+// 92  u32 flags
+// 96  u32 first photo, u32 photo count
+//
+static const int personRecordSize = 104;
+
+enum PersonFlag {
+    HasDateOfBirth = 0x01,
+    DateOfBirthValid = 0x02,
+    HasDateOfDeath = 0x04,
+    DateOfDeathValid = 0x08,
+    FillColorValid = 0x10,
+    TextColorValid = 0x20,
+    BorderColorValid = 0x40
+};
+
+// Photo record: u32 path string index, u32 flags.
+static const int photoRecordSize = 8;
+static const quint32 photoInProjectFolder = 0x01;
+
+// Relationship record: u32 from person, u32 to person, u32 color, u32 flags.
+static const int relationshipRecordSize = 16;
+static const quint32 relationshipColorValid = 0x01;
+
+// Marriage record: f64 x, f64 y, u32 left person, u32 right person,
+// i64 date, u32 place string index, u32 flags.
+static const int marriageRecordSize = 40;
+static const quint32 marriageHasDate = 0x01;
+static const quint32 marriageDateValid = 0x02;
+
+static const int expectedRecordSizes[SectionCount] = {
+    4, 1, personRecordSize, photoRecordSize, relationshipRecordSize, marriageRecordSize
+};
+
+//
+// Little-endian helpers.
+//
+static void appendU32(QByteArray &bytes, quint32 value)
+{
+    uchar buffer[sizeof(value)];
+    qToLittleEndian(value, buffer);
+    bytes.append(reinterpret_cast<const char *>(buffer), sizeof(buffer));
+}
+
+static void appendI64(QByteArray &bytes, qint64 value)
+{
+    uchar buffer[sizeof(value)];
+    qToLittleEndian(value, buffer);
+    bytes.append(reinterpret_cast<const char *>(buffer), sizeof(buffer));
+}
+
+static void appendF64(QByteArray &bytes, double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    appendI64(bytes, static_cast<qint64>(bits));
+}
+
+static quint32 readU32(const uchar *data)
+{
+    return qFromLittleEndian<quint32>(data);
+}
+
+static quint64 readU64(const uchar *data)
+{
+    return qFromLittleEndian<quint64>(data);
+}
+
+static qint64 readI64(const uchar *data)
+{
+    return qFromLittleEndian<qint64>(data);
+}
+
+static double readF64(const uchar *data)
+{
+    quint64 bits = readU64(data);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static qint64 dateToJulianDay(const QDate &date)
+{
+    return date.isValid() ? date.toJulianDay() : 0;
+}
+
+static quint32 colorToRgba(const QColor &color)
+{
+    return color.isValid() ? color.rgba() : 0;
+}
+
+/**
+ * @brief The StringTable class collects the strings to write, storing each
+ * distinct string once. Index 0 is the empty string.
+ */
+class StringTable
+{
+public:
+    StringTable() :
+        m_count(0)
+    {
+        add(QString());
+    }
+
+    quint32 add(const QString &string)
+    {
+        auto it = m_indexes.constFind(string);
+        if (it != m_indexes.constEnd()) {
+            return it.value();
+        }
+
+        appendU32(m_index, static_cast<quint32>(m_data.size()));
+        m_data.append(string.toUtf8());
+        m_indexes.insert(string, m_count);
+        return m_count++;
+    }
+
+    /// The offsets of each string, followed by the end of the data.
+    QByteArray index() const
+    {
+        QByteArray bytes = m_index;
+        appendU32(bytes, static_cast<quint32>(m_data.size()));
+        return bytes;
+    }
+
+    const QByteArray &data() const
+    {
+        return m_data;
+    }
+
+    quint32 count() const
+    {
+        return m_count;
+    }
+
+private:
+    QHash<QString, quint32> m_indexes;
+    QByteArray m_index;
+    QByteArray m_data;
+    quint32 m_count;
+};
+
+bool DiagramBinary::isBinary(QIODevice *device)
+{
+    return device->peek(magicSize) == QByteArray(magic, magicSize);
+}
+
+bool DiagramBinary::isBinaryFileName(const QString &fileName)
+{
+    return fileName.endsWith(".gmb", Qt::CaseInsensitive);
+}
+
+bool DiagramBinary::read(const uchar *data, qint64 size, const QString &photosFolderPath,
+                         DiagramSnapshot &contents, QString *errorString)
+{
+    const QString damagedMessage = tr("The binary file is damaged.");
+
+    //
+    // Check the header.
+    //
+    if (size < headerSize || std::memcmp(data, magic, magicSize) != 0) {
+        *errorString = tr("The file is not an genealogy file.");
+        return false;
+    }
+
+    if (readU32(data + 8) != formatVersion) {
+        *errorString = tr("The file was saved by a newer version of Genealogy Maker.");
+        return false;
+    }
+
+    if (readU32(data + 12) < static_cast<quint32>(headerSize)) {
+        *errorString = damagedMessage;
+        return false;
+    }
+
+    contents.width = readF64(data + 16);
+    contents.height = readF64(data + 24);
+
+    //
+    // Check the sections fit in the file.
+    //
+    const uchar *sections[SectionCount];
+    quint32 counts[SectionCount];
+    quint32 recordSizes[SectionCount];
+
+    for (int i = 0; i < SectionCount; ++i) {
+        const uchar *entry = data + sectionTableOffset + i * sectionEntrySize;
+        quint64 offset = readU64(entry);
+        counts[i] = readU32(entry + 8);
+        recordSizes[i] = readU32(entry + 12);
+
+        // Newer versions may only add fields to the end of a record.
+        if (recordSizes[i] < static_cast<quint32>(expectedRecordSizes[i]) ||
+                offset > static_cast<quint64>(size) ||
+                counts[i] > (static_cast<quint64>(size) - offset) / recordSizes[i]) {
+            *errorString = damagedMessage;
+            return false;
+        }
+
+        sections[i] = data + offset;
+    }
+
+    // Get a record of a section.
+    auto recordAt = [&sections, &recordSizes](Section section, quint64 index) {
+        return sections[section] + index * recordSizes[section];
+    };
+
+    //
+    // Load the string table.
+    //
+    if (counts[StringIndexSection] == 0) {
+        *errorString = damagedMessage;
+        return false;
+    }
+
+    const quint32 stringCount = counts[StringIndexSection] - 1;
+    const char *stringData = reinterpret_cast<const char *>(sections[StringDataSection]);
+    QVector<QString> strings(stringCount);
+    quint32 start = readU32(recordAt(StringIndexSection, 0));
+
+    for (quint32 i = 0; i < stringCount; ++i) {
+        quint32 end = readU32(recordAt(StringIndexSection, i + 1));
+        if (end < start || end > counts[StringDataSection]) {
+            *errorString = damagedMessage;
+            return false;
+        }
+        strings[i] = QString::fromUtf8(stringData + start, static_cast<int>(end - start));
+        start = end;
+    }
+
+    // Check an index before using it.
+    bool ok = true;
+    auto string = [&strings, &ok](quint32 index) {
+        if (index >= static_cast<quint32>(strings.size())) {
+            ok = false;
+            return QString();
+        }
+        return strings[index];
+    };
+
+    //
+    // Load persons.
+    //
+    const quint32 personCount = counts[PersonSection];
+    const quint32 photoCount = counts[PhotoSection];
+    contents.persons.resize(personCount);
+
+    for (quint32 i = 0; i < personCount; ++i) {
+        const uchar *record = recordAt(PersonSection, i);
+        PersonRecord &person = contents.persons[i];
+
+        person.id = QUuid::fromRfc4122(QByteArray::fromRawData(reinterpret_cast<const char *>(record), 16));
+
+        // Relationships refer to persons by index, so every person needs an ID.
+        if (person.id.isNull()) {
+            person.id = QUuid::createUuid();
+        }
+
+        person.pos = QPointF(readF64(record + 16), readF64(record + 24));
+        person.firstName = string(readU32(record + 32));
+        person.lastName = string(readU32(record + 36));
+        person.name = string(readU32(record + 40));
+        person.bio = string(readU32(record + 44));
+        person.placeOfBirth = string(readU32(record + 48));
+        person.countryOfBirth = string(readU32(record + 52));
+        person.placeOfDeath = string(readU32(record + 56));
+        person.gender = string(readU32(record + 60));
+
+        quint32 flags = readU32(record + 92);
+
+        person.hasDateOfBirth = flags & HasDateOfBirth;
+        if (flags & DateOfBirthValid) {
+            person.dateOfBirth = QDate::fromJulianDay(readI64(record + 64));
+        }
+        person.hasDateOfDeath = flags & HasDateOfDeath;
+        if (flags & DateOfDeathValid) {
+            person.dateOfDeath = QDate::fromJulianDay(readI64(record + 72));
+        }
+
+        if (flags & FillColorValid) {
+            person.fillColor = QColor::fromRgba(readU32(record + 80));
+        }
+        if (flags & TextColorValid) {
+            person.textColor = QColor::fromRgba(readU32(record + 84));
+        }
+        if (flags & BorderColorValid) {
+            person.borderColor = QColor::fromRgba(readU32(record + 88));
+        }
+
+        // Load photos.
+        quint64 firstPhoto = readU32(record + 96);
+        quint64 personPhotoCount = readU32(record + 100);
+        if (firstPhoto + personPhotoCount > photoCount) {
+            ok = false;
+            break;
+        }
+
+        for (quint64 j = firstPhoto; j < firstPhoto + personPhotoCount; ++j) {
+            const uchar *photo = recordAt(PhotoSection, j);
+            QString path = string(readU32(photo));
+
+            // Check for relative (project dir) path.
+            if (readU32(photo + 4) & photoInProjectFolder) {
+                path.prepend(photosFolderPath + "/");
+            }
+
+            person.photos << path;
+        }
+    }
+
+    //
+    // Load relationships.
+    //
+    const quint32 relationshipCount = counts[RelationshipSection];
+    contents.relationships.resize(relationshipCount);
+
+    for (quint32 i = 0; i < relationshipCount && ok; ++i) {
+        const uchar *record = recordAt(RelationshipSection, i);
+        RelationshipRecord &relationship = contents.relationships[i];
+
+        quint32 from = readU32(record);
+        quint32 to = readU32(record + 4);
+        if (from >= personCount || to >= personCount) {
+            ok = false;
+            break;
+        }
+
+        relationship.from = contents.persons[from].id;
+        relationship.to = contents.persons[to].id;
+
+        if (readU32(record + 12) & relationshipColorValid) {
+            relationship.color = QColor::fromRgba(readU32(record + 8));
+        }
+    }
+
+    //
+    // Load marriages.
+    //
+    const quint32 marriageCount = counts[MarriageSection];
+    contents.marriages.resize(marriageCount);
+
+    for (quint32 i = 0; i < marriageCount && ok; ++i) {
+        const uchar *record = recordAt(MarriageSection, i);
+        MarriageRecord &marriage = contents.marriages[i];
+
+        quint32 left = readU32(record + 16);
+        quint32 right = readU32(record + 20);
+        if (left >= personCount || right >= personCount) {
+            ok = false;
+            break;
+        }
+
+        marriage.pos = QPointF(readF64(record), readF64(record + 8));
+        marriage.personLeft = contents.persons[left].id;
+        marriage.personRight = contents.persons[right].id;
+        marriage.place = string(readU32(record + 32));
+
+        quint32 flags = readU32(record + 36);
+        marriage.hasDate = flags & marriageHasDate;
+        if (flags & marriageDateValid) {
+            marriage.date = QDate::fromJulianDay(readI64(record + 24));
+        }
+    }
+
+    if (!ok) {
+        *errorString = damagedMessage;
+        return false;
+    }
+
+    return true;
+}
+
+void DiagramBinary::write(const DiagramSnapshot &snapshot, QIODevice *device)
+{
+    StringTable strings;
+
+    // Check if photos are stored in the project folder.
+    bool copyPhotos = !snapshot.photosFolderPath.isEmpty();
+    QString prefix = snapshot.photosFolderPath + "/";
+
+    // Index the persons, so links can refer to them.
+    QHash<QUuid, quint32> indexForId;
+    QHash<QString, quint32> indexForPointer;
+    indexForId.reserve(snapshot.persons.size());
+
+    for (int i = 0; i < snapshot.persons.size(); ++i) {
+        const PersonRecord &person = snapshot.persons[i];
+        if (!person.id.isNull()) {
+            indexForId.insert(person.id, i);
+        }
+        if (!person.pointer.isEmpty()) {
+            indexForPointer.insert(person.pointer, i);
+        }
+    }
+
+    // Find a linked person by pointer if given, otherwise by ID.
+    auto personIndex = [&indexForId, &indexForPointer](const QString &pointer, const QUuid &id) {
+        if (!pointer.isEmpty()) {
+            return indexForPointer.value(pointer, UINT_MAX);
+        }
+        return id.isNull() ? UINT_MAX : indexForId.value(id, UINT_MAX);
+    };
+
+    //
+    // Persons and photos.
+    //
+    QByteArray persons;
+    QByteArray photos;
+    persons.reserve(snapshot.persons.size() * personRecordSize);
+    quint32 photoCount = 0;
+
+    for (const PersonRecord &person: snapshot.persons) {
+        persons.append(person.id.toRfc4122());
+        appendF64(persons, person.pos.x());
+        appendF64(persons, person.pos.y());
+        appendU32(persons, strings.add(person.firstName));
+        appendU32(persons, strings.add(person.lastName));
+        appendU32(persons, strings.add(person.name));
+        appendU32(persons, strings.add(person.bio));
+        appendU32(persons, strings.add(person.placeOfBirth));
+        appendU32(persons, strings.add(person.countryOfBirth));
+        appendU32(persons, strings.add(person.placeOfDeath));
+        appendU32(persons, strings.add(person.gender));
+        appendI64(persons, dateToJulianDay(person.dateOfBirth));
+        appendI64(persons, dateToJulianDay(person.dateOfDeath));
+        appendU32(persons, colorToRgba(person.fillColor));
+        appendU32(persons, colorToRgba(person.textColor));
+        appendU32(persons, colorToRgba(person.borderColor));
+
+        quint32 flags = 0;
+        if (person.hasDateOfBirth) flags |= HasDateOfBirth;
+        if (person.dateOfBirth.isValid()) flags |= DateOfBirthValid;
+        if (person.hasDateOfDeath) flags |= HasDateOfDeath;
+        if (person.dateOfDeath.isValid()) flags |= DateOfDeathValid;
+        if (person.fillColor.isValid()) flags |= FillColorValid;
+        if (person.textColor.isValid()) flags |= TextColorValid;
+        if (person.borderColor.isValid()) flags |= BorderColorValid;
+        appendU32(persons, flags);
+
+        appendU32(persons, photoCount);
+        appendU32(persons, static_cast<quint32>(person.photos.size()));
+
+        for (const QString &photo: person.photos) {
+            // Store the path relative to the project folder if possible.
+            if (copyPhotos && photo.startsWith(prefix)) {
+                appendU32(photos, strings.add(photo.mid(prefix.size())));
+                appendU32(photos, photoInProjectFolder);
+            }
+            else {
+                appendU32(photos, strings.add(photo));
+                appendU32(photos, 0);
+            }
+            ++photoCount;
+        }
+    }
+
+    //
+    // Relationships. Links to missing persons are left out, as when opening.
+    //
+    QByteArray relationships;
+    quint32 relationshipCount = 0;
+
+    for (const RelationshipRecord &relationship: snapshot.relationships) {
+        quint32 from = personIndex(relationship.fromPointer, relationship.from);
+        quint32 to = personIndex(relationship.toPointer, relationship.to);
+        if (from == UINT_MAX || to == UINT_MAX) {
+            continue;
+        }
+
+        appendU32(relationships, from);
+        appendU32(relationships, to);
+        appendU32(relationships, colorToRgba(relationship.color));
+        appendU32(relationships, relationship.color.isValid() ? relationshipColorValid : 0);
+        ++relationshipCount;
+    }
+
+    //
+    // Marriages.
+    //
+    QByteArray marriages;
+    quint32 marriageCount = 0;
+
+    for (const MarriageRecord &marriage: snapshot.marriages) {
+        quint32 left = personIndex(marriage.leftPointer, marriage.personLeft);
+        quint32 right = personIndex(marriage.rightPointer, marriage.personRight);
+        if (left == UINT_MAX || right == UINT_MAX) {
+            continue;
+        }
+
+        appendF64(marriages, marriage.pos.x());
+        appendF64(marriages, marriage.pos.y());
+        appendU32(marriages, left);
+        appendU32(marriages, right);
+        appendI64(marriages, dateToJulianDay(marriage.date));
+        appendU32(marriages, strings.add(marriage.place));
+
+        quint32 flags = 0;
+        if (marriage.hasDate) flags |= marriageHasDate;
+        if (marriage.date.isValid()) flags |= marriageDateValid;
+        appendU32(marriages, flags);
+        ++marriageCount;
+    }
+
+    //
+    // Header.
+    //
+    const QByteArray stringIndex = strings.index();
+    const QByteArray *sectionData[SectionCount] = {
+        &stringIndex, &strings.data(), &persons, &photos, &relationships, &marriages
+    };
+    const quint32 counts[SectionCount] = {
+        strings.count() + 1,
+        static_cast<quint32>(strings.data().size()),
+        static_cast<quint32>(snapshot.persons.size()),
+        photoCount,
+        relationshipCount,
+        marriageCount
+    };
+
+    QByteArray header(magic, magicSize);
+    appendU32(header, formatVersion);
+    appendU32(header, headerSize);
+    appendF64(header, snapshot.width);
+    appendF64(header, snapshot.height);
+
+    qint64 offset = headerSize;
+    for (int i = 0; i < SectionCount; ++i) {
+        appendI64(header, offset);
+        appendU32(header, counts[i]);
+        appendU32(header, expectedRecordSizes[i]);
+        offset += sectionData[i]->size();
+    }
+
+    //
+    // Write everything.
+    //
+    device->write(header);
+    for (const QByteArray *bytes: sectionData) {
+        device->write(*bytes);
+    }
+}
+
+bool DiagramBinary::convert(const QString &inputFileName, const QString &outputFileName,
+                            QString *errorString)
+{
+    QFile file(inputFileName);
+    if (!file.open(QFile::ReadOnly)) {
+        *errorString = tr("Cannot read file %1:\n%2.").arg(inputFileName).arg(file.errorString());
+        return false;
+    }
+
+    DiagramReader reader;
+    if (!reader.read(&file, FileUtils::getPhotosFolderFor(inputFileName))) {
+        *errorString = reader.errorString();
+        return false;
+    }
+
+    // Photos in the input project folder keep their full path, unless both
+    // files share the same project folder.
+    DiagramSnapshot snapshot = reader.snapshot(FileUtils::getPhotosFolderFor(outputFileName));
+    return DiagramWriter::save(snapshot, outputFileName, errorString);
+}
@@ -0,0 +1,71 @@
+#ifndef DIAGRAMBINARY_H
+#define DIAGRAMBINARY_H
+
+#include "diagramwriter.h"
+
+#include <QCoreApplication>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+/**
+ * @brief The DiagramBinary class reads and writes the compact binary diagram
+ * format, for very large trees.
+ *
+ * The file holds a string table, fixed-size person records that refer to the
+ * strings by index, and arrays of relationships and marriages that refer to
+ * the persons by index. All numbers are little-endian.
+ */
+class DiagramBinary
+{
+    Q_DECLARE_TR_FUNCTIONS(DiagramBinary)
+
+public:
+    /**
+     * @brief isBinary Check whether a device holds a binary diagram, without reading from it.
+     * @param device The open device.
+     * @return True if the device starts with the binary diagram signature.
+     */
+    static bool isBinary(QIODevice *device);
+
+    /**
+     * @brief isBinaryFileName Check whether a file should be saved in the binary format.
+     * @param fileName The file name.
+     * @return True if the file has the binary extension.
+     */
+    static bool isBinaryFileName(const QString &fileName);
+
+    /**
+     * @brief read Read a binary diagram from memory.
+     * The width and height are stored as in the XML root element.
+     * @param data The file contents, usually memory-mapped.
+     * @param size The size of the contents in bytes.
+     * @param photosFolderPath The path to photos for the project.
+     * @param contents Set to the records read.
+     * @param errorString Set to the error message if the file cannot be read.
+     * @return True if read OK.
+     */
+    static bool read(const uchar *data, qint64 size, const QString &photosFolderPath,
+                     DiagramSnapshot &contents, QString *errorString);
+
+    /**
+     * @brief write Write a snapshot in the binary format.
+     * @param snapshot The snapshot.
+     * @param device The file to write.
+     */
+    static void write(const DiagramSnapshot &snapshot, QIODevice *device);
+
+    /**
+     * @brief convert Convert a diagram file between the XML and binary formats.
+     * The format of each file is chosen from its file name.
+     * @param inputFileName The file to read.
+     * @param outputFileName The file to write.
+     * @param errorString Set to the error message if the conversion fails.
+     * @return True if converted OK.
+     */
+    static bool convert(const QString &inputFileName, const QString &outputFileName,
+                        QString *errorString);
+};
+
+#endif // DIAGRAMBINARY_H
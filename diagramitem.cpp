@@ -17,8 +17,12 @@
 
 #include "diagramitem.h"
 #include "arrow.h"
+#include "diagramscene.h"
 #include "diagramtextitem.h"
+#include "generationindex.h"
+#include "kinshipgraph.h"
 #include "marriageitem.h"
+#include "rendercache.h"
 
 #include <QGraphicsScene>
 #include <QGraphicsSceneContextMenuEvent>
@@ -27,6 +31,7 @@
 #include <QUuid>
 #include <QGraphicsItemGroup>
 #include <QDebug>
+#include <QFontMetricsF>
 #include <QStyleOptionGraphicsItem>
 #include <QImageReader>
 
@@ -36,14 +41,61 @@ static bool m_showThumbnailByDefault = false;
 static int DEFAULT_WIDTH = 200;
 static int DEFAULT_HEIGHT = 50;
 
+// The space around the name, as the editor leaves it.
+static const qreal NAME_MARGIN = 4;
+
+static QFont m_defaultNameFont;
+
+///
+/// \brief The ThumbnailItem class is a photo that is only drawn at full detail.
+///
+class ThumbnailItem : public QGraphicsPixmapItem
+{
+public:
+    explicit ThumbnailItem(QGraphicsItem *parent) : QGraphicsPixmapItem(parent), m_keyPhoto(0) {}
+
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override
+    {
+        if (DiagramItem::detail(option, painter) != DiagramItem::FullDetail) {
+            return;
+        }
+
+        // Keep the scaled photo, since smooth scaling is slow. The key is only
+        // made again when the photo changes.
+        qint64 photo = pixmap().cacheKey();
+        if (m_renderKey.isEmpty() || photo != m_keyPhoto) {
+            m_renderKey = QString("thumbnail|%1|%2").arg(photo).arg(transformationMode());
+            m_keyPhoto = photo;
+        }
+
+        auto paintPhoto = [&](QPainter *cachePainter) {
+            QGraphicsPixmapItem::paint(cachePainter, option, widget);
+        };
+
+        if (!RenderCache::draw(painter, m_renderKey, boundingRect(), paintPhoto)) {
+            paintPhoto(painter);
+        }
+    }
+
+private:
+    QString m_renderKey;
+    qint64 m_keyPhoto; ///< The photo the key was made for.
+};
+
 DiagramItem::DiagramItem(DiagramType diagramType, QMenu *contextMenu,
              QGraphicsItem *parent)
     : QGraphicsPolygonItem(parent),
       m_spouse(nullptr),
       m_movedBySpouse(false),
       m_marriageItem(nullptr),
+      m_textItem(nullptr),
+      m_textColor(Qt::black),
       m_thumbnail(nullptr),
-      m_borderColor(Qt::black)
+      m_borderColor(Qt::black),
+      m_kinshipMark(0),
+      m_generation(-1),
+      m_depth(-1),
+      m_cycleFlags(0)
 {
     myDiagramType = diagramType;
     myContextMenu = contextMenu;
@@ -71,19 +123,21 @@ DiagramItem::DiagramItem(DiagramType diagramType, QMenu *contextMenu,
     setFlag(QGraphicsItem::ItemIsSelectable, true);
     setFlag(QGraphicsItem::ItemSendsGeometryChanges, true);
 
-    // Add child text.
+    // Apply default font if valid.
+    if (!m_defaultNameFont.family().isEmpty() && m_defaultNameFont.pointSize() >= 1) {
+        m_font = m_defaultNameFont;
+    }
+
+    // Set the name. It is drawn by the person, and an editor is only made to change it.
     if (myDiagramType == Person) {
-        m_textItem = new DiagramTextItem(this);
-        m_textItem->setPlainText("New Person");
+        m_name = "New Person";
+        updateNameText();
         fitToText();
 
         // Set default name fields.
         m_firstName = "New";
         m_lastName = "Person";
     }
-    else {
-        m_textItem = nullptr;
-    }
 
     // Set default dates.
     m_dateOfBirth = defaultDateOfBirth();
@@ -97,8 +151,18 @@ void DiagramItem::removeArrow(Arrow *arrow)
 {
     int index = arrows.indexOf(arrow);
 
-    if (index != -1)
+    if (index != -1) {
         arrows.removeAt(index);
+
+        // Update kinship links.
+        if (arrow->startItem() == this) {
+            m_children.removeOne(arrow->endItem());
+        }
+        if (arrow->endItem() == this) {
+            m_parents.removeOne(arrow->startItem());
+        }
+        GenerationIndex::linkChanged(arrow->startItem(), arrow->endItem());
+    }
 }
 
 void DiagramItem::removeArrows()
@@ -114,6 +178,15 @@ void DiagramItem::removeArrows()
 void DiagramItem::addArrow(Arrow *arrow)
 {
     arrows.append(arrow);
+
+    // Update kinship links.
+    if (arrow->startItem() == this) {
+        m_children.append(arrow->endItem());
+    }
+    if (arrow->endItem() == this) {
+        m_parents.append(arrow->startItem());
+    }
+    GenerationIndex::linkChanged(arrow->startItem(), arrow->endItem());
 }
 
 QPixmap DiagramItem::image() const
@@ -135,19 +208,23 @@ QList<Arrow *> DiagramItem::getArrows() const
 
 QString DiagramItem::name() const
 {
-    if (m_textItem) {
-        return m_textItem->text();
-    }
-
-    return "NO_NAME";
+    return m_name;
 }
 
 void DiagramItem::setName(QString value)
 {
     if (m_textItem) {
         m_textItem->setPlainText(value);
-        fitToText();
-        m_textItem->emitChangedSignal();
+    }
+
+    m_name = value;
+    updateNameText();
+    fitToText();
+    updateNameIndex();
+
+    auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+    if (diagramScene) {
+        emit diagramScene->personNameChanged(this);
     }
 }
 
@@ -166,14 +243,18 @@ void DiagramItem::marryTo(DiagramItem *spouse)
     // Set spouses.
     m_spouse = spouse;
     spouse->m_spouse = this;
+    GenerationIndex::marriageChanged(this);
+    GenerationIndex::marriageChanged(spouse);
 
     // Position together.
     m_spousePosition = SpouseToRight;
     spouse->m_spousePosition = SpouseToLeft;
     updateSpousePosition();
 
-    // Add "wedding ring".
-    auto ring = new MarriageItem(this);
+    // Add "wedding ring". The parent is set after construction, so that the
+    // ring is told it joined the scene.
+    auto ring = new MarriageItem();
+    ring->setParentItem(this);
     m_marriageItem = ring;
     setMarriageItemPosition();
     ring->setPersonLeft(this);
@@ -209,14 +290,72 @@ void DiagramItem::setId(const QUuid& value)
     m_id = value;
 }
 
-DiagramTextItem *DiagramItem::textItem()
+void DiagramItem::editName()
+{
+    if (myDiagramType != Person) {
+        return;
+    }
+
+    // Make an editor over the name.
+    if (!m_textItem) {
+        m_textItem = new DiagramTextItem(this);
+        m_textItem->setFont(m_font);
+        m_textItem->setDefaultTextColor(m_textColor);
+        m_textItem->setPlainText(m_name);
+        m_textItem->setPos(nameRect().topLeft());
+        update();
+    }
+
+    m_textItem->startEditing();
+}
+
+bool DiagramItem::isEditingName() const
 {
-    return m_textItem;
+    return m_textItem != nullptr;
 }
 
-void DiagramItem::editName()
+QFont DiagramItem::nameFont() const
 {
-    m_textItem->startEditing();
+    return m_font;
+}
+
+void DiagramItem::setNameFont(const QFont &font)
+{
+    m_font = font;
+    if (m_textItem) {
+        m_textItem->setFont(font);
+    }
+
+    updateNameText();
+    update();
+}
+
+void DiagramItem::setDefaultNameFont(const QFont &font)
+{
+    m_defaultNameFont = font;
+}
+
+QRectF DiagramItem::nameRect() const
+{
+    QSizeF size = m_nameText.size();
+    size.rheight() = qMax(size.height(), QFontMetricsF(m_font).height());
+    size += QSizeF(NAME_MARGIN * 2, NAME_MARGIN * 2);
+
+    QPointF center = boundingRect().center();
+    return QRectF(center.x() - size.width() / 2, center.y() - size.height() / 2,
+                  size.width(), size.height());
+}
+
+///
+/// \brief DiagramItem::updateNameText Lay out the name again, after it or the font changed.
+///
+void DiagramItem::updateNameText()
+{
+    m_nameText.setText(m_name);
+    m_nameText.setTextFormat(Qt::PlainText);
+    m_nameText.setPerformanceHint(QStaticText::AggressiveCaching);
+    m_nameText.prepare(QTransform(), m_font);
+    invalidateRenderKeys();
 }
 
 QString DiagramItem::bio() const
@@ -238,6 +377,7 @@ void DiagramItem::setPhotos(const QStringList &value)
 {
     m_photos = value;
     updateThumbnail();
+    updateStatistics();
 }
 
 bool DiagramItem::isMarried() const
@@ -259,8 +399,15 @@ void DiagramItem::removeMarriage()
         m_spouse->m_marriageItem = nullptr;
 
         // Remove spouse connections.
+        GenerationIndex::marriageChanged(this);
+        GenerationIndex::marriageChanged(m_spouse);
+        DiagramItem *spouse = m_spouse;
         m_spouse->m_spouse = nullptr;
         m_spouse = nullptr;
+
+        // The arrows start from each person again.
+        updateArrowPositions();
+        spouse->updateArrowPositions();
     }
 }
 
@@ -273,28 +420,61 @@ void DiagramItem::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
 
 QVariant DiagramItem::itemChange(GraphicsItemChange change, const QVariant &value)
 {
-    if (change == QGraphicsItem::ItemPositionChange) {
+    if (change == QGraphicsItem::ItemPositionHasChanged) {
+        // The arrows keep their geometry, so update them once the new position is set.
         updateArrowPositions();
-    }
-    else if (change == QGraphicsItem::ItemPositionHasChanged) {
         updateSpousePosition();
         m_movedBySpouse = false;
     }
+    else if (change == QGraphicsItem::ItemSelectedHasChanged) {
+        invalidateRenderKeys();
+    }
+    else if (change == QGraphicsItem::ItemSceneChange) {
+        // Leave the registry and indexes of the old scene.
+        auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+        if (diagramScene) {
+            diagramScene->unregisterPerson(this);
+        }
+    }
+    else if (change == QGraphicsItem::ItemSceneHasChanged) {
+        // Join those of the new scene.
+        auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+        if (diagramScene) {
+            diagramScene->registerPerson(this);
+        }
+    }
 
     return value;
 }
 
 void DiagramItem::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event)
 {
-    Q_UNUSED(event);
-
-//    if (m_textItem->isUnderMouse()) {
-//        m_textItem->startEditing();
-//    }
+    // Edit the name if it was double-clicked, as the text editor did.
+    if (nameRect().contains(event->pos())) {
+        editName();
+        return;
+    }
 
     m_doubleClickedItem = this;
 }
 
+void DiagramItem::updateStatistics()
+{
+    auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+    if (diagramScene) {
+        diagramScene->statistics().updatePerson(this);
+    }
+}
+
+void DiagramItem::updateNameIndex()
+{
+    auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+    if (diagramScene) {
+        diagramScene->nameIndex().insert(this);
+        diagramScene->phoneticIndex().insert(this);
+    }
+}
+
 void DiagramItem::updateArrowPositions()
 {
     foreach (Arrow *arrow, arrows) {
@@ -302,20 +482,124 @@ void DiagramItem::updateArrowPositions()
     }
 }
 
-//void DiagramItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
-//{
-//    // Highlight in green if selected.
-//    if (isSelected()) {
-//        QPen pen(Qt::darkGreen, 3);
-//        painter->setPen(pen);
-//        painter->drawRect(boundingRect().adjusted(-5, -5, 5, 5));
-//    }
+DiagramItem::Detail DiagramItem::detail(const QStyleOptionGraphicsItem *option, const QPainter *painter)
+{
+    qreal level = option->levelOfDetailFromTransform(painter->worldTransform());
+
+    if (level < 0.3) {
+        return LowDetail;
+    }
+    if (level < 0.75) {
+        return MediumDetail;
+    }
+    return FullDetail;
+}
+
+void DiagramItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    // The editor is shown at any zoom.
+    Detail level = m_textItem ? FullDetail : detail(option, painter);
+
+    if (level == LowDetail) {
+        // Too small to read, so only show where the person is.
+        painter->setPen(isSelected() ? QPen(Qt::black, 0, Qt::DashLine) : QPen(Qt::NoPen));
+        painter->setBrush(brush());
+        painter->drawRect(myPolygon.boundingRect());
+        return;
+    }
+
+    auto paintBox = [&](QPainter *boxPainter) {
+        paintBoxAndName(boxPainter, option, widget, level);
+    };
+
+    // The editor changes as it is typed in, so draw directly while editing.
+    if (m_textItem || !RenderCache::draw(painter, renderKey(level), boundingRect(), paintBox)) {
+        paintBox(painter);
+    }
+}
+
+///
+/// \brief DiagramItem::paintBoxAndName Draw the box, with the name or short name.
+///
+void DiagramItem::paintBoxAndName(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget, Detail level)
+{
+    QGraphicsPolygonItem::paint(painter, option, widget);
+
+    if (level == FullDetail) {
+        // The editor draws the name while it is edited.
+        if (!m_textItem) {
+            painter->setFont(m_font);
+            painter->setPen(m_textColor);
+            painter->drawStaticText(nameRect().topLeft() + QPointF(NAME_MARGIN, NAME_MARGIN), m_nameText);
+        }
+        return;
+    }
+
+    // Draw the last name on one line, instead of the rich text.
+    QString label = shortName();
+    if (label != m_staticLabelText) {
+        m_staticLabelText = label;
+        m_staticLabel.setText(label);
+        m_staticLabel.setTextFormat(Qt::PlainText);
+        m_staticLabel.setPerformanceHint(QStaticText::AggressiveCaching);
+    }
+
+    painter->setFont(m_font);
+    painter->setPen(m_textColor);
+
+    QRectF rect = myPolygon.boundingRect();
+    QSizeF size = m_staticLabel.size();
+    painter->drawStaticText(QPointF(rect.center().x() - size.width() / 2,
+                                    rect.center().y() - size.height() / 2), m_staticLabel);
+}
 
-//    // Prevent the default "selection indicator".
-//    QStyleOptionGraphicsItem myoption = (*option);
-//    myoption.state &= !QStyle::State_Selected;
-//    QGraphicsPolygonItem::paint(painter, &myoption, widget);
-//}
+///
+/// \brief DiagramItem::shortName Get the name drawn when zoomed out.
+///
+QString DiagramItem::shortName() const
+{
+    QString label = m_lastName.isEmpty() ? m_firstName : m_lastName;
+    return label.isEmpty() ? name() : label;
+}
+
+///
+/// \brief DiagramItem::renderKey Describe everything that changes how the person looks.
+/// The key is kept until the person changes, since paint is called often.
+///
+const QString &DiagramItem::renderKey(Detail level)
+{
+    QString &key = (level == FullDetail) ? m_fullRenderKey : m_mediumRenderKey;
+    if (!key.isEmpty()) {
+        return key;
+    }
+
+    QRectF rect = boundingRect();
+    QString text = (level == FullDetail) ? m_name : shortName();
+
+    // The text goes last, so that it is not taken for a place marker.
+    key = QString("person|%1|%2|%3|%4|%5|%6|%7|%8|%9|")
+            .arg(level)
+            .arg(isSelected() ? 1 : 0)
+            .arg(rect.width())
+            .arg(rect.height())
+            .arg(brush().color().rgba())
+            .arg(brush().style())
+            .arg(pen().color().rgba())
+            .arg(pen().widthF())
+            .arg(m_textColor.rgba())
+            + m_font.key() + "|" + text;
+    return key;
+}
+
+///
+/// \brief DiagramItem::invalidateRenderKeys Make the keys again when next drawn,
+/// after the person changed how it looks.
+///
+void DiagramItem::invalidateRenderKeys()
+{
+    m_fullRenderKey.clear();
+    m_mediumRenderKey.clear();
+}
 
 void DiagramItem::updateSpousePosition()
 {
@@ -376,7 +660,7 @@ void DiagramItem::updateThumbnail()
 
     // Create thumbnail item if required
     if (!m_thumbnail) {
-        m_thumbnail = new QGraphicsPixmapItem(this);
+        m_thumbnail = new ThumbnailItem(this);
     }
 
     // Set the picture.
@@ -415,36 +699,28 @@ int DiagramItem::getWidthIncludingSpouse() const
 
 QColor DiagramItem::getTextColor() const
 {
-    return m_textItem->defaultTextColor();
+    return m_textColor;
 }
 
 void DiagramItem::setTextColor(const QColor &color)
 {
-    m_textItem->setDefaultTextColor(color);
+    m_textColor = color;
+    invalidateRenderKeys();
+    if (m_textItem) {
+        m_textItem->setDefaultTextColor(color);
+    }
+    update();
 }
 
 void DiagramItem::selectDescendants()
 {
-    // Select self.
-    setSelected(true);
-
-    // Make set of children.
-    QList<DiagramItem *> children;
-
-    // Add own children.
-    children << getChildren();
-
-    // Select spouse's descendants.
-    if (isMarried()) {
-        children << m_spouse->getChildren();
-    }
-
-    // Filter out duplicates.
-    auto childrenSet = children.toSet();
+    // Find self and descendants, including the spouse's children.
+    QVector<DiagramItem *> descendants;
+    KinshipGraph().descendants(this, descendants);
 
-    // Select descendants.
-    for (auto child: childrenSet) {
-        child->selectDescendants();
+    // Select them.
+    for (auto person: descendants) {
+        person->setSelected(true);
     }
 }
 
@@ -462,6 +738,18 @@ void DiagramItem::setBorderColor(const QColor &color)
     setPen(QPen(color, pen().width()));
 }
 
+void DiagramItem::setBrush(const QBrush &brush)
+{
+    QGraphicsPolygonItem::setBrush(brush);
+    invalidateRenderKeys();
+}
+
+void DiagramItem::setPen(const QPen &pen)
+{
+    QGraphicsPolygonItem::setPen(pen);
+    invalidateRenderKeys();
+}
+
 DiagramItem *DiagramItem::getSpouse() const
 {
     return m_spouse;
@@ -516,15 +804,26 @@ QString DiagramItem::getLastName() const
 void DiagramItem::setLastName(const QString &lastName)
 {
     m_lastName = lastName;
+    invalidateRenderKeys();
+    updateNameIndex();
 }
 
 void DiagramItem::onTextEdited()
 {
+    // Take the name from the editor, and let it go.
+    if (m_textItem) {
+        m_name = m_textItem->text();
+        m_textItem->setVisible(false);
+        m_textItem->deleteLater();
+        m_textItem = nullptr;
+        updateNameText();
+    }
+
     // Make sure the text fits in the box.
     fitToText();
 
     // Extract first and last name.
-    QString fullName = m_textItem->text();
+    QString fullName = m_name;
     int firstSpacePos = fullName.indexOf(" ");
 
     if (firstSpacePos == -1) {
@@ -536,6 +835,14 @@ void DiagramItem::onTextEdited()
         m_firstName = fullName.mid(0, firstSpacePos);
         m_lastName = fullName.mid(firstSpacePos + 1);
     }
+
+    invalidateRenderKeys();
+    updateNameIndex();
+
+    auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+    if (diagramScene) {
+        emit diagramScene->personNameChanged(this);
+    }
 }
 
 QString DiagramItem::getFirstName() const
@@ -546,6 +853,8 @@ QString DiagramItem::getFirstName() const
 void DiagramItem::setFirstName(const QString &firstName)
 {
     m_firstName = firstName;
+    invalidateRenderKeys();
+    updateNameIndex();
 }
 
 QString DiagramItem::getCountryOfBirth() const
@@ -560,49 +869,28 @@ void DiagramItem::setCountryOfBirth(const QString &countryOfBirth)
 
 bool DiagramItem::hasParent() const
 {
-    for (auto arrow : arrows) {
-        if (arrow->endItem() == this) {
-            return true;
-        }
-    }
-
-    return false;
+    return !m_parents.isEmpty();
 }
 
-QList<DiagramItem *> DiagramItem::getParents() const
+const QVector<DiagramItem *> &DiagramItem::getParents() const
 {
-    QList<DiagramItem *> parents;
-
-    for (auto arrow : arrows) {
-        if (arrow->endItem() == this) {
-            parents << arrow->startItem();
-        }
-    }
-
-    return parents;
+    return m_parents;
 }
 
-QList<DiagramItem *> DiagramItem::getChildren() const
+const QVector<DiagramItem *> &DiagramItem::getChildren() const
 {
-    QList<DiagramItem *> children;
-
-    for (auto arrow : arrows) {
-        if (arrow->startItem() == this) {
-            children << arrow->endItem();
-        }
-    }
-
-    return children;
+    return m_children;
 }
 
 void DiagramItem::fitToText()
 {
     // Calculate minimum size.
     int margin = 16;
-    int minWidth = m_textItem->boundingRect().width() + (margin * 2);
+    QSizeF textSize = nameRect().size();
+    int minWidth = textSize.width() + (margin * 2);
 
     int verticalMargin = 8;
-    int minHeight = m_textItem->boundingRect().height() + (verticalMargin * 2);
+    int minHeight = textSize.height() + (verticalMargin * 2);
 
     // Calculate best size.
     int bestWidth = qMax(DEFAULT_WIDTH, minWidth);
@@ -619,13 +907,17 @@ void DiagramItem::fitToText()
                   << QPointF(-width, -height);
 
         setPolygon(myPolygon);
+        invalidateRenderKeys();
 
         onShapeChanged();
     }
 
     // Center the text.
-    m_textItem->setX(boundingRect().center().x() - m_textItem->boundingRect().width() / 2);
-    m_textItem->setY(boundingRect().center().y() - m_textItem->boundingRect().height() / 2);
+    if (m_textItem) {
+        m_textItem->setX(boundingRect().center().x() - m_textItem->boundingRect().width() / 2);
+        m_textItem->setY(boundingRect().center().y() - m_textItem->boundingRect().height() / 2);
+    }
+    update();
 }
 
 MarriageItem *DiagramItem::getMarriageItem() const
@@ -715,6 +1007,7 @@ QDate DiagramItem::getDateOfDeath() const
 void DiagramItem::setDateOfDeath(const QDate &dateOfDeath)
 {
     m_dateOfDeath = dateOfDeath;
+    updateStatistics();
 }
 
 QDate DiagramItem::getDateOfBirth() const
@@ -725,4 +1018,5 @@ QDate DiagramItem::getDateOfBirth() const
 void DiagramItem::setDateOfBirth(const QDate &dateOfBirth)
 {
     m_dateOfBirth = dateOfBirth;
+    updateStatistics();
 }
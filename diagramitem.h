@@ -20,8 +20,11 @@
 
 #include <QGraphicsPixmapItem>
 #include <QList>
+#include <QStaticText>
 #include <QUuid>
+#include <QVector>
 #include <QDate>
+#include <QFont>
 
 QT_BEGIN_NAMESPACE
 class QPixmap;
@@ -48,6 +51,9 @@ public:
     enum DiagramType { Person };
     enum SpousePosition { SpouseToLeft, SpouseToRight };
 
+    /// How much of a person is drawn, depending on the zoom.
+    enum Detail { LowDetail, MediumDetail, FullDetail };
+
     DiagramItem(DiagramType diagramType, QMenu *contextMenu, QGraphicsItem *parent = 0);
 
     void removeArrow(Arrow *arrow);
@@ -65,8 +71,21 @@ public:
     bool canMarry(DiagramItem *potentialSpouse) const;
     QUuid id() const;
     void setId(const QUuid& value);
-    DiagramTextItem *textItem();
     void editName();
+
+    /**
+     * @brief isEditingName Check if the name is being edited in the diagram.
+     */
+    bool isEditingName() const;
+
+    QFont nameFont() const;
+    void setNameFont(const QFont &font);
+    static void setDefaultNameFont(const QFont &font);
+
+    /**
+     * @brief nameRect Get the area of the name, in item coordinates.
+     */
+    QRectF nameRect() const;
     QString bio() const;
     void setBio(const QString& value);
     QStringList photos() const;
@@ -104,8 +123,8 @@ public:
     void setCountryOfBirth(const QString &countryOfBirth);
 
     bool hasParent() const;
-    QList<DiagramItem *> getParents() const;
-    QList<DiagramItem *> getChildren() const;
+    const QVector<DiagramItem *> &getParents() const;
+    const QVector<DiagramItem *> &getChildren() const;
 
     QString getFirstName() const;
     void setFirstName(const QString &firstName);
@@ -137,22 +156,47 @@ public:
     QColor getBorderColor() const;
     void setBorderColor(const QColor &color);
 
+    /**
+     * @brief setBrush Set the fill. Hides the base version, so that the
+     * picture of the person is made again.
+     */
+    void setBrush(const QBrush &brush);
+    void setPen(const QPen &pen);
+
+    /**
+     * @brief detail Get how much to draw at the zoom of a painter.
+     * Below 30% only a box is drawn. Below 75% the box is drawn with the last
+     * name on one line, and the marriage ring. Everything is drawn from 75%.
+     */
+    static Detail detail(const QStyleOptionGraphicsItem *option, const QPainter *painter);
+
 protected:
     void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
     QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
-//    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
 
 private:
     void updateArrowPositions();
     void updateSpousePosition();
     void updateThumbnail();
+    void updateNameIndex();
+    void updateStatistics();
+    void updateNameText();
+    void paintBoxAndName(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget, Detail level);
+    QString shortName() const;
+    const QString &renderKey(Detail level);
+    void invalidateRenderKeys();
 
     DiagramType myDiagramType;
     QPolygonF myPolygon;
     QMenu *myContextMenu;
     QList<Arrow *> arrows;
-    DiagramTextItem *m_textItem;
+    DiagramTextItem *m_textItem; ///< The name editor, only while the name is edited.
+    QString m_name;
+    QFont m_font;
+    QColor m_textColor;
+    QStaticText m_nameText; ///< The name, laid out once for drawing.
     QUuid m_id;
     QString m_bio;
     QStringList m_photos;
@@ -177,6 +221,27 @@ private:
     QString m_gender;
 
     QColor m_borderColor;
+
+    // The short name drawn when zoomed out.
+    QStaticText m_staticLabel;
+    QString m_staticLabelText;
+
+    // The appearance, as found in the render cache. Empty until drawn.
+    QString m_fullRenderKey;
+    QString m_mediumRenderKey;
+
+    // Kinship links, kept in step with the arrows.
+    QVector<DiagramItem *> m_parents;
+    QVector<DiagramItem *> m_children;
+    quint32 m_kinshipMark;
+
+    // Generation numbers, cached by GenerationIndex.
+    int m_generation;
+    int m_depth;
+    quint8 m_cycleFlags;
+
+    friend class KinshipGraph;
+    friend class GenerationIndex;
 };
 
 #endif // DIAGRAMITEM_H
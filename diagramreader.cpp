@@ -0,0 +1,346 @@
+#include "diagramreader.h"
+#include "diagrambinary.h"
+
+#include <QFileDevice>
+#include <QIODevice>
+#include <QXmlStreamReader>
+
+// How often to update the progress, in elements read.
+static const int progressInterval = 1000;
+
+///
+/// \brief attributeOrDefault Get an attribute value from a stream element.
+/// \param attributes The element attributes.
+/// \param name The attribute name.
+/// \param defaultValue The value to use if the attribute is missing.
+/// \return The attribute value.
+///
+static QString attributeOrDefault(const QXmlStreamAttributes &attributes, const QString &name,
+                                  const QString &defaultValue = QString())
+{
+    if (attributes.hasAttribute(name)) {
+        return attributes.value(name).toString();
+    }
+    return defaultValue;
+}
+
+///
+/// \brief attributeColor Get a color attribute from a stream element.
+/// \param attributes The element attributes.
+/// \param name The attribute name.
+/// \return The color, or an invalid color if the attribute is missing.
+///
+static QColor attributeColor(const QXmlStreamAttributes &attributes, const QString &name)
+{
+    QColor color;
+    if (attributes.hasAttribute(name)) {
+        color.setNamedColor(attributes.value(name).toString());
+    }
+    return color;
+}
+
+DiagramReader::DiagramReader() :
+    m_cancelled(0),
+    m_percentRead(0),
+    m_width(5000),
+    m_height(5000)
+{
+
+}
+
+bool DiagramReader::read(QIODevice *device, const QString &photosFolderPath)
+{
+    m_errorString.clear();
+    m_persons.clear();
+    m_relationships.clear();
+    m_marriages.clear();
+    m_percentRead.store(0);
+
+    // Check for the binary format.
+    if (DiagramBinary::isBinary(device)) {
+        return readBinary(device, photosFolderPath);
+    }
+
+    QXmlStreamReader xml(device);
+    qint64 size = device->size();
+
+    // Check the root element.
+    if (!xml.readNextStartElement()) {
+        setParseError(xml);
+        return false;
+    }
+
+    if (xml.name() != QLatin1String("genealogy")) {
+        m_errorString = tr("The file is not an genealogy file.");
+        return false;
+    }
+
+    // Load diagram size.
+    QXmlStreamAttributes rootAttributes = xml.attributes();
+    m_width = attributeOrDefault(rootAttributes, "height", "5000").toInt();
+    m_height = attributeOrDefault(rootAttributes, "width", "5000").toInt();
+
+    // Load persons, relationships and marriages in one pass.
+    int elementCount = 0;
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("item")) {
+            m_persons << parseItemElement(xml, photosFolderPath);
+        }
+        else if (xml.name() == QLatin1String("relationship")) {
+            m_relationships << parseArrowElement(xml.attributes());
+            xml.skipCurrentElement();
+        }
+        else if (xml.name() == QLatin1String("marriage")) {
+            m_marriages << parseMarriageElement(xml.attributes());
+            xml.skipCurrentElement();
+        }
+        else {
+            xml.skipCurrentElement();
+        }
+
+        // Check for cancel and update progress.
+        if (++elementCount % progressInterval == 0) {
+            if (wasCancelled()) {
+                return false;
+            }
+            if (size > 0) {
+                m_percentRead.store(static_cast<int>(device->pos() * 100 / size));
+            }
+        }
+    }
+
+    if (xml.hasError()) {
+        setParseError(xml);
+        return false;
+    }
+
+    m_percentRead.store(100);
+
+    // Return.
+    return !wasCancelled();
+}
+
+void DiagramReader::cancel()
+{
+    m_cancelled.store(1);
+}
+
+bool DiagramReader::wasCancelled() const
+{
+    return m_cancelled.load() != 0;
+}
+
+int DiagramReader::percentRead() const
+{
+    return m_percentRead.load();
+}
+
+QString DiagramReader::errorString() const
+{
+    return m_errorString;
+}
+
+int DiagramReader::width() const
+{
+    return m_width;
+}
+
+int DiagramReader::height() const
+{
+    return m_height;
+}
+
+const QVector<PersonRecord> &DiagramReader::persons() const
+{
+    return m_persons;
+}
+
+const QVector<RelationshipRecord> &DiagramReader::relationships() const
+{
+    return m_relationships;
+}
+
+const QVector<MarriageRecord> &DiagramReader::marriages() const
+{
+    return m_marriages;
+}
+
+DiagramSnapshot DiagramReader::snapshot(const QString &photosFolderPath) const
+{
+    DiagramSnapshot diagramSnapshot;
+
+    // Undo the swap made when reading.
+    diagramSnapshot.width = m_height;
+    diagramSnapshot.height = m_width;
+    diagramSnapshot.photosFolderPath = photosFolderPath;
+    diagramSnapshot.persons = m_persons;
+    diagramSnapshot.relationships = m_relationships;
+    diagramSnapshot.marriages = m_marriages;
+
+    return diagramSnapshot;
+}
+
+bool DiagramReader::readBinary(QIODevice *device, const QString &photosFolderPath)
+{
+    qint64 size = device->size();
+    const uchar *data = nullptr;
+    QByteArray bytes;
+
+    // Map the file if possible, to avoid copying it.
+    QFileDevice *file = qobject_cast<QFileDevice *>(device);
+    if (file) {
+        data = file->map(0, size);
+    }
+
+    bool mapped = (data != nullptr);
+    if (!mapped) {
+        bytes = device->readAll();
+        data = reinterpret_cast<const uchar *>(bytes.constData());
+        size = bytes.size();
+    }
+
+    DiagramSnapshot contents;
+    bool ok = DiagramBinary::read(data, size, photosFolderPath, contents, &m_errorString);
+
+    if (mapped) {
+        file->unmap(const_cast<uchar *>(data));
+    }
+
+    if (!ok) {
+        return false;
+    }
+
+    // Load diagram size, the same way as the XML root element.
+    m_width = static_cast<int>(contents.height);
+    m_height = static_cast<int>(contents.width);
+    m_persons = contents.persons;
+    m_relationships = contents.relationships;
+    m_marriages = contents.marriages;
+
+    m_percentRead.store(100);
+
+    // Return.
+    return !wasCancelled();
+}
+
+PersonRecord DiagramReader::parseItemElement(QXmlStreamReader &xml, const QString &photosFolderPath)
+{
+    const QXmlStreamAttributes attributes = xml.attributes();
+    PersonRecord record;
+
+    record.pos.setX(attributes.value("x").toDouble());
+    record.pos.setY(attributes.value("y").toDouble());
+    record.firstName = attributes.value("first_name").toString();
+    record.lastName = attributes.value("last_name").toString();
+    record.name = attributes.value("name").toString();
+
+    if (attributes.hasAttribute("id")) {
+        record.id = QUuid(attributes.value("id").toString());
+    }
+
+    record.bio = attributes.value("bio").toString();
+    record.placeOfBirth = attributes.value("place_of_birth").toString();
+    record.countryOfBirth = attributes.value("country_of_birth").toString();
+    record.placeOfDeath = attributes.value("place_of_death").toString();
+    record.gender = attributes.value("gender").toString();
+
+    if (attributes.hasAttribute("date_of_birth")) {
+        record.dateOfBirth = DiagramRecords::parseDate(attributes.value("date_of_birth").toString());
+        record.hasDateOfBirth = true;
+    }
+    if (attributes.hasAttribute("date_of_death")) {
+        record.dateOfDeath = DiagramRecords::parseDate(attributes.value("date_of_death").toString());
+        record.hasDateOfDeath = true;
+    }
+
+    record.fillColor = attributeColor(attributes, "fill_color");
+    record.textColor = attributeColor(attributes, "text_color");
+    record.borderColor = attributeColor(attributes, "border_color");
+
+    // Check for GEDCOM pointer.
+    record.pointer = attributes.value("pointer").toString();
+
+    // Read the photos up to the end of the element.
+    while (xml.readNextStartElement()) {
+        if (xml.name() != QLatin1String("photo")) {
+            xml.skipCurrentElement();
+            continue;
+        }
+
+        QXmlStreamAttributes photoAttributes = xml.attributes();
+
+        // Get the path.
+        QString path = photoAttributes.value("path").toString();
+
+        // Check for relative (project dir) path.
+        if (photoAttributes.hasAttribute("project_dir_path")) {
+
+            // Use the relative path.
+            path = photoAttributes.value("project_dir_path").toString();
+
+            // Hack: Prepend photos folder.
+            path.prepend(photosFolderPath + "/");
+        }
+
+        // Add to the person.
+        record.photos << path;
+        xml.skipCurrentElement();
+    }
+
+    return record;
+}
+
+RelationshipRecord DiagramReader::parseArrowElement(const QXmlStreamAttributes &attributes)
+{
+    RelationshipRecord record;
+
+    if (attributes.hasAttribute("from_pointer") && attributes.hasAttribute("to_pointer")) {
+        // GEDCOM import.
+        record.fromPointer = attributes.value("from_pointer").toString();
+        record.toPointer = attributes.value("to_pointer").toString();
+    }
+    else {
+        // Normal diagram.
+        record.from = QUuid(attributes.value("from").toString());
+        record.to = QUuid(attributes.value("to").toString());
+    }
+
+    record.color = attributeColor(attributes, "color");
+
+    return record;
+}
+
+MarriageRecord DiagramReader::parseMarriageElement(const QXmlStreamAttributes &attributes)
+{
+    MarriageRecord record;
+    record.pos.setX(attributes.value("x").toDouble());
+    record.pos.setY(attributes.value("y").toDouble());
+
+    if (attributes.hasAttribute("left_pointer") && attributes.hasAttribute("right_pointer")) {
+        // GEDCOM import.
+        record.leftPointer = attributes.value("left_pointer").toString();
+        record.rightPointer = attributes.value("right_pointer").toString();
+    }
+    else {
+        // Normal diagram.
+        record.personLeft = QUuid(attributes.value("person_left").toString());
+        record.personRight = QUuid(attributes.value("person_right").toString());
+    }
+
+    if (attributes.hasAttribute("date")) {
+        record.date = QDate::fromString(attributes.value("date").toString());
+        record.hasDate = true;
+    }
+    record.place = attributes.value("place").toString();
+
+    return record;
+}
+
+void DiagramReader::setParseError(const QXmlStreamReader &xml)
+{
+    m_errorString = tr("Parse error at line %1, column %2:\n%3")
+            .arg(xml.lineNumber())
+            .arg(xml.columnNumber())
+            .arg(xml.errorString());
+}
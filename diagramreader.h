@@ -0,0 +1,82 @@
+#ifndef DIAGRAMREADER_H
+#define DIAGRAMREADER_H
+
+#include "diagramrecords.h"
+#include "diagramwriter.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+class QXmlStreamAttributes;
+class QXmlStreamReader;
+QT_END_NAMESPACE
+
+/**
+ * @brief The DiagramReader class reads a genealogy XML file into plain records.
+ * It does not touch the scene, so it can run on a worker thread.
+ */
+class DiagramReader
+{
+    Q_DECLARE_TR_FUNCTIONS(DiagramReader)
+
+public:
+    DiagramReader();
+
+    /**
+     * @brief read Read the file, in either the XML or the binary format.
+     * @param device The file to read.
+     * @param photosFolderPath The path to photos for the project.
+     * @return True if read OK, false if there was an error or the read was cancelled.
+     */
+    bool read(QIODevice *device, const QString &photosFolderPath);
+
+    /**
+     * @brief cancel Stop reading. Can be called from any thread.
+     */
+    void cancel();
+
+    bool wasCancelled() const;
+
+    /**
+     * @brief percentRead Get the progress of the read. Can be called from any thread.
+     * @return The percentage of the file read so far.
+     */
+    int percentRead() const;
+
+    QString errorString() const;
+
+    int width() const;
+    int height() const;
+    const QVector<PersonRecord> &persons() const;
+    const QVector<RelationshipRecord> &relationships() const;
+    const QVector<MarriageRecord> &marriages() const;
+
+    /**
+     * @brief snapshot Get the records read, ready to be written again unchanged.
+     * @param photosFolderPath The path to photos for the file to write.
+     * @return The snapshot.
+     */
+    DiagramSnapshot snapshot(const QString &photosFolderPath) const;
+
+private:
+    bool readBinary(QIODevice *device, const QString &photosFolderPath);
+    PersonRecord parseItemElement(QXmlStreamReader &xml, const QString &photosFolderPath);
+    RelationshipRecord parseArrowElement(const QXmlStreamAttributes &attributes);
+    MarriageRecord parseMarriageElement(const QXmlStreamAttributes &attributes);
+    void setParseError(const QXmlStreamReader &xml);
+
+    QAtomicInt m_cancelled;
+    QAtomicInt m_percentRead;
+    QString m_errorString;
+
+    int m_width;
+    int m_height;
+    QVector<PersonRecord> m_persons;
+    QVector<RelationshipRecord> m_relationships;
+    QVector<MarriageRecord> m_marriages;
+};
+
+#endif // DIAGRAMREADER_H
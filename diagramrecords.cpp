@@ -0,0 +1,28 @@
+#include "diagramrecords.h"
+
+#include <QDebug>
+
+QDate DiagramRecords::parseDate(const QString &string)
+{
+    // Try parsing as a normal date.
+    QDate date = QDate::fromString(string);
+
+    if (!date.isValid())
+    {
+        // Try parsing as a GEDCOM date.
+        date = QDate::fromString(string, "d MMM yyyy");
+    }
+
+//    if (!date.isValid())
+//    {
+//        // Try parsing as a year only.
+//        date = QDate::fromString(string, "yyyy");
+//    }
+
+    if (!date.isValid())
+    {
+        qDebug() << "Invalid date in file:" << string;
+    }
+
+    return date;
+}
@@ -0,0 +1,79 @@
+#ifndef DIAGRAMRECORDS_H
+#define DIAGRAMRECORDS_H
+
+#include <QColor>
+#include <QDate>
+#include <QPointF>
+#include <QString>
+#include <QStringList>
+#include <QUuid>
+
+/**
+ * @brief The PersonRecord struct holds the details of a person read from a file,
+ * before the person is added to the scene.
+ */
+struct PersonRecord
+{
+    QUuid id; ///< A new ID is created if null.
+    QString pointer; ///< The GEDCOM pointer, if imported.
+    QPointF pos;
+    QString firstName;
+    QString lastName;
+    QString name;
+    QString bio;
+    QDate dateOfBirth;
+    bool hasDateOfBirth = false;
+    QString placeOfBirth;
+    QString countryOfBirth;
+    QDate dateOfDeath;
+    bool hasDateOfDeath = false;
+    QString placeOfDeath;
+    QString gender;
+    QColor fillColor; ///< Invalid means the default.
+    QColor textColor; ///< Invalid means the default.
+    QColor borderColor; ///< Invalid means the default.
+    QStringList photos;
+};
+
+/**
+ * @brief The RelationshipRecord struct links a parent to a child, either by
+ * ID or by GEDCOM pointer.
+ */
+struct RelationshipRecord
+{
+    QUuid from;
+    QUuid to;
+    QString fromPointer;
+    QString toPointer;
+    QColor color; ///< Invalid means the scene line color.
+};
+
+/**
+ * @brief The MarriageRecord struct links two spouses, either by ID or by
+ * GEDCOM pointer.
+ */
+struct MarriageRecord
+{
+    QPointF pos; ///< Only written. The ring is placed between the spouses.
+    QUuid personLeft;
+    QUuid personRight;
+    QString leftPointer;
+    QString rightPointer;
+    QDate date;
+    bool hasDate = false;
+    QString place;
+};
+
+class DiagramRecords
+{
+public:
+    /**
+     * @brief parseDate Parse a date from a file, either in the Qt text format
+     * or the GEDCOM "d MMM yyyy" format.
+     * @param string The date string.
+     * @return The date, or an invalid date.
+     */
+    static QDate parseDate(const QString &string);
+};
+
+#endif // DIAGRAMRECORDS_H
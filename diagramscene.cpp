@@ -17,8 +17,14 @@
 
 #include "diagramscene.h"
 #include "arrow.h"
-#include "fileutils.h"
+#include "diagrambinary.h"
+#include "diagramreader.h"
+#include "diagramwriter.h"
+#include "edgelayer.h"
+#include "generationindex.h"
+#include "kinshipgraph.h"
 #include "marriageitem.h"
+#include "rendercache.h"
 #include "undo/changebordercolorundo.h"
 #include "undo/changefillcolorundo.h"
 #include "undo/changelinecolorundo.h"
@@ -28,45 +34,17 @@
 
 #include <QDebug>
 #include <QDir>
-#include <QDomDocument>
 #include <QTextCursor>
-#include <QTextStream>
 #include <QGraphicsSceneMouseEvent>
 #include <QMessageBox>
 #include <QGraphicsSceneDragDropEvent>
+#include <QHash>
 #include <QMimeData>
+#include <QSet>
 #include <QSettings>
 #include <QTimer>
 
-///
-/// \brief parseXmlDate Parse the string from an XML file into a date.
-/// \param string The attribute value.
-/// \return The date object.
-///
-static QDate parseXmlDate(const QString &string)
-{
-    // Try parsing as a normal date.
-    QDate date = QDate::fromString(string);
-
-    if (!date.isValid())
-    {
-        // Try parsing as a GEDCOM date.
-        date = QDate::fromString(string, "d MMM yyyy");
-    }
-
-//    if (!date.isValid())
-//    {
-//        // Try parsing as a year only.
-//        date = QDate::fromString(string, "yyyy");
-//    }
-
-    if (!date.isValid())
-    {
-        qDebug() << "Invalid date in XML:" << string;
-    }
-
-    return date;
-}
+#include <algorithm>
 
 //! [0]
 DiagramScene::DiagramScene(QMenu *itemMenu, QObject *parent)
@@ -82,11 +60,16 @@ DiagramScene::DiagramScene(QMenu *itemMenu, QObject *parent)
     myLineColor = Qt::black;
     m_highlightedItem = nullptr;
     m_nextId = 1;
+    m_edgeLayer = nullptr;
+    m_selectingAll = false;
+    m_loading = false;
 
     m_searchHighlightTimer = new QTimer(this);
     connect(m_searchHighlightTimer, SIGNAL(timeout()), this, SLOT(removeSearchHighlight()));
 
     m_window = nullptr;
+
+    connect(this, SIGNAL(selectionChanged()), this, SLOT(onSelectionChanged()));
 }
 //! [0]
 
@@ -176,58 +159,203 @@ void DiagramScene::setFont(const QFont &font)
 ///
 bool DiagramScene::open(QIODevice *device, const QString &photosFolderPath)
 {
-    QString errorStr;
-    int errorLine;
-    int errorColumn;
-
-    QDomDocument domDocument;
-    if (!domDocument.setContent(device, true, &errorStr, &errorLine,
-                                &errorColumn)) {
-        QMessageBox::information(window(), tr("Genealogy Maker"),
-                                 tr("Parse error at line %1, column %2:\n%3")
-                                 .arg(errorLine)
-                                 .arg(errorColumn)
-                                 .arg(errorStr));
+    DiagramReader reader;
+    if (!reader.read(device, photosFolderPath)) {
+        QMessageBox::information(window(), tr("Genealogy Maker"), reader.errorString());
         return false;
     }
 
-    QDomElement root = domDocument.documentElement();
-    if (root.tagName() != "genealogy") {
-        QMessageBox::information(window(), tr("Genealogy Maker"),
-                                 tr("The file is not an genealogy file."));
-        return false;
+    populate(reader);
+
+    // Return.
+    return true;
+}
+
+void DiagramScene::populate(const DiagramReader &reader)
+{
+    beginLoad(reader.width(), reader.height());
+    reservePersons(reader.persons().size());
+
+    for (const PersonRecord &record: reader.persons()) {
+        addPerson(record);
+    }
+
+    populateLinks(reader);
+}
+
+void DiagramScene::populateLinks(const DiagramReader &reader)
+{
+    for (const RelationshipRecord &record: reader.relationships()) {
+        addRelationship(record);
     }
 
+    for (const MarriageRecord &record: reader.marriages()) {
+        addMarriage(record);
+    }
+
+    // All details are read now.
+    buildTextIndex();
+}
+
+void DiagramScene::beginLoad(int width, int height)
+{
+    // Keep the edge layer, since clearing deletes all items.
+    if (m_edgeLayer) {
+        removeItem(m_edgeLayer);
+        m_edgeLayer->clear();
+    }
+
+    // Persons are indexed by text all at once, when the load is done.
+    m_loading = true;
+
     clear();
+    m_itemsDict.clear();
+    m_pointerDict.clear();
+    m_nameIndex.clear();
+    m_phoneticIndex.clear();
+    m_textIndex.clear();
+    m_statistics.clear();
+    m_persons.clear();
+    m_arrows.clear();
+    m_marriages.clear();
+
+    if (m_edgeLayer) {
+        addItem(m_edgeLayer);
+    }
+
     emit cleared();
 
-    // Load diagram size.
-    int diagramWidth = root.attribute("height", "5000").toInt();
-    int diagramHeight = root.attribute("width", "5000").toInt();
-    setSceneRect(0, 0, diagramWidth, diagramHeight);
+    setSceneRect(0, 0, width, height);
+}
 
-    // Load persons.
-    QDomElement child = root.firstChildElement("item");
-    while (!child.isNull()) {
-        parseItemElement(child, photosFolderPath);
-        child = child.nextSiblingElement("item");
+void DiagramScene::reservePersons(int count, bool byPointer)
+{
+    m_itemsDict.reserve(count);
+    if (byPointer) {
+        m_pointerDict.reserve(count);
     }
+}
 
-    // Load relationships.
-    child = root.firstChildElement("relationship");
-    while (!child.isNull()) {
-        parseArrowElement(child);
-        child = child.nextSiblingElement("relationship");
+DiagramItem *DiagramScene::addPerson(const PersonRecord &record)
+{
+    auto item = new DiagramItem(DiagramItem::Person, myItemMenu);
+    item->setBrush(Qt::white);
+
+    QUuid id = record.id;
+    if (id.isNull()) {
+        id = QUuid::createUuid();
     }
 
-    // Load marriages.
-    child = root.firstChildElement("marriage");
-    while (!child.isNull()) {
-        parseMarriageElement(child);
-        child = child.nextSiblingElement("marriage");
+    item->setPos(record.pos);
+    item->setFirstName(record.firstName);
+    item->setLastName(record.lastName);
+    item->setName(record.name);
+    item->setId(id);
+    item->setBio(record.bio);
+    item->setPlaceOfBirth(record.placeOfBirth);
+    item->setCountryOfBirth(record.countryOfBirth);
+    item->setPlaceOfDeath(record.placeOfDeath);
+    item->setGender(record.gender);
+
+    if (record.hasDateOfBirth) {
+        item->setDateOfBirth(record.dateOfBirth);
+    }
+    if (record.hasDateOfDeath) {
+        item->setDateOfDeath(record.dateOfDeath);
     }
 
-    // Return.
+    if (record.fillColor.isValid()) {
+        item->setBrush(record.fillColor);
+    }
+    if (record.textColor.isValid()) {
+        item->setTextColor(record.textColor);
+    }
+    if (record.borderColor.isValid()) {
+        item->setBorderColor(record.borderColor);
+    }
+
+    item->setPhotos(record.photos);
+
+    // Add to the scene last, so the indexes and statistics take the person
+    // once, with all the details set.
+    addItem(item);
+
+    emit itemInserted(item, true);
+    m_itemsDict.insert(id, item);
+
+    if (!record.pointer.isEmpty()) {
+        m_pointerDict.insert(record.pointer, item);
+    }
+
+    return item;
+}
+
+bool DiagramScene::addRelationship(const RelationshipRecord &record)
+{
+    DiagramItem *startItem = nullptr;
+    DiagramItem *endItem = nullptr;
+
+    if (!record.fromPointer.isEmpty() || !record.toPointer.isEmpty()) {
+        // GEDCOM import.
+        startItem = m_pointerDict.value(record.fromPointer);
+        endItem = m_pointerDict.value(record.toPointer);
+    }
+    else {
+        // Normal diagram.
+        startItem = m_itemsDict.value(record.from);
+        endItem = m_itemsDict.value(record.to);
+    }
+
+    if (!startItem || !endItem) {
+        return false;
+    }
+
+    Arrow *arrow = new Arrow(startItem, endItem);
+
+    if (record.color.isValid()) {
+        arrow->setColor(record.color);
+    }
+    else {
+        arrow->setColor(myLineColor);
+    }
+
+    startItem->addArrow(arrow);
+    endItem->addArrow(arrow);
+    arrow->setZValue(-1000.0);
+    addItem(arrow);
+    arrow->updatePosition();
+
+    return true;
+}
+
+bool DiagramScene::addMarriage(const MarriageRecord &record)
+{
+    DiagramItem *personLeft = nullptr;
+    DiagramItem *personRight = nullptr;
+
+    if (!record.leftPointer.isEmpty() || !record.rightPointer.isEmpty()) {
+        // GEDCOM import.
+        personLeft = m_pointerDict.value(record.leftPointer);
+        personRight = m_pointerDict.value(record.rightPointer);
+    }
+    else {
+        // Normal diagram.
+        personLeft = m_itemsDict.value(record.personLeft);
+        personRight = m_itemsDict.value(record.personRight);
+    }
+
+    if (!personLeft || !personRight) {
+        return false;
+    }
+
+    personLeft->marryTo(personRight);
+    MarriageItem *marriage = personLeft->getMarriageItem();
+
+    if (record.hasDate) {
+        marriage->setDate(record.date);
+    }
+    marriage->setPlace(record.place);
+
     return true;
 }
 
@@ -239,150 +367,333 @@ void DiagramScene::print()
     }
 }
 
-void DiagramScene::save(QIODevice *device, const QString &photosFolderPath)
+void DiagramScene::save(QIODevice *device, const QString &photosFolderPath, bool binary)
 {
-    const int indentSize = 4;
+    DiagramSnapshot diagramSnapshot = snapshot(photosFolderPath);
+    DiagramWriter::copyPhotos(diagramSnapshot);
 
-    QTextStream out(device);
-    QDomDocument domDocument;
-    QDomElement rootElement = domDocument.createElement("genealogy");
-    QList<Arrow *> arrows;
+    if (binary) {
+        DiagramBinary::write(diagramSnapshot, device);
+    }
+    else {
+        DiagramWriter::write(diagramSnapshot, device);
+    }
+
+    applyPhotos(diagramSnapshot);
+}
+
+DiagramSnapshot DiagramScene::snapshot(const QString &photosFolderPath, bool sharedPhotoStore)
+{
+    DiagramSnapshot diagramSnapshot;
+    QVector<Arrow *> arrows;
 
     //
-    // Save diagram information.
+    // Diagram information.
     //
     auto diagramRect = sceneRect();
-    rootElement.setAttribute("width", diagramRect.width());
-    rootElement.setAttribute("height", diagramRect.height());
+    diagramSnapshot.width = diagramRect.width();
+    diagramSnapshot.height = diagramRect.height();
+    diagramSnapshot.photosFolderPath = photosFolderPath;
 
     // Check if photos should be copied.
     bool copyPhotos = !photosFolderPath.isEmpty();
 
     //
-    // Save persons.
+    // Persons and marriages.
     //
-    for (auto item: items()) {
-        DiagramItem *diagramItem = dynamic_cast<DiagramItem*> (item);
-
-        if (diagramItem) {
-            QDomElement itemElement = domDocument.createElement("item");
-            itemElement.setAttribute("x", item->pos().x());
-            itemElement.setAttribute("y", item->pos().y());
-            itemElement.setAttribute("first_name", diagramItem->getFirstName());
-            itemElement.setAttribute("last_name", diagramItem->getLastName());
-            itemElement.setAttribute("name", diagramItem->name());
-            itemElement.setAttribute("id", diagramItem->id().toString());
-            itemElement.setAttribute("bio", diagramItem->bio());
-//            if (diagramItem->isDateOfBirthKnown()) {
-                itemElement.setAttribute("date_of_birth", diagramItem->getDateOfBirth().toString());
-//            }
-            itemElement.setAttribute("place_of_birth", diagramItem->getPlaceOfBirth());
-            itemElement.setAttribute("country_of_birth", diagramItem->getCountryOfBirth());
-//            if (diagramItem->isDateOfDeathKnown()) {
-                itemElement.setAttribute("date_of_death", diagramItem->getDateOfDeath().toString());
-//            }
-            itemElement.setAttribute("place_of_death", diagramItem->getPlaceOfDeath());
-            itemElement.setAttribute("fill_color", diagramItem->brush().color().name());
-            itemElement.setAttribute("text_color", diagramItem->getTextColor().name());
-            itemElement.setAttribute("border_color", diagramItem->getBorderColor().name());
-
-            // Copy photos to project directory if required.
-            if (copyPhotos) {
-                copyPhotosForPerson(diagramItem, QDir(photosFolderPath));
-            }
-
-            // Save photo file names.
-            for (QString photo: diagramItem->photos()) {
-                QDomElement photoElement = domDocument.createElement("photo");
-
-                // Hack: remove folder path to save relative file name.
-                if (copyPhotos) {
-                    QString prefix = photosFolderPath + "/";
+    diagramSnapshot.persons.reserve(m_persons.size());
+    diagramSnapshot.photosBefore.reserve(m_persons.size());
+    diagramSnapshot.marriages.reserve(m_marriages.size());
+
+    for (MarriageItem *marriage: m_marriages.items()) {
+        MarriageRecord record;
+        record.pos = marriage->pos();
+        record.personLeft = marriage->personLeft()->id();
+        record.personRight = marriage->personRight()->id();
+        record.date = marriage->getDate();
+        record.hasDate = true;
+        record.place = marriage->getPlace();
+        diagramSnapshot.marriages << record;
+    }
 
-                    if (photo.startsWith(prefix)) {
-                        QString relativePath = photo;
-                        relativePath.remove(prefix);
-                        photoElement.setAttribute("project_dir_path", relativePath);
-                    }
-                }
+    for (DiagramItem *diagramItem: m_persons.items()) {
+        PersonRecord record;
+        record.id = diagramItem->id();
+        record.pos = diagramItem->pos();
+        record.firstName = diagramItem->getFirstName();
+        record.lastName = diagramItem->getLastName();
+        record.name = diagramItem->name();
+        record.bio = diagramItem->bio();
+        record.dateOfBirth = diagramItem->getDateOfBirth();
+        record.hasDateOfBirth = true;
+        record.placeOfBirth = diagramItem->getPlaceOfBirth();
+        record.countryOfBirth = diagramItem->getCountryOfBirth();
+        record.dateOfDeath = diagramItem->getDateOfDeath();
+        record.hasDateOfDeath = true;
+        record.placeOfDeath = diagramItem->getPlaceOfDeath();
+        record.gender = diagramItem->getGender();
+        record.fillColor = diagramItem->brush().color();
+        record.textColor = diagramItem->getTextColor();
+        record.borderColor = diagramItem->getBorderColor();
+        record.photos = diagramItem->photos();
+
+        diagramSnapshot.photosBefore << record.photos;
+
+        // Plan the copies to the project directory if required.
+        if (copyPhotos) {
+            planPhotoCopies(record, diagramSnapshot.persons.size(), QDir(photosFolderPath),
+                            sharedPhotoStore, diagramSnapshot.photoCopies);
+        }
 
-                photoElement.setAttribute("path", photo);
-                itemElement.appendChild(photoElement);
-            }
+        diagramSnapshot.persons << record;
 
-            // Save gender.
-            if (diagramItem->isGenderKnown()) {
-                itemElement.setAttribute("gender", diagramItem->getGender());
+        // Each arrow is saved once, with its start item.
+        for (auto arrow: diagramItem->getArrows()) {
+            if (arrow->startItem() == diagramItem) {
+                arrows << arrow;
             }
-
-            rootElement.appendChild(itemElement);
-
-            arrows << diagramItem->getArrows();
         }
     }
 
     //
-    // Save relationships.
+    // Relationships.
     //
-    auto arrowSet = QSet<Arrow *>::fromList(arrows);
-    for (auto arrow: arrowSet) {
-        QDomElement element = domDocument.createElement("relationship");
-        element.setAttribute("from", arrow->startItem()->id().toString());
-        element.setAttribute("to", arrow->endItem()->id().toString());
-        element.setAttribute("color", arrow->getColor().name());
-        rootElement.appendChild(element);
+    for (auto arrow: arrows) {
+        RelationshipRecord record;
+        record.from = arrow->startItem()->id();
+        record.to = arrow->endItem()->id();
+        record.color = arrow->getColor();
+        diagramSnapshot.relationships << record;
     }
 
-    //
-    // Save marriages.
-    //
-    for (auto item: items()) {
-        if (item->type() == MarriageItem::Type) {
-            MarriageItem *marriage = dynamic_cast<MarriageItem*> (item);
-            QDomElement element = domDocument.createElement("marriage");
-            element.setAttribute("x", marriage->pos().x());
-            element.setAttribute("y", marriage->pos().y());
-            element.setAttribute("person_left", marriage->personLeft()->id().toString());
-            element.setAttribute("person_right", marriage->personRight()->id().toString());
-//            if (marriage->isDateKnown()) {
-                element.setAttribute("date", marriage->getDate().toString());
-//            }
-            element.setAttribute("place", marriage->getPlace());
-
-            rootElement.appendChild(element);
+    return diagramSnapshot;
+}
+
+void DiagramScene::applyPhotos(const DiagramSnapshot &diagramSnapshot)
+{
+    for (int i = 0; i < diagramSnapshot.persons.size(); ++i) {
+        const PersonRecord &record = diagramSnapshot.persons[i];
+        const QStringList &photosBefore = diagramSnapshot.photosBefore[i];
+
+        if (record.photos == photosBefore) {
+            continue;
         }
-    }
 
-    domDocument.appendChild(rootElement);
-    domDocument.save(out, indentSize);
+        // Skip persons that were removed or given other photos since the snapshot.
+        DiagramItem *item = m_itemsDict.value(record.id);
+        if (item && item->scene() == this && item->photos() == photosBefore) {
+            item->setPhotos(record.photos);
+        }
+    }
 }
 
 DiagramItem *DiagramScene::itemWithId(const QUuid& id)
 {
-    return m_itemsDict[id];
+    return m_itemsDict.value(id);
 }
 
 bool DiagramScene::isEmpty() const
 {
-    return items().isEmpty();
+    return m_persons.size() == 0;
 }
 
+/**
+ * @brief DiagramScene::firstItem Get the first person added to the diagram.
+ * @return The person, or null if the diagram is empty.
+ */
 QGraphicsItem *DiagramScene::firstItem() const
 {
-    return items().first();
+    return m_statistics.firstPerson();
+}
+
+/**
+ * @brief DiagramScene::nameIndex Get the index of person names, kept up to
+ * date as persons are added, removed and renamed.
+ * @return The index.
+ */
+NameIndex &DiagramScene::nameIndex()
+{
+    return m_nameIndex;
+}
+
+/**
+ * @brief DiagramScene::phoneticIndex Get the index of names by sound and
+ * spelling, kept up to date like the name index.
+ * @return The index.
+ */
+PhoneticIndex &DiagramScene::phoneticIndex()
+{
+    return m_phoneticIndex;
+}
+
+/**
+ * @brief DiagramScene::textIndex Get the index of biographies and places.
+ * It is updated when person details are edited, and rebuilt on load.
+ * @return The index.
+ */
+TextIndex &DiagramScene::textIndex()
+{
+    return m_textIndex;
+}
+
+/**
+ * @brief DiagramScene::statistics Get the counts and totals of the diagram,
+ * kept up to date as items are added and removed.
+ * @return The statistics.
+ */
+SceneStatistics &DiagramScene::statistics()
+{
+    return m_statistics;
+}
+
+const SceneStatistics &DiagramScene::statistics() const
+{
+    return m_statistics;
+}
+
+const QVector<DiagramItem *> &DiagramScene::persons() const
+{
+    return m_persons.items();
+}
+
+const QVector<Arrow *> &DiagramScene::arrows() const
+{
+    return m_arrows.items();
+}
+
+const QVector<MarriageItem *> &DiagramScene::marriages() const
+{
+    return m_marriages.items();
+}
+
+/**
+ * @brief DiagramScene::registerPerson List a person that joined the scene,
+ * and add them to the indexes and statistics.
+ * @param person The person.
+ */
+void DiagramScene::registerPerson(DiagramItem *person)
+{
+    m_persons.insert(person);
+    m_nameIndex.insert(person);
+    m_phoneticIndex.insert(person);
+    if (!m_loading) {
+        m_textIndex.update(person);
+    }
+    m_statistics.updatePerson(person);
+}
+
+/**
+ * @brief DiagramScene::unregisterPerson Remove a person that is leaving the
+ * scene from the list, indexes and statistics.
+ * @param person The person.
+ */
+void DiagramScene::unregisterPerson(DiagramItem *person)
+{
+    m_persons.remove(person);
+    m_nameIndex.remove(person);
+    m_phoneticIndex.remove(person);
+    m_textIndex.remove(person);
+    m_statistics.removePerson(person);
+}
+
+void DiagramScene::registerArrow(Arrow *arrow)
+{
+    m_arrows.insert(arrow);
+
+    if (m_edgeLayer) {
+        m_edgeLayer->addArrow(arrow);
+    }
+    else {
+        // It may have been hidden in the layer before it was removed.
+        arrow->setVisible(true);
+    }
+}
+
+void DiagramScene::unregisterArrow(Arrow *arrow)
+{
+    m_arrows.remove(arrow);
+
+    if (m_edgeLayer) {
+        m_edgeLayer->removeArrow(arrow);
+    }
+}
+
+EdgeLayer *DiagramScene::edgeLayer() const
+{
+    return m_edgeLayer;
+}
+
+void DiagramScene::setBatchArrows(bool batch)
+{
+    if (batch == (m_edgeLayer != nullptr)) {
+        return;
+    }
+
+    if (batch) {
+        m_edgeLayer = new EdgeLayer();
+        addItem(m_edgeLayer);
+        for (Arrow *arrow: m_arrows.items()) {
+            m_edgeLayer->addArrow(arrow);
+        }
+    }
+    else {
+        for (Arrow *arrow: m_arrows.items()) {
+            arrow->setVisible(true);
+        }
+        delete m_edgeLayer;
+        m_edgeLayer = nullptr;
+    }
+}
+
+void DiagramScene::registerMarriage(MarriageItem *marriage)
+{
+    m_marriages.insert(marriage);
+}
+
+void DiagramScene::unregisterMarriage(MarriageItem *marriage)
+{
+    m_marriages.remove(marriage);
+}
+
+void DiagramScene::buildTextIndex()
+{
+    m_textIndex.build(m_persons.items().toList());
+    m_loading = false;
 }
 
 void DiagramScene::selectAll()
 {
-    for (auto item: items()) {
-        item->setSelected(true);
+    // Hidden arrows cannot be selected, so show those drawn by the layer.
+    if (m_edgeLayer) {
+        m_edgeLayer->showAll();
+    }
+
+    // Walk the lists instead of all items. Free text cannot be inserted, and
+    // name editors and the edge layer cannot be selected.
+    m_selectingAll = true;
+    for (DiagramItem *person: m_persons.items()) {
+        person->setSelected(true);
+    }
+    for (Arrow *arrow: m_arrows.items()) {
+        arrow->setSelected(true);
+    }
+    for (MarriageItem *marriage: m_marriages.items()) {
+        marriage->setSelected(true);
+    }
+    m_selectingAll = false;
+}
+
+void DiagramScene::showArrowsIn(const QPainterPath &area)
+{
+    if (m_edgeLayer) {
+        m_edgeLayer->showArrowsIn(area);
     }
 }
 
 void DiagramScene::addPersonFromUndo(DiagramItem *item)
 {
     addItem(item);
-    m_itemsDict[item->id()] = item;
+    m_itemsDict.insert(item->id(), item);
     emit itemInserted(item, false);
 }
 
@@ -411,6 +722,8 @@ void DiagramScene::loadPreferences()
 
     int arrowLineWidth = settings.value("diagram/arrowLineWidth", 2).toInt();
     bool showThumbnails = settings.value("diagram/showThumbnails", true).toBool();
+    bool batchArrows = settings.value("diagram/batchArrows", false).toBool();
+    bool renderCache = settings.value("diagram/renderCache", true).toBool();
 
     QString fontFamily = settings.value("diagram/fontFamily", "").toString();
     qreal fontSize = settings.value("diagram/fontSize", 0).toReal();
@@ -420,64 +733,31 @@ void DiagramScene::loadPreferences()
     if (fontIsValid) {
         font.setFamily(fontFamily);
         font.setPointSizeF(fontSize);
-        DiagramTextItem::setDefaultFont(font);
+        DiagramItem::setDefaultNameFont(font);
     }
 
-    for (auto item: items()) {
-        if (item->type() == Arrow::Type) {
-            Arrow *arrow = qgraphicsitem_cast<Arrow*> (item);
-            arrow->setLineWidth(arrowLineWidth);
-        }
-        else if (item->type() == DiagramItem::Type) {
-            DiagramItem *person= qgraphicsitem_cast<DiagramItem*> (item);
-            person->setShowThumbnail(showThumbnails);
+    for (Arrow *arrow: m_arrows.items()) {
+        arrow->setLineWidth(arrowLineWidth);
+    }
 
-            if (fontIsValid) {
-                person->textItem()->setFont(font);
-                person->fitToText();
-            }
+    for (DiagramItem *person: m_persons.items()) {
+        person->setShowThumbnail(showThumbnails);
+
+        // Only lay out names again if the font changed.
+        if (fontIsValid && person->nameFont() != font) {
+            person->setNameFont(font);
+            person->fitToText();
         }
     }
 
     Arrow::setDefaultLineWidth(arrowLineWidth);
     DiagramItem::setShowThumbnailByDefault(showThumbnails);
-}
-
-int DiagramScene::autoLayoutRow(const QList<DiagramItem *> &items, int startY) {
-
-    double startX = 128;
-
-    double x = startX;
-    double y = startY;
-
-    double horizontalSpacing = 16;
-    double verticalSpacing = 16;
-
-    // Lay out each item in the row.
-    for (auto item: items) {
-        // Get the person.
-        DiagramItem *person = qgraphicsitem_cast<DiagramItem*> (item);
-
-        // Only place the *left* spouse of married couples. The right spouse will
-        // move along with them.
-        if (person->isMarried() && person->getSpousePosition() == DiagramItem::SpouseToLeft) {
-            continue;
-        }
-
-        // Place the person.
-        person->setPos(x, y);
-
-        // Prepare the next position.
-        x += person->getWidthIncludingSpouse() + horizontalSpacing;
+    setBatchArrows(batchArrows);
 
-        // Wrap to next line if required.
-        if (x > sceneRect().right()) {
-            y += person->boundingRect().height() + verticalSpacing;
-            x = startX;
-        }
+    if (renderCache != RenderCache::isEnabled()) {
+        RenderCache::setEnabled(renderCache);
+        update();
     }
-
-    return y;
 }
 
 /**
@@ -495,17 +775,7 @@ void DiagramScene::highlightForSearch(DiagramItem *item)
  */
 int DiagramScene::marriageCount() const
 {
-    int count = 0;
-
-    for (auto item: items())
-    {
-        if (item->type() == MarriageItem::Type)
-        {
-            ++count;
-        }
-    }
-
-    return count;
+    return m_marriages.size();
 }
 
 /**
@@ -513,133 +783,311 @@ int DiagramScene::marriageCount() const
  */
 int DiagramScene::personCount() const
 {
-    int count = 0;
+    return m_persons.size();
+}
 
-    for (auto item: items())
-    {
-        if (item->type() == DiagramItem::Type)
-        {
-            ++count;
+/**
+ * @brief DiagramScene::relationshipCount Count the parent/child relationships in the diagram.
+ */
+int DiagramScene::relationshipCount() const
+{
+    return m_arrows.size();
+}
+
+/**
+ * @brief unitPerson Get the person who is placed for a couple.
+ * The right spouse moves along with the left spouse.
+ * @param person The person.
+ * @return The left spouse if married, otherwise the person.
+ */
+static DiagramItem *unitPerson(DiagramItem *person)
+{
+    if (person->isMarried() && person->getSpousePosition() == DiagramItem::SpouseToLeft) {
+        return person->getSpouse();
+    }
+    return person;
+}
+
+/**
+ * @brief buildLayoutGraph Make a layout node for each person or couple.
+ * @param persons The persons to lay out.
+ * @param units Set to the person placed for each node.
+ * @param graph Set to the nodes and the links between them.
+ */
+static void buildLayoutGraph(const QVector<DiagramItem *> &persons, QVector<DiagramItem *> &units,
+                             LayoutGraph &graph)
+{
+    QHash<DiagramItem *, int> unitIndex;
+
+    for (DiagramItem *person: persons) {
+        if (unitPerson(person) != person) {
+            continue;
+        }
+
+        int rank = GenerationIndex::depth(person);
+        if (person->isMarried()) {
+            rank = qMax(rank, GenerationIndex::depth(person->getSpouse()));
         }
+
+        LayoutGraph::Node node;
+        node.width = person->getWidthIncludingSpouse();
+        node.height = person->boundingRect().height();
+        node.anchor = person->boundingRect().width() / 2;
+
+        unitIndex.insert(person, units.size());
+        units << person;
+        graph.nodes << node;
+        graph.ranks << rank;
     }
 
-    return count;
+    // Link each couple to the couples of their children.
+    for (int i = 0; i < units.size(); ++i) {
+        for (int side = 0; side < 2; ++side) {
+            DiagramItem *parent = units[i];
+            if (side == 1) {
+                if (!parent->isMarried()) {
+                    break;
+                }
+                parent = parent->getSpouse();
+            }
+
+            for (DiagramItem *child: parent->getChildren()) {
+                int childIndex = unitIndex.value(unitPerson(child), -1);
+                if (childIndex != -1) {
+                    graph.edges << qMakePair(i, childIndex);
+                }
+            }
+        }
+    }
 }
 
 /**
- * @brief DiagramScene::relationshipCount Count the parent/child relationships in the diagram.
+ * @brief countCycles Count the persons with a link that closes a cycle.
+ * @param units The persons placed.
+ * @return The number of persons.
  */
-int DiagramScene::relationshipCount() const
+static int countCycles(const QVector<DiagramItem *> &units)
 {
-    int count = 0;
+    int cycleCount = 0;
 
-    for (auto item: items())
-    {
-        if (item->type() == Arrow::Type)
-        {
-            ++count;
+    for (DiagramItem *person: units) {
+        if (GenerationIndex::closesCycle(person)) {
+            ++cycleCount;
+        }
+        if (person->isMarried() && GenerationIndex::closesCycle(person->getSpouse())) {
+            ++cycleCount;
         }
     }
 
-    return count;
+    return cycleCount;
 }
 
-// A temporary map to store the depth of each person.
-static QMap<DiagramItem *, int> m_depthMap;
-
-//
-// Get the "depth" of the person, i.e. how many layers of ancestors they have.
-//
-//static int getAncestorDepth(DiagramItem *person) {
+/**
+ * @brief DiagramScene::autoLayout Place the persons in generations, with the
+ * oldest at the top. Married couples are placed together.
+ * @return The number of persons with a parent/child link that closes a cycle.
+ * Those links are ignored.
+ */
+int DiagramScene::autoLayout()
+{
+    QVector<DiagramItem *> units;
+    LayoutGraph graph;
+    buildLayoutGraph(m_persons.items(), units, graph);
 
-//    // Check if depth already calculated.
-//    if (m_depthMap.contains(person)) {
-//        return m_depthMap[person];
-//    }
+    if (units.isEmpty()) {
+        return 0;
+    }
 
-//    // Get maximum depth of parents.
-//    QList<DiagramItem *> parents = person->getParents();
+    // Place the persons.
+    LayoutResult result = LayoutEngine::layout(graph);
 
-//    int maxParentDepth = -1;
-//    for (DiagramItem *parent: parents) {
-//        int parentDepth = getDepth(parent);
-//        if (parentDepth > maxParentDepth) {
-//            maxParentDepth = parentDepth;
-//        }
-//    }
+    for (int i = 0; i < units.size(); ++i) {
+        units[i]->setPos(result.positions[i]);
+    }
 
-//    // Add one.
-//    int personDepth = maxParentDepth + 1;
-//    m_depthMap[person] = personDepth;
+    growToFit(units);
+    return countCycles(units);
+}
 
-//    // Return.
-//    return personDepth;
-//}
+/**
+ * @brief DiagramScene::layoutSnapshot Take the sizes and links needed to lay
+ * out the whole diagram, so it can be laid out on a worker thread.
+ * @param units Set to the id of the person placed for each node.
+ * @return The layout graph.
+ */
+LayoutGraph DiagramScene::layoutSnapshot(QVector<QUuid> &units)
+{
+    QVector<DiagramItem *> unitItems;
+    LayoutGraph graph;
+    buildLayoutGraph(m_persons.items(), unitItems, graph);
+
+    units.clear();
+    units.reserve(unitItems.size());
+    for (DiagramItem *person: unitItems) {
+        units << person->id();
+    }
 
-//
-// Get the "depth" of the person, i.e. how many layers of descendants they have.
-//
-static int getDepth(DiagramItem *person) {
+    return graph;
+}
 
-    // Check if depth already calculated.
-    if (m_depthMap.contains(person)) {
-        return m_depthMap[person];
+/**
+ * @brief DiagramScene::layoutFamily Get the persons to move when the family
+ * of some persons is laid out again: their parents, their parents'
+ * descendants, and the spouses of all of these.
+ * @param persons The persons whose links or marriages changed.
+ * @return The persons to move, starting with the one that keeps its place.
+ */
+QList<DiagramItem *> DiagramScene::layoutFamily(const QList<DiagramItem *> &persons) const
+{
+    // Start from the parents, so that siblings are included.
+    QVector<DiagramItem *> roots;
+    for (DiagramItem *person: persons) {
+        if (person->scene() != this) {
+            continue;
+        }
+        if (person->hasParent()) {
+            for (DiagramItem *parent: person->getParents()) {
+                roots << unitPerson(parent);
+            }
+        }
+        else {
+            roots << unitPerson(person);
+        }
     }
 
-    // Get maximum depth of parents.
-    QList<DiagramItem *> children = person->getChildren();
+    // Collect the descendants and their spouses, each once.
+    QList<DiagramItem *> family;
+    QSet<DiagramItem *> found;
+    QVector<DiagramItem *> descendants;
+    KinshipGraph graph;
 
-    int maxChildDepth = -1;
-    for (DiagramItem *child: children) {
-        int childDepth = getDepth(child);
-        if (childDepth > maxChildDepth) {
-            maxChildDepth = childDepth;
+    for (DiagramItem *root: roots) {
+        if (found.contains(root)) {
+            continue;
+        }
+
+        graph.descendants(root, descendants);
+        for (DiagramItem *person: descendants) {
+            DiagramItem *unit = unitPerson(person);
+            if (unit->scene() != this || found.contains(unit)) {
+                continue;
+            }
+
+            found.insert(unit);
+            family << unit;
+            if (unit->isMarried()) {
+                found.insert(unit->getSpouse());
+                family << unit->getSpouse();
+            }
         }
     }
 
-    // Add one.
-    int personDepth = maxChildDepth + 1;
+    return family;
+}
 
-    // Check position of spouse if required.
-    if (person->isMarried() && person->getSpousePosition() == DiagramItem::SpouseToRight) {
-        int spouseDepth = getDepth(person->getSpouse());
-        personDepth = qMax(personDepth, spouseDepth);
+/**
+ * @brief DiagramScene::autoLayoutFamily Lay out part of the diagram, leaving
+ * everyone else where they are.
+ * @param family The persons to move, from layoutFamily(). The first keeps its place.
+ * @return The number of persons with a parent/child link that closes a cycle.
+ */
+int DiagramScene::autoLayoutFamily(const QList<DiagramItem *> &family)
+{
+    QVector<DiagramItem *> units;
+    LayoutGraph graph;
+    buildLayoutGraph(family.toVector(), units, graph);
+
+    if (units.isEmpty()) {
+        return 0;
     }
 
-    // Add to map.
-    m_depthMap[person] = personDepth;
+    // Place the family, keeping the first person where they are.
+    LayoutResult result = LayoutEngine::layout(graph);
+    QPointF offset = units.first()->pos() - result.positions.first();
 
-    // Return.
-    return personDepth;
+    for (int i = 0; i < units.size(); ++i) {
+        units[i]->setPos(result.positions[i] + offset);
+    }
+
+    // Move the family right, by the least distance at which it covers no one else.
+    qreal shift = clearingShift(family);
+    if (shift > 0) {
+        for (DiagramItem *person: units) {
+            person->moveBy(shift, 0);
+        }
+    }
+
+    growToFit(units);
+    return countCycles(units);
 }
 
-void DiagramScene::autoLayout()
+/**
+ * @brief DiagramScene::clearingShift Find how far to move a family right so
+ * that it covers no one else, in one pass over the persons.
+ * @param family The persons that move together.
+ * @return The distance, or 0 if the family covers no one.
+ */
+qreal DiagramScene::clearingShift(const QList<DiagramItem *> &family) const
 {
-    // Clear depth map.
-    m_depthMap.clear();
+    const qreal spacing = 16;
+
+    QSet<DiagramItem *> members;
+    QVector<QRectF> rects;
+    QRectF bounds;
+    for (DiagramItem *person: family) {
+        members.insert(person);
+        rects << person->sceneBoundingRect();
+        bounds |= rects.last();
+    }
 
-    // Set up map of depth to persons.
-    QMultiMap<int, DiagramItem* > depthMultiMap;
+    // Each member and other person in the same rows rule out the shifts at
+    // which the two would overlap.
+    QVector<QPair<qreal, qreal>> blocked;
+    for (DiagramItem *other: m_persons.items()) {
+        QRectF otherRect = other->sceneBoundingRect();
+        if (otherRect.bottom() < bounds.top() || otherRect.top() > bounds.bottom() ||
+                otherRect.right() + spacing <= bounds.left() || members.contains(other)) {
+            continue;
+        }
 
-    // Find the right depth for each person.
-    for (auto item: items()) {
-        if (item->type() == DiagramItem::Type) {
-            DiagramItem *person = qgraphicsitem_cast<DiagramItem*> (item);
+        for (const QRectF &rect: rects) {
+            if (otherRect.bottom() >= rect.top() && otherRect.top() <= rect.bottom()) {
+                blocked << qMakePair(otherRect.left() - rect.right(), otherRect.right() + spacing - rect.left());
+            }
+        }
+    }
 
-            int depth = getDepth(person);
-            depthMultiMap.insert(depth, person);
+    // Take the smallest shift that no range rules out.
+    std::sort(blocked.begin(), blocked.end());
+
+    qreal shift = 0;
+    for (const QPair<qreal, qreal> &range: blocked) {
+        if (range.first >= shift) {
+            break;
         }
+        shift = qMax(shift, range.second);
     }
 
-    // Get maximum depth.
-    auto maxDepth = depthMultiMap.lastKey();
+    return shift;
+}
 
-    // Place the persons.
-    double y = 64;
+/**
+ * @brief DiagramScene::growToFit Make the scene bigger if the persons do not fit.
+ * @param persons The persons, whose spouses are checked too.
+ */
+void DiagramScene::growToFit(const QVector<DiagramItem *> &persons)
+{
+    QRectF bounds = sceneRect();
 
-    for (int depth = maxDepth; depth >= 0; --depth) {
-        y = autoLayoutRow(depthMultiMap.values(depth), y);
-        y += 256;
+    for (DiagramItem *person: persons) {
+        bounds |= person->sceneBoundingRect();
+        if (person->isMarried()) {
+            bounds |= person->getSpouse()->sceneBoundingRect();
+        }
+    }
+
+    if (bounds != sceneRect()) {
+        setSceneRect(bounds);
     }
 }
 
@@ -693,22 +1141,37 @@ DiagramItem *DiagramScene::createPerson(const QPointF &pos)
     // Assign ID.
     auto id = QUuid::createUuid();
     item->setId(id);
-    m_itemsDict[id] = item;
+    m_itemsDict.insert(id, item);
     emit itemInserted(item, false);
 
     // Return the item.
     return item;
 }
 
-void DiagramScene::copyPhotosForPerson(DiagramItem *diagramItem, const QDir &photosDir)
+void DiagramScene::planPhotoCopies(PersonRecord &record, int personIndex, const QDir &photosDir,
+                                   bool sharedPhotoStore, QVector<PhotoCopy> &copies)
 {
-    // Create photos folder for person.
-    QString personPhotosDirName = diagramItem->id().toString();
+    // Photos already in the project stay where they are. The rest go to the
+    // shared store, named once their contents have been read.
+    if (sharedPhotoStore) {
+        QString photosFolderPath = photosDir.absolutePath() + "/";
+
+        for (int i = 0; i < record.photos.size(); ++i) {
+            const QString &photo = record.photos[i];
+            if (!photo.startsWith(photosFolderPath)) {
+                copies << PhotoCopy { personIndex, i, photo, QString() };
+            }
+        }
+        return;
+    }
+
+    // Get photos folder for person.
+    QString personPhotosDirName = record.id.toString();
     QDir personPhotosDir(photosDir.filePath(personPhotosDirName));
     QString personPhotosFolderPath = personPhotosDir.absolutePath();
 
     // Get list of photos.
-    auto photos = diagramItem->photos();
+    auto photos = record.photos;
 
     // Ensure photos with the same name do not overwrite each other.
     QStringList destFileNames;
@@ -739,9 +1202,6 @@ void DiagramScene::copyPhotosForPerson(DiagramItem *diagramItem, const QDir &pho
 
     Q_ASSERT(destFileNames.size() == photos.size());
 
-    // Save the photo details.
-    QStringList photosUpdated;
-
     for (int i = 0; i < photos.size(); ++i) {
 
         // Get photo.
@@ -750,32 +1210,11 @@ void DiagramScene::copyPhotosForPerson(DiagramItem *diagramItem, const QDir &pho
         // Ensure photo is saved in project directory.
         if (!photo.startsWith(personPhotosFolderPath))
         {
-            // Create photos folder for person.
-            if (!personPhotosDir.exists())
-            {
-                personPhotosDir.mkpath(".");
-            }
-
-            // Copy photo to folder.
-            QString destFileName = destFileNames[i];
-            QString destFilePath = personPhotosDir.absoluteFilePath(destFileName);
-            bool copiedOK = FileUtils::copyAndReplace(photo, destFilePath);
-
-            // Check for existing files.
-            if (copiedOK) {
-                photo = destFilePath;
-            }
-            else {
-                qDebug() << "Could not copy photo" << photo << "to" << destFilePath;
-            }
+            QString destFilePath = personPhotosDir.absoluteFilePath(destFileNames[i]);
+            copies << PhotoCopy { personIndex, i, photo, destFilePath };
+            record.photos[i] = destFilePath;
         }
-
-        // Add to list.
-        photosUpdated << photo;
     }
-
-    // Update the list.
-    diagramItem->setPhotos(photosUpdated);
 }
 
 void DiagramScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
@@ -783,6 +1222,9 @@ void DiagramScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
     if (mouseEvent->button() != Qt::LeftButton)
         return;
 
+    // Let a layout that is moving persons finish first.
+    emit mousePressed();
+
     // Unhighlight search item.
     removeSearchHighlight();
 
@@ -827,6 +1269,16 @@ void DiagramScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
 //        break;
 //    }
 
+    case MoveItem:
+        // Show an arrow drawn by the edge layer, so that it can be selected.
+        if (m_edgeLayer && !itemAt(mouseEvent->scenePos(), QTransform())) {
+            Arrow *arrow = m_edgeLayer->arrowAt(mouseEvent->scenePos());
+            if (arrow) {
+                m_edgeLayer->showArrow(arrow);
+            }
+        }
+        break;
+
     default:
         ;
     }
@@ -1038,171 +1490,6 @@ bool DiagramScene::isItemChange(int type)
     return false;
 }
 
-void DiagramScene::parseItemElement(const QDomElement &element, const QString &photosFolderPath)
-{
-    auto item = new DiagramItem(DiagramItem::Person, myItemMenu);
-    item->setBrush(Qt::white);
-    addItem(item);
-    auto x = element.attribute("x").toDouble();
-    auto y = element.attribute("y").toDouble();
-    auto firstName = element.attribute("first_name");
-    auto lastName = element.attribute("last_name");
-    auto name = element.attribute("name");
-
-    QUuid id;
-    if (element.hasAttribute("id")) {
-        id = QUuid(element.attribute("id"));
-    }
-    else {
-        id = QUuid::createUuid();
-    }
-
-    auto bio = element.attribute("bio");
-    auto placeOfBirth = element.attribute("place_of_birth");
-    auto countryOfBirth = element.attribute("country_of_birth");
-    auto placeOfDeath = element.attribute("place_of_death");
-    auto gender = element.attribute("gender");
-    item->setPos(x, y);
-    item->setFirstName(firstName);
-    item->setLastName(lastName);
-    item->setName(name);
-    item->setId(id);
-    item->setBio(bio);
-    item->setPlaceOfBirth(placeOfBirth);
-    item->setCountryOfBirth(countryOfBirth);
-    item->setPlaceOfDeath(placeOfDeath);
-    item->setGender(gender);
-
-    if (element.hasAttribute("date_of_birth")) {
-//        item->setDateOfBirth(QDate::fromString(element.attribute("date_of_birth")));
-        item->setDateOfBirth(parseXmlDate(element.attribute("date_of_birth")));
-    }
-    if (element.hasAttribute("date_of_death")) {
-        item->setDateOfDeath(parseXmlDate(element.attribute("date_of_death")));
-    }
-
-    if (element.hasAttribute("fill_color")) {
-        QColor color;
-        color.setNamedColor(element.attribute("fill_color"));
-        item->setBrush(color);
-    }
-
-    if (element.hasAttribute("text_color")) {
-        QColor color;
-        color.setNamedColor(element.attribute("text_color"));
-        item->setTextColor(color);
-    }
-
-    if (element.hasAttribute("border_color")) {
-        QColor color;
-        color.setNamedColor(element.attribute("border_color"));
-        item->setBorderColor(color);
-    }
-
-    QStringList photos;
-    QDomElement photoElement = element.firstChildElement("photo");
-    while (!photoElement.isNull()) {
-
-        // Get the path.
-        QString path = photoElement.attribute("path");
-
-        // Check for relative (project dir) path.
-        if (photoElement.hasAttribute("project_dir_path")) {
-
-            // Use the relative path.
-            path = photoElement.attribute("project_dir_path");
-
-            // Hack: Prepend photos folder.
-            path.prepend(photosFolderPath + "/");
-        }
-
-        // Add to the person.
-        photos << path;
-        photoElement = photoElement.nextSiblingElement("photo");
-    }
-    item->setPhotos(photos);
-
-    emit itemInserted(item, true);
-    m_itemsDict[id] = item;
-
-    // Check for GEDCOM pointer.
-    if (element.hasAttribute("pointer")) {
-        QString pointer = element.attribute("pointer");
-        m_pointerDict[pointer] = item;
-    }
-}
-
-void DiagramScene::parseArrowElement(const QDomElement &element)
-{
-    DiagramItem *startItem = nullptr;
-    DiagramItem *endItem = nullptr;
-
-    if (element.hasAttribute("from_pointer") && element.hasAttribute("to_pointer")) {
-        // GEDCOM import.
-        auto fromId = element.attribute("from_pointer");
-        auto toId = element.attribute("to_pointer");
-        startItem = m_pointerDict[fromId];
-        endItem = m_pointerDict[toId];
-    }
-    else {
-        // Normal diagram.
-        auto fromId = element.attribute("from");
-        auto toId = element.attribute("to");
-        startItem = m_itemsDict[fromId];
-        endItem = m_itemsDict[toId];
-    }
-
-    if (startItem && endItem) {
-        Arrow *arrow = new Arrow(startItem, endItem);
-
-        if (element.hasAttribute("color")) {
-            QColor color;
-            color.setNamedColor(element.attribute("color"));
-            arrow->setColor(color);
-        }
-        else {
-            arrow->setColor(myLineColor);
-        }
-
-        startItem->addArrow(arrow);
-        endItem->addArrow(arrow);
-        arrow->setZValue(-1000.0);
-        addItem(arrow);
-        arrow->updatePosition();
-    }
-}
-
-void DiagramScene::parseMarriageElement(const QDomElement &element)
-{
-    DiagramItem *personLeft = nullptr;
-    DiagramItem *personRight = nullptr;
-
-    if (element.hasAttribute("left_pointer") && element.hasAttribute("right_pointer")) {
-        // GEDCOM import.
-        auto leftId = element.attribute("left_pointer");
-        auto rightId = element.attribute("right_pointer");
-        personLeft = m_pointerDict[leftId];
-        personRight = m_pointerDict[rightId];
-    }
-    else {
-        // Normal diagram.
-        auto leftId = element.attribute("person_left");
-        auto rightId = element.attribute("person_right");
-        personLeft = m_itemsDict[leftId];
-        personRight = m_itemsDict[rightId];
-    }
-
-    if (personLeft && personRight) {
-        personLeft->marryTo(personRight);
-        MarriageItem *marriage = personLeft->getMarriageItem();
-
-        if (element.hasAttribute("date")) {
-            marriage->setDate(QDate::fromString(element.attribute("date")));
-        }
-        marriage->setPlace(element.attribute("place"));
-    }
-}
-
 void DiagramScene::highlight(DiagramItem *item)
 {
     unHighlightAll();
@@ -1222,6 +1509,14 @@ void DiagramScene::unHighlightAll()
     m_highlightedItem = nullptr;
 }
 
+void DiagramScene::onSelectionChanged()
+{
+    // Take deselected arrows back into the edge layer.
+    if (m_edgeLayer && !m_selectingAll) {
+        m_edgeLayer->hideUnselected();
+    }
+}
+
 void DiagramScene::removeSearchHighlight()
 {
     // Unhighlight item.
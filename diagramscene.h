@@ -19,11 +19,25 @@
 #define DIAGRAMSCENE_H
 
 #include "diagramitem.h"
+#include "diagramrecords.h"
+#include "diagramwriter.h"
 #include "diagramtextitem.h"
+#include "itemhash.h"
+#include "itemregistry.h"
+#include "layoutengine.h"
+#include "nameindex.h"
+#include "phoneticindex.h"
+#include "scenestatistics.h"
+#include "textindex.h"
 
 #include <QDir>
 #include <QGraphicsScene>
 
+class Arrow;
+class DiagramReader;
+class EdgeLayer;
+class MarriageItem;
+
 QT_BEGIN_NAMESPACE
 class QGraphicsSceneMouseEvent;
 class QMenu;
@@ -32,7 +46,6 @@ class QGraphicsLineItem;
 class QFont;
 class QGraphicsTextItem;
 class QColor;
-class QDomElement;
 class QTimer;
 QT_END_NAMESPACE
 
@@ -54,20 +67,150 @@ public:
     void setItemColor(const QColor &color);
     void setFont(const QFont &font);
     bool open(QIODevice *device, const QString &photosFolderPath);
+
+    /**
+     * @brief populate Replace the diagram with the records read from a file.
+     * @param reader The reader.
+     */
+    void populate(const DiagramReader &reader);
+
+    /**
+     * @brief populateLinks Add the relationships and marriages read from a file,
+     * once the persons have been added.
+     * @param reader The reader.
+     */
+    void populateLinks(const DiagramReader &reader);
+
+    /**
+     * @brief beginLoad Clear the diagram before persons are added from a file.
+     * Until buildTextIndex is called, added persons are not indexed by text.
+     * @param width The diagram width.
+     * @param height The diagram height.
+     */
+    void beginLoad(int width, int height);
+
+    /**
+     * @brief reservePersons Make room to look up a number of persons, so the
+     * lookup tables need not grow while loading.
+     * @param count The number of persons to be added.
+     * @param byPointer True if the persons are imported from GEDCOM, and looked up by pointer.
+     */
+    void reservePersons(int count, bool byPointer = false);
+
+    /**
+     * @brief addPerson Add a person read from a file.
+     * @param record The person details.
+     * @return The new person.
+     */
+    DiagramItem *addPerson(const PersonRecord &record);
+
+    /**
+     * @brief addRelationship Add a relationship read from a file.
+     * @param record The relationship details.
+     * @return False if either person has not been added yet.
+     */
+    bool addRelationship(const RelationshipRecord &record);
+
+    /**
+     * @brief addMarriage Add a marriage read from a file.
+     * @param record The marriage details.
+     * @return False if either spouse has not been added yet.
+     */
+    bool addMarriage(const MarriageRecord &record);
     void print();
-    void save(QIODevice *device, const QString &photosFolderPath);
+
+    /**
+     * @brief save Save the diagram.
+     * @param device The file to write.
+     * @param photosFolderPath The path to photos for the project.
+     * @param binary True to write the binary format instead of XML.
+     */
+    void save(QIODevice *device, const QString &photosFolderPath, bool binary = false);
+
+    /**
+     * @brief snapshot Copy the diagram data to save, and plan the photo copies.
+     * @param photosFolderPath The path to photos for the project, or empty to leave photos in place.
+     * @param sharedPhotoStore True to copy new photos into the shared photo store,
+     * rather than a folder per person.
+     * @return The snapshot.
+     */
+    DiagramSnapshot snapshot(const QString &photosFolderPath, bool sharedPhotoStore = false);
+
+    /**
+     * @brief applyPhotos Update the photo paths of persons after their photos were copied.
+     * @param diagramSnapshot The saved snapshot.
+     */
+    void applyPhotos(const DiagramSnapshot &diagramSnapshot);
     DiagramItem *itemWithId(const QUuid &id);
+    NameIndex &nameIndex();
+    PhoneticIndex &phoneticIndex();
+    TextIndex &textIndex();
+    SceneStatistics &statistics();
+    const SceneStatistics &statistics() const;
+
+    /**
+     * @brief persons Get the persons in the diagram, in no particular order.
+     * Cheaper than filtering items().
+     */
+    const QVector<DiagramItem *> &persons() const;
+
+    /**
+     * @brief arrows Get the parent/child arrows in the diagram, in no particular order.
+     */
+    const QVector<Arrow *> &arrows() const;
+
+    /**
+     * @brief marriages Get the marriage rings in the diagram, in no particular order.
+     */
+    const QVector<MarriageItem *> &marriages() const;
+
+    // Called by the items as they enter and leave the scene.
+    void registerPerson(DiagramItem *person);
+    void unregisterPerson(DiagramItem *person);
+    void registerArrow(Arrow *arrow);
+    void unregisterArrow(Arrow *arrow);
+    void registerMarriage(MarriageItem *marriage);
+    void unregisterMarriage(MarriageItem *marriage);
+
+    /**
+     * @brief edgeLayer Get the layer that draws the arrows together.
+     * @return The layer, or null if each arrow draws itself.
+     */
+    EdgeLayer *edgeLayer() const;
+
+    /**
+     * @brief setBatchArrows Draw the arrows together in one layer, which is
+     * faster for large diagrams, or let each arrow draw itself.
+     */
+    void setBatchArrows(bool batch);
+
+    /**
+     * @brief buildTextIndex Index the biographies and places of all persons,
+     * once a diagram has been loaded. Persons added later are indexed one by one.
+     */
+    void buildTextIndex();
     bool isEmpty() const;
     QGraphicsItem *firstItem() const;
     void selectAll();
+
+    /**
+     * @brief showArrowsIn Show the arrows drawn by the edge layer that touch an
+     * area, since hidden arrows cannot be selected. Called as a rubber band is dragged.
+     * @param area The area, in scene coordinates.
+     */
+    void showArrowsIn(const QPainterPath &area);
     void addPersonFromUndo(DiagramItem *item);
     void removePersonFromUndo(DiagramItem *item);
     void marry(DiagramItem *item1, DiagramItem *item2, bool fromUndo = false);
     void removeMarriage(DiagramItem *person1, DiagramItem *person2);
     bool isDrawingArrow() const;
     void loadPreferences();
-    void autoLayout();
-    int autoLayoutRow(const QList<DiagramItem *> &items, int startY);
+    int autoLayout();
+    LayoutGraph layoutSnapshot(QVector<QUuid> &units);
+    QList<DiagramItem *> layoutFamily(const QList<DiagramItem *> &persons) const;
+    int autoLayoutFamily(const QList<DiagramItem *> &family);
+    qreal clearingShift(const QList<DiagramItem *> &family) const;
+    void growToFit(const QVector<DiagramItem *> &persons);
     void highlightForSearch(DiagramItem *item);
     int marriageCount() const;
     int personCount() const;
@@ -90,12 +233,14 @@ signals:
     void textInserted(QGraphicsTextItem *item);
     void itemSelected(QGraphicsItem *item);
     void mouseReleased();
+    void mousePressed();
     void arrowAdded(Arrow *arrow);
     void itemsAboutToMove();
     void itemsFinishedMoving();
     void peopleMarried(DiagramItem *person1, DiagramItem *person2);
     void cleared();
     void personDoubleClicked(DiagramItem *person);
+    void personNameChanged(DiagramItem *person);
 
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent) override;
@@ -109,14 +254,12 @@ protected:
 
 private:
     bool isItemChange(int type);
-    void parseItemElement(const QDomElement& element, const QString &photosFolderPath);
-    void parseArrowElement(const QDomElement& element);
-    void parseMarriageElement(const QDomElement& element);
     void highlight(DiagramItem *item);
     void unHighlightAll();
 
 private slots:
     void removeSearchHighlight();
+    void onSelectionChanged();
 
 private:
     DiagramItem::DiagramType myItemType;
@@ -131,8 +274,18 @@ private:
     QColor myItemColor;
     QColor myLineColor;
 
-    QMap<QUuid, DiagramItem *> m_itemsDict;
-    QMap<QString, DiagramItem *> m_pointerDict;
+    ItemHash m_itemsDict;
+    NameIndex m_nameIndex;
+    PhoneticIndex m_phoneticIndex;
+    TextIndex m_textIndex;
+    SceneStatistics m_statistics;
+    ItemRegistry<DiagramItem> m_persons;
+    ItemRegistry<Arrow> m_arrows;
+    ItemRegistry<MarriageItem> m_marriages;
+    EdgeLayer *m_edgeLayer;
+    bool m_selectingAll; ///< Keep shown arrows while all items are selected one by one.
+    bool m_loading; ///< Leave the text index to buildTextIndex while a diagram is loaded.
+    ItemHash m_pointerDict; ///< Persons by GEDCOM pointer, while importing.
     DiagramItem *m_highlightedItem;
     long m_nextId;
     bool m_busyMoving;
@@ -141,11 +294,15 @@ private:
     DiagramItem *createPerson(const QPointF &pos);
 
     /**
-     * @brief copyPhotosForPerson Copy the photos for the person to a photo directory.
-     * @param diagramItem The person.
+     * @brief planPhotoCopies Plan the copies of the photos for the person to a photo directory.
+     * @param record The person. The photo paths are changed to the copied paths.
+     * @param personIndex The index of the person in the snapshot.
      * @param photosDir The project photos directory. The person will have a subdirectory created here, if required.
+     * @param sharedPhotoStore True to copy photos into the shared photo store instead.
+     * @param copies The list to add the copies to.
      */
-    void copyPhotosForPerson(DiagramItem *diagramItem, const QDir &photosDir);
+    void planPhotoCopies(PersonRecord &record, int personIndex, const QDir &photosDir,
+                         bool sharedPhotoStore, QVector<PhotoCopy> &copies);
 };
 //! [0]
 
@@ -22,8 +22,6 @@
 #include <QTextCursor>
 #include <QKeyEvent>
 
-static QFont m_defaultFont;
-
 DiagramTextItem::DiagramTextItem(DiagramItem *parent)
     : QGraphicsTextItem(parent)
 {
@@ -31,11 +29,6 @@ DiagramTextItem::DiagramTextItem(DiagramItem *parent)
     //setFlag(QGraphicsItem::ItemIsSelectable);
 
     m_person = parent;
-
-    // Apply default font if valid.
-    if(!m_defaultFont.family().isEmpty() && m_defaultFont.pointSize() >= 1) {
-        setFont(m_defaultFont);
-    }
 }
 
 QString DiagramTextItem::text() const
@@ -60,11 +53,6 @@ void DiagramTextItem::emitChangedSignal()
     emit textEdited(this);
 }
 
-void DiagramTextItem::setDefaultFont(const QFont &font)
-{
-    m_defaultFont = font;
-}
-
 QVariant DiagramTextItem::itemChange(GraphicsItemChange change,
                      const QVariant &value)
 {
@@ -30,6 +30,7 @@ class DiagramItem;
 QT_END_NAMESPACE
 
 //! [0]
+/// Edits the name of a person. Made by DiagramItem::editName(), and let go when editing ends.
 class DiagramTextItem : public QGraphicsTextItem
 {
     Q_OBJECT
@@ -43,7 +44,6 @@ public:
     QString text() const;
     void startEditing();
     void emitChangedSignal();
-    static void setDefaultFont(const QFont &font);
 
 signals:
     void lostFocus(DiagramTextItem *item);
@@ -0,0 +1,208 @@
+#include "diagramwriter.h"
+#include "diagrambinary.h"
+#include "fileutils.h"
+#include "photostore.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QXmlStreamWriter>
+#include <QtConcurrent/QtConcurrentMap>
+
+///
+/// \brief syncPhoto Copy a photo into the project photos folder, unless it is already there.
+/// \param copy The photo to copy.
+/// \return True if the photo is in place.
+///
+static bool syncPhoto(const PhotoCopy &copy)
+{
+    return FileUtils::syncFile(copy.source, copy.dest);
+}
+
+void DiagramWriter::copyPhotos(DiagramSnapshot &snapshot)
+{
+    if (snapshot.photoCopies.isEmpty()) {
+        return;
+    }
+
+    // Name the photos for the shared store by their contents, hashing them in parallel.
+    const QString storeFolderPath = PhotoStore::folderFor(snapshot.photosFolderPath);
+    QtConcurrent::blockingMap(snapshot.photoCopies, [&storeFolderPath](PhotoCopy &copy) {
+        if (copy.dest.isEmpty()) {
+            copy.dest = PhotoStore::pathFor(storeFolderPath, copy.source);
+        }
+    });
+
+    // Copy each destination once. Shared photos may appear many times.
+    QVector<PhotoCopy> uniqueCopies;
+    QSet<QString> dests;
+    QSet<QString> photosFolders;
+
+    for (const PhotoCopy &copy: snapshot.photoCopies) {
+        if (copy.dest.isEmpty() || dests.contains(copy.dest)) {
+            continue;
+        }
+        dests.insert(copy.dest);
+        uniqueCopies << copy;
+        photosFolders.insert(QFileInfo(copy.dest).absolutePath());
+    }
+
+    // Create photos folders first, so the copies do not race to create them.
+    for (const QString &folder: photosFolders) {
+        QDir().mkpath(folder);
+    }
+
+    // Copy the photos on the thread pool.
+    QVector<bool> results =
+            QtConcurrent::blockingMapped<QVector<bool> >(uniqueCopies, syncPhoto);
+
+    QSet<QString> copiedDests;
+    for (int i = 0; i < results.size(); ++i) {
+        if (results[i]) {
+            copiedDests.insert(uniqueCopies[i].dest);
+        }
+    }
+
+    // Use the new paths. Keep the original path if the copy fails.
+    for (const PhotoCopy &copy: snapshot.photoCopies) {
+        QString &photo = snapshot.persons[copy.person].photos[copy.photo];
+
+        if (copiedDests.contains(copy.dest)) {
+            photo = copy.dest;
+        }
+        else {
+            qDebug() << "Could not copy photo" << copy.source << "to" << copy.dest;
+            photo = copy.source;
+        }
+    }
+}
+
+void DiagramWriter::write(const DiagramSnapshot &snapshot, QIODevice *device)
+{
+    const int indentSize = 4;
+
+    QXmlStreamWriter xml(device);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(indentSize);
+
+    //
+    // Save diagram information.
+    //
+    xml.writeStartElement("genealogy");
+    xml.writeAttribute("width", QString::number(snapshot.width));
+    xml.writeAttribute("height", QString::number(snapshot.height));
+
+    // Check if photos are stored in the project folder.
+    bool copyPhotos = !snapshot.photosFolderPath.isEmpty();
+    QString prefix = snapshot.photosFolderPath + "/";
+
+    //
+    // Save persons.
+    //
+    for (const PersonRecord &person: snapshot.persons) {
+        if (person.photos.isEmpty()) {
+            xml.writeEmptyElement("item");
+        }
+        else {
+            xml.writeStartElement("item");
+        }
+
+        xml.writeAttribute("x", QString::number(person.pos.x()));
+        xml.writeAttribute("y", QString::number(person.pos.y()));
+        xml.writeAttribute("first_name", person.firstName);
+        xml.writeAttribute("last_name", person.lastName);
+        xml.writeAttribute("name", person.name);
+        xml.writeAttribute("id", person.id.toString());
+        xml.writeAttribute("bio", person.bio);
+        xml.writeAttribute("date_of_birth", person.dateOfBirth.toString());
+        xml.writeAttribute("place_of_birth", person.placeOfBirth);
+        xml.writeAttribute("country_of_birth", person.countryOfBirth);
+        xml.writeAttribute("date_of_death", person.dateOfDeath.toString());
+        xml.writeAttribute("place_of_death", person.placeOfDeath);
+        xml.writeAttribute("fill_color", person.fillColor.name());
+        xml.writeAttribute("text_color", person.textColor.name());
+        xml.writeAttribute("border_color", person.borderColor.name());
+
+        // Save gender.
+        if (!person.gender.isEmpty()) {
+            xml.writeAttribute("gender", person.gender);
+        }
+
+        // Save photo file names.
+        for (const QString &photo: person.photos) {
+            xml.writeEmptyElement("photo");
+
+            // Hack: remove folder path to save relative file name.
+            if (copyPhotos && photo.startsWith(prefix)) {
+                QString relativePath = photo;
+                relativePath.remove(prefix);
+                xml.writeAttribute("project_dir_path", relativePath);
+            }
+
+            xml.writeAttribute("path", photo);
+        }
+
+        if (!person.photos.isEmpty()) {
+            xml.writeEndElement();
+        }
+    }
+
+    //
+    // Save relationships.
+    //
+    for (const RelationshipRecord &relationship: snapshot.relationships) {
+        xml.writeEmptyElement("relationship");
+        xml.writeAttribute("from", relationship.from.toString());
+        xml.writeAttribute("to", relationship.to.toString());
+        xml.writeAttribute("color", relationship.color.name());
+    }
+
+    //
+    // Save marriages.
+    //
+    for (const MarriageRecord &marriage: snapshot.marriages) {
+        xml.writeEmptyElement("marriage");
+        xml.writeAttribute("x", QString::number(marriage.pos.x()));
+        xml.writeAttribute("y", QString::number(marriage.pos.y()));
+        xml.writeAttribute("person_left", marriage.personLeft.toString());
+        xml.writeAttribute("person_right", marriage.personRight.toString());
+        xml.writeAttribute("date", marriage.date.toString());
+        xml.writeAttribute("place", marriage.place);
+    }
+
+    xml.writeEndElement();
+    xml.writeEndDocument();
+}
+
+bool DiagramWriter::save(DiagramSnapshot &snapshot, const QString &fileName, QString *errorString)
+{
+    bool binary = DiagramBinary::isBinaryFileName(fileName);
+
+    QSaveFile file(fileName);
+    QIODevice::OpenMode mode = binary ? QIODevice::WriteOnly : QIODevice::WriteOnly | QIODevice::Text;
+    if (!file.open(mode)) {
+        *errorString = tr("Cannot write file %1:\n%2.").arg(fileName).arg(file.errorString());
+        return false;
+    }
+
+    copyPhotos(snapshot);
+
+    if (binary) {
+        DiagramBinary::write(snapshot, &file);
+    }
+    else {
+        write(snapshot, &file);
+    }
+
+    if (!file.commit()) {
+        *errorString = tr("Cannot write file %1:\n%2.").arg(fileName).arg(file.errorString());
+        return false;
+    }
+
+    // Delete shared photos that are no longer used.
+    PhotoStore::collectGarbage(snapshot);
+
+    return true;
+}
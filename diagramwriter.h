@@ -0,0 +1,77 @@
+#ifndef DIAGRAMWRITER_H
+#define DIAGRAMWRITER_H
+
+#include "diagramrecords.h"
+
+#include <QCoreApplication>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+/**
+ * @brief The PhotoCopy struct is a photo to copy into the project photos folder.
+ */
+struct PhotoCopy
+{
+    int person; ///< Index into the snapshot persons.
+    int photo; ///< Index into the person photos.
+    QString source;
+    QString dest; ///< Empty for the shared photo store, where the contents decide the name.
+};
+
+/**
+ * @brief The DiagramSnapshot struct is a copy of the diagram data to save.
+ * The strings are shared with the scene until either side changes them.
+ */
+struct DiagramSnapshot
+{
+    qreal width = 5000;
+    qreal height = 5000;
+    QString photosFolderPath;
+    QVector<PersonRecord> persons;
+    QVector<QStringList> photosBefore; ///< The photos of each person when the snapshot was taken.
+    QVector<RelationshipRecord> relationships;
+    QVector<MarriageRecord> marriages;
+    QVector<PhotoCopy> photoCopies;
+    QStringList retainedPhotos; ///< Photos that undo can bring back, kept in the photo store.
+};
+
+/**
+ * @brief The DiagramWriter class writes a diagram snapshot to a genealogy file.
+ * It does not touch the scene, so it can run on a worker thread.
+ */
+class DiagramWriter
+{
+    Q_DECLARE_TR_FUNCTIONS(DiagramWriter)
+
+public:
+    /**
+     * @brief copyPhotos Copy the photos into the project photos folder, in parallel.
+     * Photos that are already there are skipped. A photo that cannot be copied
+     * keeps its original path.
+     * @param snapshot The snapshot. The person photo paths are updated.
+     */
+    static void copyPhotos(DiagramSnapshot &snapshot);
+
+    /**
+     * @brief write Write the snapshot as XML.
+     * @param snapshot The snapshot.
+     * @param device The file to write.
+     */
+    static void write(const DiagramSnapshot &snapshot, QIODevice *device);
+
+    /**
+     * @brief save Copy the photos and replace the file with the snapshot.
+     * The file is only replaced once it has been written completely.
+     * Files with the binary extension are written in the binary format.
+     * @param snapshot The snapshot.
+     * @param fileName The file name.
+     * @param errorString Set to the error message if the save fails.
+     * @return True if saved OK.
+     */
+    static bool save(DiagramSnapshot &snapshot, const QString &fileName, QString *errorString);
+};
+
+#endif // DIAGRAMWRITER_H
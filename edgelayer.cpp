@@ -0,0 +1,280 @@
+#include "edgelayer.h"
+#include "arrow.h"
+
+#include <QMap>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QtMath>
+
+// The width and height of each grid cell.
+static const qreal cellSize = 512;
+
+EdgeLayer::EdgeLayer()
+{
+    // Clicks go through to the items below. The scene asks for arrows with arrowAt().
+    setAcceptedMouseButtons(Qt::NoButton);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+    setZValue(-1000.0);
+}
+
+QRectF EdgeLayer::boundingRect() const
+{
+    return m_bounds;
+}
+
+QPainterPath EdgeLayer::shape() const
+{
+    return QPainterPath();
+}
+
+void EdgeLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *)
+{
+    // One path of lines and one of arrowheads for each color and width.
+    struct Batch
+    {
+        QPen pen;
+        QPainterPath lines;
+        QPainterPath heads;
+    };
+
+    QRectF exposed = option->exposedRect;
+    QRect range = cellRange(exposed);
+    QMap<QPair<QRgb, int>, int> batchOf;
+    QVector<Batch> batches;
+
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            auto cell = m_cells.constFind(cellKey(x, y));
+            if (cell == m_cells.constEnd()) {
+                continue;
+            }
+
+            for (Arrow *arrow: cell.value()) {
+                if (arrow->isVisible() || !arrow->hasLine()) {
+                    continue;
+                }
+
+                // Draw each arrow once, in the first exposed cell it covers.
+                QRect cells = m_entries.value(arrow).cells;
+                if (x != qMax(cells.left(), range.left()) || y != qMax(cells.top(), range.top())) {
+                    continue;
+                }
+                if (!arrow->sceneBoundingRect().intersects(exposed)) {
+                    continue;
+                }
+
+                QPen pen = arrow->pen();
+                QPair<QRgb, int> key(arrow->getColor().rgba(), pen.width());
+                int number = batchOf.value(key, -1);
+                if (number == -1) {
+                    number = batches.size();
+                    batchOf.insert(key, number);
+                    batches.append(Batch());
+                    pen.setColor(arrow->getColor());
+                    batches.last().pen = pen;
+                }
+
+                Batch &batch = batches[number];
+                QLineF line = arrow->line();
+                batch.lines.moveTo(line.p1());
+                batch.lines.lineTo(line.p2());
+                batch.heads.addPolygon(arrow->arrowHeadPolygon());
+                batch.heads.closeSubpath();
+            }
+        }
+    }
+
+    for (const Batch &batch: batches) {
+        painter->setPen(batch.pen);
+        painter->setBrush(Qt::NoBrush);
+        painter->drawPath(batch.lines);
+        painter->setBrush(batch.pen.color());
+        painter->drawPath(batch.heads);
+    }
+}
+
+void EdgeLayer::addArrow(Arrow *arrow)
+{
+    if (m_entries.contains(arrow)) {
+        return;
+    }
+
+    arrow->setVisible(false);
+    index(arrow);
+}
+
+void EdgeLayer::removeArrow(Arrow *arrow)
+{
+    if (!m_entries.contains(arrow)) {
+        return;
+    }
+
+    unindex(arrow);
+    m_shown.remove(arrow);
+}
+
+void EdgeLayer::updateArrow(Arrow *arrow)
+{
+    if (!m_entries.contains(arrow)) {
+        return;
+    }
+
+    unindex(arrow);
+    index(arrow);
+}
+
+void EdgeLayer::clear()
+{
+    m_cells.clear();
+    m_entries.clear();
+    m_shown.clear();
+    update();
+}
+
+Arrow *EdgeLayer::arrowAt(const QPointF &pos) const
+{
+    QRect range = cellRange(QRectF(pos, QSizeF()));
+    auto cell = m_cells.constFind(cellKey(range.left(), range.top()));
+    if (cell == m_cells.constEnd()) {
+        return nullptr;
+    }
+
+    for (Arrow *arrow: cell.value()) {
+        if (!arrow->isVisible() && arrow->shape().contains(arrow->mapFromScene(pos))) {
+            return arrow;
+        }
+    }
+
+    return nullptr;
+}
+
+void EdgeLayer::showArrow(Arrow *arrow)
+{
+    if (!m_entries.contains(arrow)) {
+        return;
+    }
+
+    arrow->setVisible(true);
+    m_shown.insert(arrow);
+    update(arrow->sceneBoundingRect());
+}
+
+void EdgeLayer::showArrowsIn(const QPainterPath &area)
+{
+    QRect range = cellRange(area.boundingRect());
+
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            auto cell = m_cells.constFind(cellKey(x, y));
+            if (cell == m_cells.constEnd()) {
+                continue;
+            }
+
+            // An arrow in several cells is only shown once, since it is then visible.
+            for (Arrow *arrow: cell.value()) {
+                if (!arrow->isVisible() && area.intersects(arrow->mapToScene(arrow->shape()))) {
+                    showArrow(arrow);
+                }
+            }
+        }
+    }
+}
+
+void EdgeLayer::showAll()
+{
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        it.key()->setVisible(true);
+        m_shown.insert(it.key());
+    }
+    update();
+}
+
+void EdgeLayer::hideUnselected()
+{
+    for (auto it = m_shown.begin(); it != m_shown.end(); ) {
+        Arrow *arrow = *it;
+        if (arrow->isSelected()) {
+            ++it;
+            continue;
+        }
+
+        arrow->setVisible(false);
+        update(arrow->sceneBoundingRect());
+        it = m_shown.erase(it);
+    }
+}
+
+int EdgeLayer::arrowCount() const
+{
+    return m_entries.size();
+}
+
+///
+/// \brief EdgeLayer::cellRange Get the cells covered by a rectangle.
+///
+QRect EdgeLayer::cellRange(const QRectF &rect) const
+{
+    int left = qFloor(rect.left() / cellSize);
+    int top = qFloor(rect.top() / cellSize);
+    int right = qFloor(rect.right() / cellSize);
+    int bottom = qFloor(rect.bottom() / cellSize);
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+quint64 EdgeLayer::cellKey(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+void EdgeLayer::index(Arrow *arrow)
+{
+    Entry entry;
+    entry.rect = arrow->sceneBoundingRect();
+    entry.cells = cellRange(entry.rect);
+    m_entries.insert(arrow, entry);
+
+    const QRectF &rect = entry.rect;
+    const QRect &range = entry.cells;
+
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            m_cells[cellKey(x, y)] << arrow;
+        }
+    }
+
+    // Grow to cover the arrow.
+    if (!m_bounds.contains(rect)) {
+        prepareGeometryChange();
+        m_bounds = m_bounds.united(rect);
+    }
+
+    update(rect);
+}
+
+void EdgeLayer::unindex(Arrow *arrow)
+{
+    auto found = m_entries.find(arrow);
+    if (found == m_entries.end()) {
+        return;
+    }
+
+    Entry entry = found.value();
+    QRect range = entry.cells;
+    m_entries.erase(found);
+
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            auto cell = m_cells.find(cellKey(x, y));
+            if (cell == m_cells.end()) {
+                continue;
+            }
+            cell.value().removeOne(arrow);
+            if (cell.value().isEmpty()) {
+                m_cells.erase(cell);
+            }
+        }
+    }
+
+    // The bounds are not shrunk, since drawing an empty area costs little.
+    update(entry.rect);
+}
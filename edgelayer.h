@@ -0,0 +1,104 @@
+#ifndef EDGELAYER_H
+#define EDGELAYER_H
+
+#include <QGraphicsItem>
+#include <QPainterPath>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+class Arrow;
+
+/**
+ * @brief The EdgeLayer class draws the parent/child arrows of a large diagram
+ * in one item, with a few paths per color and line width.
+ *
+ * The arrows still hold the links, but are hidden while in the layer, so the
+ * scene does not draw them one by one. Each arrow is listed in the cells of a
+ * grid that it covers, so painting and clicking only look at the arrows near
+ * the exposed area. An arrow that is clicked is shown again, so that it can
+ * be selected and edited, and goes back into the layer when deselected.
+ */
+class EdgeLayer : public QGraphicsItem
+{
+public:
+    enum { Type = UserType + 5 };
+
+    EdgeLayer();
+
+    int type() const override { return Type; }
+    QRectF boundingRect() const override;
+    QPainterPath shape() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
+
+    /**
+     * @brief addArrow Draw an arrow in the layer, hiding the arrow itself.
+     */
+    void addArrow(Arrow *arrow);
+
+    /**
+     * @brief removeArrow Stop drawing an arrow.
+     */
+    void removeArrow(Arrow *arrow);
+
+    /**
+     * @brief updateArrow Read the position and colors of an arrow again.
+     */
+    void updateArrow(Arrow *arrow);
+
+    /**
+     * @brief clear Remove all arrows, when the scene is cleared.
+     */
+    void clear();
+
+    /**
+     * @brief arrowAt Find the arrow drawn at a point.
+     * @param pos The point, in scene coordinates.
+     * @return The arrow, or null if none.
+     */
+    Arrow *arrowAt(const QPointF &pos) const;
+
+    /**
+     * @brief showArrow Show an arrow as its own item, so it can be selected.
+     */
+    void showArrow(Arrow *arrow);
+
+    /**
+     * @brief showArrowsIn Show the arrows that touch an area, so that a
+     * selection of the area can include them.
+     * @param area The area, in scene coordinates.
+     */
+    void showArrowsIn(const QPainterPath &area);
+
+    /**
+     * @brief showAll Show all arrows, so that they can all be selected.
+     */
+    void showAll();
+
+    /**
+     * @brief hideUnselected Take the shown arrows that are no longer selected
+     * back into the layer.
+     */
+    void hideUnselected();
+
+    int arrowCount() const;
+
+private:
+    QRect cellRange(const QRectF &rect) const;
+    static quint64 cellKey(int x, int y);
+    void index(Arrow *arrow);
+    void unindex(Arrow *arrow);
+
+    struct Entry
+    {
+        QRectF rect; ///< Where the arrow was drawn.
+        QRect cells; ///< The cells it covers.
+    };
+
+    QHash<quint64, QVector<Arrow *> > m_cells;
+    QHash<Arrow *, Entry> m_entries;
+    QSet<Arrow *> m_shown; ///< Arrows drawn by themselves for now.
+    QRectF m_bounds;
+};
+
+#endif // EDGELAYER_H
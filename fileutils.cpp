@@ -1,11 +1,21 @@
 #include "fileutils.h"
 
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
 
+#include <cstdio>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
 FileUtils::FileUtils()
 {
 
@@ -101,6 +111,151 @@ bool FileUtils::copyAndReplace(const QString &source, const QString &dest)
     return QFile::copy(source, dest);
 }
 
+/**
+ * @brief cloneFile Create the destination as a reflink of the source, sharing
+ * its data blocks until either file is changed.
+ * @param source The source file path.
+ * @param dest The destination file path. It must not exist.
+ * @return True if successful, false if the file system does not support it.
+ */
+static bool cloneFile(const QString &source, const QString &dest)
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    int sourceFd = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+    if (sourceFd < 0) {
+        return false;
+    }
+
+    int destFd = ::open(QFile::encodeName(dest).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (destFd < 0) {
+        ::close(sourceFd);
+        return false;
+    }
+
+    bool clonedOK = (::ioctl(destFd, FICLONE, sourceFd) == 0);
+
+    ::close(destFd);
+    ::close(sourceFd);
+
+    // Remove the empty file, so a normal copy can be made.
+    if (!clonedOK) {
+        QFile::remove(dest);
+        return false;
+    }
+
+    QFile::setPermissions(dest, QFile::permissions(source));
+    return true;
+#else
+    Q_UNUSED(source);
+    Q_UNUSED(dest);
+    return false;
+#endif
+}
+
+/**
+ * @brief replaceFile Move a file over another in the same folder, replacing it.
+ * @param source The file to move.
+ * @param dest The file to replace, if it exists.
+ * @return True if successful. The destination is left as it was if not.
+ */
+static bool replaceFile(const QString &source, const QString &dest)
+{
+#ifdef Q_OS_UNIX
+    // Renaming within a folder replaces the destination in one step.
+    return std::rename(QFile::encodeName(source).constData(), QFile::encodeName(dest).constData()) == 0;
+#else
+    if (QFile::exists(dest) && !QFile::remove(dest)) {
+        return false;
+    }
+    return QFile::rename(source, dest);
+#endif
+}
+
+QByteArray FileUtils::hashFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly)) {
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!hash.addData(&file)) {
+        return QByteArray();
+    }
+
+    return hash.result();
+}
+
+bool FileUtils::hasSameContents(const QString &first, const QString &second)
+{
+    QFileInfo firstInfo(first);
+    QFileInfo secondInfo(second);
+
+    if (!firstInfo.isFile() || !secondInfo.isFile() || firstInfo.size() != secondInfo.size()) {
+        return false;
+    }
+
+    QByteArray firstHash = hashFile(first);
+    return !firstHash.isEmpty() && firstHash == hashFile(second);
+}
+
+bool FileUtils::syncFile(const QString &source, const QString &dest, bool *skipped)
+{
+    if (skipped) {
+        *skipped = false;
+    }
+
+    if (source == dest)
+    {
+        qDebug() << "Source and destination are the same. Skipping.";
+        return false;
+    }
+
+    QFileInfo sourceInfo(source);
+    QFileInfo destInfo(dest);
+
+    if (!sourceInfo.isFile()) {
+        return false;
+    }
+
+    // Skip if the destination is already a copy. Copies are given the time of
+    // the source, so the size and time are enough to tell in most cases.
+    if (destInfo.isFile() && destInfo.size() == sourceInfo.size()) {
+        bool sameTime = (destInfo.lastModified() == sourceInfo.lastModified());
+
+        if (sameTime || hasSameContents(source, dest)) {
+            if (skipped) {
+                *skipped = true;
+            }
+            return true;
+        }
+    }
+
+    // Copy to a temporary name next to the destination, so the old copy is
+    // kept if the copy fails.
+    QString temp = destInfo.absoluteDir().filePath("." + destInfo.fileName() + ".part");
+    QFile::remove(temp);
+
+    if (!cloneFile(source, temp) && !QFile::copy(source, temp)) {
+        QFile::remove(temp);
+        return false;
+    }
+
+    // Give the copy the time of the source, so the next save can skip it.
+    QFile tempFile(temp);
+    if (tempFile.open(QFile::ReadWrite)) {
+        tempFile.setFileTime(sourceInfo.lastModified(), QFileDevice::FileModificationTime);
+        tempFile.close();
+    }
+
+    if (!replaceFile(temp, dest)) {
+        QFile::remove(temp);
+        return false;
+    }
+
+    return true;
+}
+
 QString FileUtils::getPhotosFolderFor(const QString &fileName)
 {
     if (fileName.isEmpty()) {
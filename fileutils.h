@@ -1,6 +1,7 @@
 #ifndef FILEUTILS_H
 #define FILEUTILS_H
 
+#include <QByteArray>
 #include <QString>
 
 class FileUtils
@@ -16,6 +17,32 @@ public:
      */
     static bool copyAndReplace(const QString &source, const QString &dest);
 
+    /**
+     * @brief syncFile Make the destination a copy of the source, skipping the
+     * copy if the destination already has the same contents. The copy is a
+     * reflink where the file system supports it.
+     * @param source The source file path.
+     * @param dest The destination file path.
+     * @param skipped Set to true if the destination was already up to date.
+     * @return True if successful.
+     */
+    static bool syncFile(const QString &source, const QString &dest, bool *skipped = nullptr);
+
+    /**
+     * @brief hashFile Get a hash of the contents of a file.
+     * @param fileName The file path.
+     * @return The SHA-1 hash, or an empty array if the file cannot be read.
+     */
+    static QByteArray hashFile(const QString &fileName);
+
+    /**
+     * @brief hasSameContents Check whether two files have the same contents.
+     * @param first The first file path.
+     * @param second The second file path.
+     * @return True if both files could be read and are the same.
+     */
+    static bool hasSameContents(const QString &first, const QString &second);
+
     /**
      * @brief getPhotosFolderFor Get the project photos directory.
      * @param fileName The project (XML) file name.
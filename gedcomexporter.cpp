@@ -0,0 +1,265 @@
+#include "gedcomexporter.h"
+#include "diagramitem.h"
+#include "diagramscene.h"
+#include "marriageitem.h"
+
+#include <QHash>
+#include <QIODevice>
+#include <QTextStream>
+
+// Longest value written on one line. The rest is continued with CONC lines.
+static const int maxValueLength = 200;
+
+GedcomExporter::GedcomExporter()
+{
+
+}
+
+bool GedcomExporter::write(DiagramScene *scene, QIODevice *device)
+{
+    m_errorString.clear();
+    m_individuals.clear();
+    m_families.clear();
+
+    // Number the persons.
+    QHash<DiagramItem *, int> indexes;
+    indexes.reserve(scene->persons().size());
+
+    for (DiagramItem *person: scene->persons()) {
+        indexes[person] = m_individuals.size();
+        m_individuals.append(Individual());
+        m_individuals.last().person = person;
+    }
+
+    // Create a family for each marriage.
+    for (auto marriage: scene->marriages()) {
+        int family = marry(indexes.value(marriage->personLeft()),
+                           indexes.value(marriage->personRight()));
+        m_families[family].marriageDate = marriage->getDate().toString();
+        m_families[family].marriagePlace = marriage->getPlace();
+    }
+
+    // Add each child to the family of the parent.
+    for (int i = 0; i < m_individuals.size(); ++i) {
+        for (auto child: m_individuals[i].person->getChildren()) {
+            addChild(i, indexes.value(child));
+        }
+    }
+
+    // Write the file.
+    QTextStream out(device);
+    out.setCodec("UTF-8");
+
+    writeLine(out, 0, "HEAD");
+
+    // Write the persons.
+    for (int i = 0; i < m_individuals.size(); ++i) {
+        const Individual &individual = m_individuals[i];
+        DiagramItem *person = individual.person;
+
+        writeLine(out, 0, "INDI", QString(), individualPointer(i));
+        writeLine(out, 1, "NAME", person->name());
+
+        if (!person->getLastName().isEmpty()) {
+            writeLine(out, 2, "SURN", person->getLastName());
+        }
+        if (!person->getFirstName().isEmpty()) {
+            writeLine(out, 2, "GIVN", person->getFirstName());
+        }
+
+        if (!person->getGender().isEmpty()) {
+            writeLine(out, 1, "SEX", person->getGender());
+        }
+
+        writeLine(out, 1, "BIRT");
+        writeLine(out, 2, "DATE", person->getDateOfBirth().toString());
+        if (!person->getPlaceOfBirth().isEmpty()) {
+            writeLine(out, 2, "PLAC", person->getPlaceOfBirth());
+        }
+
+        QString dateOfDeath = person->getDateOfDeath().toString();
+        if (!dateOfDeath.isEmpty() || !person->getPlaceOfDeath().isEmpty()) {
+            writeLine(out, 1, "DEAT");
+            if (!dateOfDeath.isEmpty()) {
+                writeLine(out, 2, "DATE", dateOfDeath);
+            }
+            if (!person->getPlaceOfDeath().isEmpty()) {
+                writeLine(out, 2, "PLAC", person->getPlaceOfDeath());
+            }
+        }
+
+        for (int family: individual.familiesAsSpouse) {
+            writeLine(out, 1, "FAMS", familyPointer(family));
+        }
+        for (int family: individual.familiesAsChild) {
+            writeLine(out, 1, "FAMC", familyPointer(family));
+        }
+    }
+
+    // Write the families.
+    for (int i = 0; i < m_families.size(); ++i) {
+        const Family &family = m_families[i];
+
+        writeLine(out, 0, "FAM", QString(), familyPointer(i));
+
+        if (family.husband >= 0) {
+            writeLine(out, 1, "HUSB", individualPointer(family.husband));
+        }
+        if (family.wife >= 0) {
+            writeLine(out, 1, "WIFE", individualPointer(family.wife));
+        }
+
+        if (!family.marriageDate.isEmpty() || !family.marriagePlace.isEmpty()) {
+            writeLine(out, 1, "MARR");
+            if (!family.marriageDate.isEmpty()) {
+                writeLine(out, 2, "DATE", family.marriageDate);
+            }
+            if (!family.marriagePlace.isEmpty()) {
+                writeLine(out, 2, "PLAC", family.marriagePlace);
+            }
+        }
+
+        for (int child: family.children) {
+            writeLine(out, 1, "CHIL", individualPointer(child));
+        }
+    }
+
+    writeLine(out, 0, "TRLR");
+
+    // Check for errors.
+    out.flush();
+    if (out.status() != QTextStream::Ok) {
+        m_errorString = device->errorString();
+        return false;
+    }
+
+    return true;
+}
+
+QString GedcomExporter::errorString() const
+{
+    return m_errorString;
+}
+
+///
+/// \brief GedcomExporter::familyAsSpouse Get (or create) the family where the person is a spouse.
+/// \param person The person index.
+/// \return The family index.
+///
+int GedcomExporter::familyAsSpouse(int person)
+{
+    Individual &individual = m_individuals[person];
+
+    if (individual.familiesAsSpouse.isEmpty()) {
+        Family family;
+
+        // Unknown gender is treated as the husband.
+        if (individual.person->getGender() == "F") {
+            family.wife = person;
+        }
+        else {
+            family.husband = person;
+        }
+
+        individual.familiesAsSpouse << m_families.size();
+        m_families << family;
+    }
+
+    return individual.familiesAsSpouse.first();
+}
+
+///
+/// \brief GedcomExporter::marry Make sure the husband and wife share a family.
+/// \param husband The husband index.
+/// \param wife The wife index.
+/// \return The family index.
+///
+int GedcomExporter::marry(int husband, int wife)
+{
+    int family = 0;
+
+    if (m_individuals[husband].familiesAsSpouse.isEmpty()) {
+        if (m_individuals[wife].familiesAsSpouse.isEmpty()) {
+            family = familyAsSpouse(husband);
+            m_individuals[wife].familiesAsSpouse << family;
+        }
+        else {
+            family = m_individuals[wife].familiesAsSpouse.first();
+            m_individuals[husband].familiesAsSpouse << family;
+        }
+    }
+    else {
+        family = m_individuals[husband].familiesAsSpouse.first();
+        m_individuals[wife].familiesAsSpouse << family;
+    }
+
+    m_families[family].husband = husband;
+    m_families[family].wife = wife;
+
+    return family;
+}
+
+///
+/// \brief GedcomExporter::addChild Add the child to the family of the parent.
+/// \param parent The parent index.
+/// \param child The child index.
+///
+void GedcomExporter::addChild(int parent, int child)
+{
+    int family = familyAsSpouse(parent);
+
+    if (!m_families[family].children.contains(child)) {
+        m_families[family].children << child;
+    }
+
+    if (!m_individuals[child].familiesAsChild.contains(family)) {
+        m_individuals[child].familiesAsChild << family;
+    }
+}
+
+QString GedcomExporter::individualPointer(int index)
+{
+    return QString("@I%1@").arg(index + 1);
+}
+
+QString GedcomExporter::familyPointer(int index)
+{
+    return QString("@F%1@").arg(index + 1);
+}
+
+///
+/// \brief GedcomExporter::writeLine Write a line in the format: level [pointer] tag [value]
+/// Values with line breaks are continued with CONT lines, and long values with CONC lines.
+///
+void GedcomExporter::writeLine(QTextStream &out, int level, const QString &tag,
+                               const QString &value, const QString &pointer)
+{
+    QStringList lines = value.split('\n');
+    bool firstLine = true;
+
+    for (int i = 0; i < lines.size(); ++i) {
+        QString text = lines[i];
+        text.remove('\r');
+
+        QString lineTag = (i == 0) ? tag : QString("CONT");
+        int lineLevel = (i == 0) ? level : level + 1;
+
+        // Split long lines.
+        do {
+            out << lineLevel;
+            if (firstLine && !pointer.isEmpty()) {
+                out << ' ' << pointer;
+            }
+            out << ' ' << lineTag;
+            if (!text.isEmpty()) {
+                out << ' ' << text.left(maxValueLength);
+            }
+            out << '\n';
+            firstLine = false;
+
+            text.remove(0, maxValueLength);
+            lineTag = "CONC";
+            lineLevel = level + 1;
+        } while (!text.isEmpty());
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef GEDCOMEXPORTER_H
+#define GEDCOMEXPORTER_H
+
+#include <QString>
+#include <QVector>
+
+class DiagramItem;
+class DiagramScene;
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+class QTextStream;
+QT_END_NAMESPACE
+
+/**
+ * @brief The GedcomExporter class writes the persons in a scene to a GEDCOM
+ * file as INDI records, grouped into FAM records by marriage and child arrows.
+ */
+class GedcomExporter
+{
+public:
+    GedcomExporter();
+
+    /**
+     * @brief write Write the scene in GEDCOM format.
+     * @param scene The scene.
+     * @param device The file to write.
+     * @return True if written OK, false otherwise.
+     */
+    bool write(DiagramScene *scene, QIODevice *device);
+
+    QString errorString() const;
+
+private:
+    struct Individual
+    {
+        DiagramItem *person = nullptr;
+        QVector<int> familiesAsSpouse;
+        QVector<int> familiesAsChild;
+    };
+
+    struct Family
+    {
+        int husband = -1;
+        int wife = -1;
+        QVector<int> children;
+        QString marriageDate;
+        QString marriagePlace;
+    };
+
+    int familyAsSpouse(int person);
+    int marry(int husband, int wife);
+    void addChild(int parent, int child);
+
+    static QString individualPointer(int index);
+    static QString familyPointer(int index);
+    static void writeLine(QTextStream &out, int level, const QString &tag,
+                          const QString &value = QString(), const QString &pointer = QString());
+
+    QString m_errorString;
+    QVector<Individual> m_individuals;
+    QVector<Family> m_families;
+};
+
+#endif // GEDCOMEXPORTER_H
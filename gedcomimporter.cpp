@@ -0,0 +1,473 @@
+#include "gedcomimporter.h"
+#include "diagramscene.h"
+
+#include <QIODevice>
+#include <QObject>
+
+/**
+ * @brief parseSortDate Parse a marriage date in the "01 JUN 2001" format,
+ * which is used to find the latest marriage of each person.
+ * @param string The GEDCOM date.
+ * @return The date, or an invalid date for any other format.
+ */
+static QDate parseSortDate(const QString &string)
+{
+    static const QStringList months = QStringList()
+            << "JAN" << "FEB" << "MAR" << "APR" << "MAY" << "JUN"
+            << "JUL" << "AUG" << "SEP" << "OCT" << "NOV" << "DEC";
+
+    QStringList parts = string.split(' ', QString::SkipEmptyParts);
+    if (parts.size() != 3) {
+        return QDate();
+    }
+
+    bool dayOK = false;
+    bool yearOK = false;
+    int day = parts[0].toInt(&dayOK);
+    int month = months.indexOf(parts[1].toUpper()) + 1;
+    int year = parts[2].toInt(&yearOK);
+
+    if (!dayOK || !yearOK || month == 0 || parts[2].size() != 4) {
+        return QDate();
+    }
+
+    return QDate(year, month, day);
+}
+
+GedcomImporter::GedcomImporter() :
+    m_recordType(OtherRecord)
+{
+
+}
+
+bool GedcomImporter::read(QIODevice *device)
+{
+    m_errorString.clear();
+    m_individuals.clear();
+    m_families.clear();
+    m_familyIndex.clear();
+    m_recordTags.clear();
+    m_notes.clear();
+    m_recordType = OtherRecord;
+    m_level1Tag.clear();
+    m_notePointer.clear();
+
+    // Read one line at a time.
+    int lineNumber = 0;
+    Line line;
+
+    while (!device->atEnd()) {
+        QString text = QString::fromUtf8(device->readLine());
+        ++lineNumber;
+
+        // Skip byte order mark.
+        if (lineNumber == 1 && text.startsWith(QChar(0xFEFF))) {
+            text.remove(0, 1);
+        }
+
+        // Skip blank lines.
+        if (text.trimmed().isEmpty()) {
+            continue;
+        }
+
+        if (!parseLine(text, line)) {
+            m_errorString = QObject::tr("Line %1 of document violates GEDCOM format 5.5.")
+                    .arg(lineNumber);
+            return false;
+        }
+
+        addLine(line);
+    }
+
+    // Finish the last record.
+    finishName();
+
+    buildRecords();
+
+    return true;
+}
+
+void GedcomImporter::populate(DiagramScene *scene) const
+{
+    scene->beginLoad(5000, 5000);
+    scene->reservePersons(m_persons.size(), true);
+
+    for (const PersonRecord &record: m_persons) {
+        scene->addPerson(record);
+    }
+
+    for (const RelationshipRecord &record: m_relationships) {
+        scene->addRelationship(record);
+    }
+
+    for (const MarriageRecord &record: m_marriages) {
+        scene->addMarriage(record);
+    }
+
+    scene->buildTextIndex();
+}
+
+QString GedcomImporter::errorString() const
+{
+    return m_errorString;
+}
+
+const QVector<PersonRecord> &GedcomImporter::persons() const
+{
+    return m_persons;
+}
+
+const QVector<RelationshipRecord> &GedcomImporter::relationships() const
+{
+    return m_relationships;
+}
+
+const QVector<MarriageRecord> &GedcomImporter::marriages() const
+{
+    return m_marriages;
+}
+
+///
+/// \brief GedcomImporter::parseLine Split a line into its level, pointer, tag and value.
+/// \param text The line, in the format: level [pointer] tag [value]
+/// \param line The parts of the line.
+/// \return False if the line is not in GEDCOM format.
+///
+bool GedcomImporter::parseLine(const QString &text, Line &line)
+{
+    int size = text.size();
+
+    // Ignore line endings.
+    while (size > 0 && (text[size - 1] == '\n' || text[size - 1] == '\r')) {
+        --size;
+    }
+
+    // Skip leading white space.
+    int pos = 0;
+    while (pos < size && text[pos].isSpace()) {
+        ++pos;
+    }
+
+    // Read the level.
+    int start = pos;
+    while (pos < size && text[pos].isDigit()) {
+        ++pos;
+    }
+    if (pos == start || pos >= size || text[pos] != ' ') {
+        return false;
+    }
+    line.level = text.midRef(start, pos - start).toInt();
+    ++pos;
+
+    // Read the pointer.
+    line.pointer.clear();
+    if (pos < size && text[pos] == '@') {
+        int end = text.indexOf('@', pos + 1);
+        if (end < 0 || end == pos + 1 || end + 1 >= size || text[end + 1] != ' ') {
+            return false;
+        }
+        line.pointer = text.mid(pos, end + 1 - pos);
+        pos = end + 2;
+    }
+
+    // Read the tag.
+    start = pos;
+    while (pos < size && (text[pos].isLetterOrNumber() || text[pos] == '_')) {
+        ++pos;
+    }
+    if (pos == start) {
+        return false;
+    }
+    line.tag = text.mid(start, pos - start);
+
+    // Read the value.
+    if (pos < size) {
+        if (text[pos] != ' ') {
+            return false;
+        }
+        line.value = text.mid(pos + 1, size - pos - 1);
+    }
+    else {
+        line.value.clear();
+    }
+
+    return true;
+}
+
+///
+/// \brief GedcomImporter::addLine Add the line to the current record.
+/// \param line The line.
+///
+void GedcomImporter::addLine(const Line &line)
+{
+    // Close the previous block.
+    if (line.level <= 1) {
+        finishName();
+        m_level1Tag.clear();
+    }
+
+    // Start of a new record.
+    if (line.level == 0) {
+        if (!line.pointer.isEmpty()) {
+            m_recordTags[line.pointer] = line.tag;
+        }
+
+        if (line.tag == "INDI") {
+            m_recordType = IndividualRecord;
+            m_individuals.append(Individual());
+            m_individuals.last().pointer = line.pointer;
+        }
+        else if (line.tag == "FAM") {
+            m_recordType = FamilyRecord;
+            m_familyIndex[line.pointer] = m_families.size();
+            m_families.append(Family());
+            m_families.last().pointer = line.pointer;
+        }
+        else if (line.tag == "NOTE" && !line.pointer.isEmpty()) {
+            m_recordType = NoteRecord;
+            m_notePointer = line.pointer;
+            m_notes[line.pointer] = line.value;
+        }
+        else {
+            m_recordType = OtherRecord;
+        }
+        return;
+    }
+
+    if (line.level == 1) {
+        m_level1Tag = line.tag;
+    }
+
+    if (m_recordType == IndividualRecord) {
+        Individual &individual = m_individuals.last();
+
+        if (line.level == 1) {
+            if (line.tag == "NAME" && !individual.nameDone && !line.value.isEmpty()) {
+                // The name is in the value, with the surname between slashes.
+                QStringList names = line.value.split('/');
+                individual.givenName = names[0].trimmed();
+                if (names.size() > 1) {
+                    individual.surname = names[1].trimmed();
+                }
+                individual.nameDone = true;
+            }
+            else if (line.tag == "SEX") {
+                individual.gender = line.value;
+            }
+            else if (line.tag == "FAMS") {
+                individual.familiesAsSpouse << line.value;
+            }
+            else if (line.tag == "FAMC") {
+                individual.familiesAsChild << line.value;
+            }
+            else if (line.tag == "NOTE") {
+                individual.notes << line.value;
+            }
+        }
+        else if (line.level == 2) {
+            if (m_level1Tag == "NAME" && !individual.nameDone) {
+                if (line.tag == "GIVN") {
+                    individual.givenName = line.value;
+                    individual.foundGivenName = true;
+                }
+                else if (line.tag == "SURN") {
+                    individual.surname = line.value;
+                    individual.foundSurname = true;
+                }
+            }
+            else if (m_level1Tag == "BIRT") {
+                if (line.tag == "DATE") {
+                    individual.dateOfBirth = line.value;
+                }
+                else if (line.tag == "PLAC") {
+                    individual.placeOfBirth = line.value;
+                }
+            }
+            else if (m_level1Tag == "DEAT") {
+                if (line.tag == "DATE") {
+                    individual.dateOfDeath = line.value;
+                }
+                else if (line.tag == "PLAC") {
+                    individual.placeOfDeath = line.value;
+                }
+            }
+            else if (m_level1Tag == "NOTE" && !individual.notes.isEmpty()) {
+                continueNote(individual.notes.last(), line);
+            }
+        }
+    }
+    else if (m_recordType == NoteRecord) {
+        if (line.level == 1) {
+            continueNote(m_notes[m_notePointer], line);
+        }
+    }
+    else if (m_recordType == FamilyRecord) {
+        Family &family = m_families.last();
+
+        if (line.level == 1) {
+            if (line.tag == "HUSB") {
+                family.husband = line.value;
+                family.parents << line.value;
+            }
+            else if (line.tag == "WIFE") {
+                family.wife = line.value;
+                family.parents << line.value;
+            }
+        }
+        else if (line.level == 2 && m_level1Tag == "MARR") {
+            if (line.tag == "DATE") {
+                family.marriageDate = line.value;
+            }
+            else if (line.tag == "PLAC") {
+                family.marriagePlace = line.value;
+            }
+        }
+    }
+}
+
+///
+/// \brief GedcomImporter::finishName Stop looking for a name once a NAME block
+/// has both a given name and a surname.
+///
+void GedcomImporter::finishName()
+{
+    if (m_recordType != IndividualRecord || m_level1Tag != "NAME") {
+        return;
+    }
+
+    Individual &individual = m_individuals.last();
+    if (individual.foundGivenName && individual.foundSurname) {
+        individual.nameDone = true;
+    }
+}
+
+///
+/// \brief GedcomImporter::continueNote Add a CONT or CONC line to a note.
+///
+void GedcomImporter::continueNote(QString &note, const Line &line)
+{
+    if (line.tag == "CONT") {
+        note += '\n' + line.value;
+    }
+    else if (line.tag == "CONC") {
+        note += line.value;
+    }
+}
+
+///
+/// \brief GedcomImporter::buildRecords Turn the INDI and FAM records into persons,
+/// relationships and marriages.
+///
+void GedcomImporter::buildRecords()
+{
+    m_persons.clear();
+    m_relationships.clear();
+    m_marriages.clear();
+    m_persons.reserve(m_individuals.size());
+
+    // Families where someone is a spouse, in the order first listed.
+    QVector<int> spouseFamilies;
+    QVector<bool> familyListed(m_families.size(), false);
+
+    for (const Individual &individual: m_individuals) {
+
+        // Add the person.
+        PersonRecord person;
+        person.pointer = individual.pointer;
+        person.name = individual.givenName + " " + individual.surname;
+        person.firstName = individual.givenName;
+        person.lastName = individual.surname;
+        if (!individual.dateOfBirth.isEmpty()) {
+            person.dateOfBirth = DiagramRecords::parseDate(individual.dateOfBirth);
+        }
+        person.hasDateOfBirth = true;
+        person.placeOfBirth = individual.placeOfBirth;
+        person.gender = individual.gender;
+        if (!individual.dateOfDeath.isEmpty()) {
+            person.dateOfDeath = DiagramRecords::parseDate(individual.dateOfDeath);
+            person.hasDateOfDeath = true;
+        }
+        person.placeOfDeath = individual.placeOfDeath;
+
+        // Put the notes in the bio.
+        QStringList notes;
+        for (const QString &note: individual.notes) {
+            notes << m_notes.value(note, note);
+        }
+        person.bio = notes.join("\n\n");
+
+        m_persons << person;
+
+        // Add a relationship from each parent.
+        for (const QString &familyPointer: individual.familiesAsChild) {
+            int index = m_familyIndex.value(familyPointer, -1);
+            if (index < 0) {
+                continue;
+            }
+
+            for (const QString &parent: m_families[index].parents) {
+                if (m_recordTags.contains(parent)) {
+                    RelationshipRecord relationship;
+                    relationship.fromPointer = parent;
+                    relationship.toPointer = individual.pointer;
+                    m_relationships << relationship;
+                }
+            }
+        }
+
+        // Note the families as spouse.
+        for (const QString &familyPointer: individual.familiesAsSpouse) {
+            int index = m_familyIndex.value(familyPointer, -1);
+            if (index >= 0 && !familyListed[index]) {
+                familyListed[index] = true;
+                spouseFamilies << index;
+            }
+        }
+    }
+
+    // Find the latest marriage for each spouse.
+    QHash<QString, int> latestMarriages;
+
+    for (int index: spouseFamilies) {
+        const Family &family = m_families[index];
+        if (family.husband.isEmpty() || family.wife.isEmpty()) {
+            continue;
+        }
+
+        QDate date = parseSortDate(family.marriageDate);
+
+        for (const QString &spouse: { family.husband, family.wife }) {
+            if (!latestMarriages.contains(spouse)) {
+                latestMarriages[spouse] = index;
+            }
+            else if (date.isValid()) {
+                QDate latestDate = parseSortDate(m_families[latestMarriages[spouse]].marriageDate);
+                if (!latestDate.isValid() || date > latestDate) {
+                    latestMarriages[spouse] = index;
+                }
+            }
+        }
+    }
+
+    // Only add a marriage if it is the latest for both the husband and the wife.
+    for (int index: spouseFamilies) {
+        const Family &family = m_families[index];
+        if (family.husband.isEmpty() || family.wife.isEmpty()) {
+            continue;
+        }
+
+        if (latestMarriages[family.husband] != index || latestMarriages[family.wife] != index) {
+            continue;
+        }
+
+        MarriageRecord marriage;
+        marriage.leftPointer = family.husband;
+        marriage.rightPointer = family.wife;
+        if (!family.marriageDate.isEmpty()) {
+            marriage.date = DiagramRecords::parseDate(family.marriageDate);
+            marriage.hasDate = true;
+        }
+        marriage.place = family.marriagePlace;
+        m_marriages << marriage;
+    }
+}
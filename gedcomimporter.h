@@ -0,0 +1,107 @@
+#ifndef GEDCOMIMPORTER_H
+#define GEDCOMIMPORTER_H
+
+#include "diagramrecords.h"
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class DiagramScene;
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+/**
+ * @brief The GedcomImporter class reads a GEDCOM 5.5 file line by line and
+ * turns its INDI and FAM records into persons, relationships and marriages.
+ */
+class GedcomImporter
+{
+public:
+    GedcomImporter();
+
+    /**
+     * @brief read Read the GEDCOM file.
+     * @param device The file to read.
+     * @return True if read OK, false otherwise.
+     */
+    bool read(QIODevice *device);
+
+    /**
+     * @brief populate Replace the contents of the scene with the records read.
+     * @param scene The scene.
+     */
+    void populate(DiagramScene *scene) const;
+
+    QString errorString() const;
+
+    const QVector<PersonRecord> &persons() const;
+    const QVector<RelationshipRecord> &relationships() const;
+    const QVector<MarriageRecord> &marriages() const;
+
+private:
+    struct Line
+    {
+        int level = 0;
+        QString pointer;
+        QString tag;
+        QString value;
+    };
+
+    struct Individual
+    {
+        QString pointer;
+        QString givenName;
+        QString surname;
+        bool nameDone = false;
+        bool foundGivenName = false;
+        bool foundSurname = false;
+        QString dateOfBirth;
+        QString placeOfBirth;
+        QString dateOfDeath;
+        QString placeOfDeath;
+        QString gender;
+        QStringList familiesAsSpouse;
+        QStringList familiesAsChild;
+        QStringList notes; ///< The text of each note, or the pointer to a NOTE record.
+    };
+
+    struct Family
+    {
+        QString pointer;
+        QString husband;
+        QString wife;
+        QStringList parents;
+        QString marriageDate;
+        QString marriagePlace;
+    };
+
+    static bool parseLine(const QString &text, Line &line);
+    void addLine(const Line &line);
+    void finishName();
+    static void continueNote(QString &note, const Line &line);
+    void buildRecords();
+
+    QString m_errorString;
+
+    QVector<Individual> m_individuals;
+    QVector<Family> m_families;
+    QHash<QString, int> m_familyIndex;
+    QHash<QString, QString> m_recordTags;
+    QHash<QString, QString> m_notes; ///< The text of each NOTE record.
+
+    // Current position in the file.
+    enum RecordType { OtherRecord, IndividualRecord, FamilyRecord, NoteRecord };
+    RecordType m_recordType;
+    QString m_level1Tag;
+    QString m_notePointer;
+
+    QVector<PersonRecord> m_persons;
+    QVector<RelationshipRecord> m_relationships;
+    QVector<MarriageRecord> m_marriages;
+};
+
+#endif // GEDCOMIMPORTER_H
@@ -0,0 +1,194 @@
+#include "generationindex.h"
+#include "diagramitem.h"
+
+#include <QPair>
+#include <QVector>
+
+// Special values of the cached numbers.
+static const int Unknown = -1;
+static const int Visiting = -2;
+
+// Flags for links ignored because they close a cycle.
+enum CycleFlag {
+    GenerationCycle = 1,
+    DepthCycle = 2
+};
+
+///
+/// \brief nextChild Get a child of a person or their spouse, counting the person's children first.
+///
+static DiagramItem *nextChild(DiagramItem *person, int index)
+{
+    const QVector<DiagramItem *> &children = person->getChildren();
+    if (index < children.size()) {
+        return children[index];
+    }
+
+    index -= children.size();
+    if (person->isMarried() && index < person->getSpouse()->getChildren().size()) {
+        return person->getSpouse()->getChildren()[index];
+    }
+
+    return nullptr;
+}
+
+int GenerationIndex::generation(DiagramItem *person)
+{
+    if (person->m_generation >= 0) {
+        return person->m_generation;
+    }
+
+    // Visit the parents before each person.
+    QVector<QPair<DiagramItem *, int> > stack;
+    stack << qMakePair(person, 0);
+    person->m_generation = Visiting;
+
+    while (!stack.isEmpty()) {
+        DiagramItem *current = stack.last().first;
+        int index = stack.last().second++;
+        const QVector<DiagramItem *> &parents = current->getParents();
+
+        if (index < parents.size()) {
+            DiagramItem *parent = parents[index];
+
+            if (parent->m_generation == Visiting) {
+                current->m_cycleFlags |= GenerationCycle;
+            }
+            else if (parent->m_generation == Unknown) {
+                parent->m_generation = Visiting;
+                stack << qMakePair(parent, 0);
+            }
+            continue;
+        }
+
+        // All parents are done, except any that close a cycle.
+        int value = 0;
+        for (DiagramItem *parent: parents) {
+            value = qMax(value, parent->m_generation + 1);
+        }
+        current->m_generation = value;
+        stack.removeLast();
+    }
+
+    return person->m_generation;
+}
+
+int GenerationIndex::depth(DiagramItem *person)
+{
+    if (person->m_depth >= 0) {
+        return person->m_depth;
+    }
+
+    // Visit the children before each person.
+    QVector<QPair<DiagramItem *, int> > stack;
+    stack << qMakePair(person, 0);
+    person->m_depth = Visiting;
+
+    while (!stack.isEmpty()) {
+        DiagramItem *current = stack.last().first;
+        int index = stack.last().second++;
+        DiagramItem *child = nextChild(current, index);
+
+        if (child) {
+            if (child->m_depth == Visiting) {
+                current->m_cycleFlags |= DepthCycle;
+            }
+            else if (child->m_depth == Unknown) {
+                child->m_depth = Visiting;
+                stack << qMakePair(child, 0);
+            }
+            continue;
+        }
+
+        // All children are done, except any that close a cycle.
+        int value = 0;
+        for (int i = 0; (child = nextChild(current, i)); ++i) {
+            value = qMax(value, child->m_depth + 1);
+        }
+        current->m_depth = value;
+        stack.removeLast();
+    }
+
+    return person->m_depth;
+}
+
+bool GenerationIndex::closesCycle(DiagramItem *person)
+{
+    return person->m_cycleFlags != 0;
+}
+
+void GenerationIndex::linkChanged(DiagramItem *parent, DiagramItem *child)
+{
+    // The child and their descendants may change generation.
+    clearGenerations(child);
+
+    // The parents and their ancestors may change depth.
+    clearDepths(parent);
+    if (parent->isMarried()) {
+        clearDepths(parent->getSpouse());
+    }
+}
+
+void GenerationIndex::marriageChanged(DiagramItem *person)
+{
+    clearDepths(person);
+}
+
+void GenerationIndex::clearGenerations(DiagramItem *person)
+{
+    // A person's generation is only known if their ancestors' are, so the
+    // walk can stop at persons that are already cleared.
+    if (person->m_generation == Unknown) {
+        return;
+    }
+
+    QVector<DiagramItem *> queue;
+    queue << person;
+    person->m_generation = Unknown;
+    person->m_cycleFlags &= ~GenerationCycle;
+
+    for (int i = 0; i < queue.size(); ++i) {
+        for (DiagramItem *child: queue[i]->getChildren()) {
+            if (child->m_generation != Unknown) {
+                child->m_generation = Unknown;
+                child->m_cycleFlags &= ~GenerationCycle;
+                queue << child;
+            }
+        }
+    }
+}
+
+void GenerationIndex::clearDepths(DiagramItem *person)
+{
+    // A person's depth is only known if their descendants' are, so the walk
+    // can stop at persons that are already cleared.
+    if (person->m_depth == Unknown) {
+        return;
+    }
+
+    QVector<DiagramItem *> queue;
+    queue << person;
+    person->m_depth = Unknown;
+    person->m_cycleFlags &= ~DepthCycle;
+
+    for (int i = 0; i < queue.size(); ++i) {
+        for (DiagramItem *parent: queue[i]->getParents()) {
+            // The parent's spouse counts the parent's children too.
+            for (int side = 0; side < 2; ++side) {
+                DiagramItem *affected = parent;
+                if (side == 1) {
+                    if (!parent->isMarried()) {
+                        break;
+                    }
+                    affected = parent->getSpouse();
+                }
+
+                if (affected->m_depth != Unknown) {
+                    affected->m_depth = Unknown;
+                    affected->m_cycleFlags &= ~DepthCycle;
+                    queue << affected;
+                }
+            }
+        }
+    }
+}
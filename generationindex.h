@@ -0,0 +1,61 @@
+#ifndef GENERATIONINDEX_H
+#define GENERATIONINDEX_H
+
+class DiagramItem;
+
+/**
+ * @brief The GenerationIndex class works out which generation each person is in.
+ *
+ * The numbers are cached on each person. Adding or removing a link or a
+ * marriage only clears the numbers of the persons it affects, so asking again
+ * only visits those persons. The numbers are found with an iterative
+ * depth-first search, so deep trees cannot overflow the stack. A link that
+ * closes a parent/child cycle, e.g. from a bad GEDCOM file, is ignored and
+ * reported by closesCycle().
+ */
+class GenerationIndex
+{
+public:
+    /**
+     * @brief generation Get the number of generations of ancestors above a person.
+     * @param person The person.
+     * @return 0 if the person has no parents, otherwise one more than their oldest parent.
+     */
+    static int generation(DiagramItem *person);
+
+    /**
+     * @brief depth Get the number of generations of descendants below a person.
+     * The children of the spouse count too, so both spouses have the same depth.
+     * @param person The person.
+     * @return 0 if the person has no children.
+     */
+    static int depth(DiagramItem *person);
+
+    /**
+     * @brief closesCycle Check whether a link of the person was ignored
+     * because it closes a parent/child cycle. Only set for persons whose
+     * generation or depth has been asked for.
+     * @param person The person.
+     * @return True if a link was ignored.
+     */
+    static bool closesCycle(DiagramItem *person);
+
+    /**
+     * @brief linkChanged Clear the numbers affected by adding or removing a parent/child link.
+     * @param parent The parent.
+     * @param child The child.
+     */
+    static void linkChanged(DiagramItem *parent, DiagramItem *child);
+
+    /**
+     * @brief marriageChanged Clear the numbers affected by a person marrying or divorcing.
+     * @param person The person.
+     */
+    static void marriageChanged(DiagramItem *person);
+
+private:
+    static void clearGenerations(DiagramItem *person);
+    static void clearDepths(DiagramItem *person);
+};
+
+#endif // GENERATIONINDEX_H
@@ -2,6 +2,7 @@
 #include "ui_dialogfileproperties.h"
 
 #include <diagramscene.h>
+#include <rendercache.h>
 #include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
@@ -29,6 +30,32 @@ void DialogFileProperties::setDiagram(DiagramScene *&scene)
 
     QString marriageCount = QString::number(scene->marriageCount());
     ui->labelNumberOfMarriagesValue->setText(marriageCount);
+
+    const SceneStatistics &statistics = scene->statistics();
+    ui->labelPeopleWithPhotosValue->setText(QString::number(statistics.personsWithPhotosCount()));
+    ui->labelGenerationsValue->setText(QString::number(statistics.generationCount()));
+
+    // Show a dash if no dates are known.
+    QDate earliest = statistics.earliestDate();
+    QDate latest = statistics.latestDate();
+    ui->labelEarliestDateValue->setText(earliest.isValid() ? earliest.toString(Qt::ISODate) : "-");
+    ui->labelLatestDateValue->setText(latest.isValid() ? latest.toString(Qt::ISODate) : "-");
+
+    // Show how well the pictures of persons are reused.
+    QString renderCache = "-";
+    if (!RenderCache::isEnabled()) {
+        renderCache = tr("Off");
+    }
+    else if (RenderCache::hitCount() + RenderCache::missCount() > 0) {
+        renderCache = tr("%1% reused, %2 pictures in %3 MB")
+                .arg(qRound(RenderCache::hitRate() * 100))
+                .arg(RenderCache::pictureCount())
+                .arg(RenderCache::memoryUsed() / 1024.0, 0, 'f', 1);
+        if (RenderCache::isBypassed()) {
+            renderCache += tr(" (paused, too little memory)");
+        }
+    }
+    ui->labelRenderCacheValue->setText(renderCache);
 }
 
 void DialogFileProperties::setFile(const QString &filePath)
@@ -1,6 +1,7 @@
 #include "dialogfind.h"
 #include "ui_dialogfind.h"
 
+#include <QLabel>
 #include <QSettings>
 #include <QTimer>
 
@@ -13,6 +14,9 @@ DialogFind::DialogFind(QWidget *parent) :
     // Store hint.
     m_hint = ui->labelStatus->text();
 
+    // The list of matches is only shown for ranked searches.
+    ui->listWidgetMatches->hide();
+
     // Load preferences.
     updateGuiFromPreferences();
 
@@ -33,6 +37,7 @@ void DialogFind::beforeShow()
 
     // Set focus.
     ui->lineEditText->clear();
+    ui->listWidgetMatches->clear();
     ui->lineEditText->setFocus();
 }
 
@@ -41,6 +46,42 @@ void DialogFind::setStatus(const QString &text)
     ui->labelStatus->setText(text);
 }
 
+void DialogFind::setMatchCount(int count)
+{
+    if (count == 0) {
+        setStatus(tr("No matches."));
+    }
+    else if (count == 1) {
+        setStatus(tr("1 match."));
+    }
+    else {
+        setStatus(tr("%1 matches.").arg(count));
+    }
+}
+
+/**
+ * @brief DialogFind::setMatchList Show the matches of a ranked search.
+ * @param lines A line of rich text for each match.
+ */
+void DialogFind::setMatchList(const QStringList &lines)
+{
+    ui->listWidgetMatches->clear();
+
+    for (const QString &line: lines) {
+        auto item = new QListWidgetItem(ui->listWidgetMatches);
+        auto label = new QLabel(line);
+        label->setTextFormat(Qt::RichText);
+        label->setAttribute(Qt::WA_TransparentForMouseEvents);
+        item->setSizeHint(label->sizeHint());
+        ui->listWidgetMatches->setItemWidget(item, label);
+    }
+}
+
+DialogFind::Mode DialogFind::mode() const
+{
+    return Mode(ui->comboBoxMode->currentIndex());
+}
+
 void DialogFind::updateGuiFromPreferences()
 {
     // Load transparency setting.
@@ -81,6 +122,15 @@ void DialogFind::on_pushButtonFind_clicked()
     }
 }
 
+void DialogFind::on_pushButtonPrevious_clicked()
+{
+    auto text = ui->lineEditText->text();
+    if (!text.isEmpty())
+    {
+        emit searchPrevious(text);
+    }
+}
+
 void DialogFind::setFullOpacity()
 {
     setWindowOpacity(1.0);
@@ -88,11 +138,26 @@ void DialogFind::setFullOpacity()
 
 void DialogFind::on_lineEditText_textChanged(const QString &newText)
 {
-    Q_UNUSED(newText);
+    // Show the number of matches as the user types.
+    if (newText.isEmpty()) {
+        setStatus(m_hint);
+        ui->listWidgetMatches->clear();
+    }
+    else {
+        emit searchTextChanged(newText);
+    }
+}
+
+void DialogFind::on_comboBoxMode_currentIndexChanged(int index)
+{
+    ui->listWidgetMatches->setVisible(index != Names);
+    ui->listWidgetMatches->clear();
 
-    QString labelText = ui->labelStatus->text();
+    // Search again in the new mode.
+    on_lineEditText_textChanged(ui->lineEditText->text());
+}
 
-    if (labelText == "Person found." || labelText == "Person not found.") {
-        ui->labelStatus->clear();
-    }
+void DialogFind::on_listWidgetMatches_itemClicked(QListWidgetItem *item)
+{
+    emit matchChosen(ui->listWidgetMatches->row(item));
 }
@@ -3,6 +3,7 @@
 
 #include <QDialog>
 
+class QListWidgetItem;
 class QTimer;
 
 namespace Ui {
@@ -14,15 +15,29 @@ class DialogFind : public QDialog
     Q_OBJECT
 
 public:
+    /// What to search.
+    enum Mode
+    {
+        Names,
+        SimilarNames,
+        Details
+    };
+
     explicit DialogFind(QWidget *parent = 0);
     ~DialogFind();
 
     void beforeShow();
     void setStatus(const QString &text);
+    void setMatchCount(int count);
+    void setMatchList(const QStringList &names);
+    Mode mode() const;
     void updateGuiFromPreferences();
 
 signals:
     void search(const QString &text);
+    void searchPrevious(const QString &text);
+    void searchTextChanged(const QString &text);
+    void matchChosen(int index);
 
 public slots:
     void onFound();
@@ -30,9 +45,12 @@ public slots:
 private slots:
     void on_pushButtonClose_clicked();
     void on_pushButtonFind_clicked();
+    void on_pushButtonPrevious_clicked();
     void setFullOpacity();
 
     void on_lineEditText_textChanged(const QString &newText);
+    void on_comboBoxMode_currentIndexChanged(int index);
+    void on_listWidgetMatches_itemClicked(QListWidgetItem *item);
 
 private:
     Ui::DialogFind *ui;
@@ -2,6 +2,7 @@
 #include "ui_dialogpersondetails.h"
 
 #include "diagramitem.h"
+#include "diagramscene.h"
 //#include "dialogviewphoto.h"
 #include "viewphotowindow.h"
 #include "fileutils.h"
@@ -161,6 +162,12 @@ void DialogPersonDetails::save()
         QStringList photos = getPhotoListFromGui();
         m_item->setPhotos(photos);
 
+        // Make the new details searchable.
+        auto scene = dynamic_cast<DiagramScene *>(m_item->scene());
+        if (scene) {
+            scene->textIndex().update(m_item);
+        }
+
         undo->setAfterState(m_item);
         UndoManager::add(undo);
     }
@@ -19,10 +19,15 @@
 #include "ui_mainform.h"
 
 #include "arrow.h"
+#include "diagrambinary.h"
 #include "diagramitem.h"
+#include "diagramreader.h"
+#include "diagramwriter.h"
 #include "diagramscene.h"
 #include "diagramtextitem.h"
 #include "fileutils.h"
+#include "gedcomexporter.h"
+#include "gedcomimporter.h"
 #include "mygraphicsview.h"
 #include "percentvalidator.h"
 #include "undo/addarrowundo.h"
@@ -45,15 +50,27 @@
 #include "gui/timelinereportwindow.h"
 #include "gui/dialogfileproperties.h"
 #include "undo/changediagramsizeundo.h"
+#include "undo/editpersondetailsundo.h"
 
 #include <QtWidgets>
 #include <QPrinter>
 #include <QPrintDialog>
 #include <QUndoStack>
 #include <QSlider>
+#include <QtConcurrent/QtConcurrentRun>
 
 const int InsertArrowButton = 11;
 
+// Time to spend adding persons before the window is updated while opening a file.
+const int openBatchMilliseconds = 50;
+
+// Largest diagram to animate when laying out, and how long to take.
+const int maxAnimatedLayoutPersons = 2000;
+const int layoutAnimationMilliseconds = 300;
+
+// Most ranked matches to list in the "Find" dialog.
+const int maxRankedMatches = 100;
+
 #include <QDesktopWidget>
 
 MainForm::MainForm(QWidget *parent) :
@@ -63,10 +80,26 @@ MainForm::MainForm(QWidget *parent) :
     m_gedcomWasImported(false),
     treeFocusedItem(nullptr),
     m_openingRecentFile(false),
-    m_disableZoomSliderSignal(false)
+    m_disableZoomSliderSignal(false),
+    m_changedDuringSave(false),
+    m_savePending(false),
+    m_layoutUndo(nullptr),
+    m_layoutNext(0),
+    m_layoutUndoable(false),
+    m_layoutPending(false)
 {
     ui->setupUi(this);
 
+    m_saveWatcher = new QFutureWatcher<bool>(this);
+    connect(m_saveWatcher, SIGNAL(finished()), this, SLOT(onSaveFinished()));
+
+    m_layoutWatcher = new QFutureWatcher<LayoutResult>(this);
+    connect(m_layoutWatcher, SIGNAL(finished()), this, SLOT(onLayoutFinished()));
+
+    m_layoutAnimation = new QTimeLine(layoutAnimationMilliseconds, this);
+    connect(m_layoutAnimation, SIGNAL(valueChanged(qreal)), this, SLOT(onLayoutAnimationStep(qreal)));
+    connect(m_layoutAnimation, &QTimeLine::finished, this, &MainForm::finishLayout);
+
     undoStack = new QUndoStack(this);
     connect(undoStack, SIGNAL(cleanChanged(bool)), this, SLOT(onUndoStackCleanChanged(bool)));
     UndoManager::setStack(undoStack);
@@ -109,11 +142,13 @@ MainForm::MainForm(QWidget *parent) :
     // Add diagram.
     view = new MyGraphicsView(scene);
     connect(scene, SIGNAL(mouseReleased()), view, SLOT(onMouseReleased()));
+    connect(scene, SIGNAL(mousePressed()), this, SLOT(completeLayout()));
     connect(scene, SIGNAL(arrowAdded(Arrow*)), this, SLOT(onArrowAdded(Arrow*)));
     connect(scene, SIGNAL(itemsAboutToMove()), this, SLOT(onItemsAboutToMove()));
     connect(scene, SIGNAL(itemsFinishedMoving()), this, SLOT(onItemsFinishedMoving()));
     connect(scene, SIGNAL(cleared()), this, SLOT(onSceneCleared()));
     connect(scene, SIGNAL(personDoubleClicked(DiagramItem*)), this, SLOT(onPersonDoubleClicked(DiagramItem*)));
+    connect(scene, SIGNAL(personNameChanged(DiagramItem*)), this, SLOT(onPersonNameChanged(DiagramItem*)));
     connect(view, SIGNAL(mouseWheelZoomed()), this, SLOT(onMouseWheelZoomed()));
     layout->addWidget(view);
 
@@ -129,6 +164,7 @@ MainForm::MainForm(QWidget *parent) :
     scaleTextEditedByUser = false;
     moveItemsUndo = nullptr;
     dialogFind = nullptr;
+    m_searchMode = DialogFind::Names;
     dialogPersonDetails = nullptr;
     dialogMarriageDetails = nullptr;
 //    dialogHelp = nullptr;
@@ -165,6 +201,9 @@ MainForm::MainForm(QWidget *parent) :
 MainForm::~MainForm()
 {
     m_beingDestroyed = true;
+    m_saveWatcher->waitForFinished();
+    cancelLayout();
+    m_layoutWatcher->waitForFinished();
     delete ui;
 }
 
@@ -214,6 +253,7 @@ void MainForm::buttonGroupClicked(int id)
 void MainForm::deleteItem()
 {
     QSet<QGraphicsItem *> itemsRemoved;
+    QList<DiagramItem *> relatives;
 
     //
     // Delete relationships.
@@ -222,6 +262,7 @@ void MainForm::deleteItem()
         if (item->type() == Arrow::Type) {
             scene->removeItem(item);
             Arrow *arrow = qgraphicsitem_cast<Arrow *>(item);
+            relatives << arrow->startItem() << arrow->endItem();
             arrow->startItem()->removeArrow(arrow);
             arrow->endItem()->removeArrow(arrow);
             itemsRemoved << arrow;
@@ -239,6 +280,12 @@ void MainForm::deleteItem()
                 itemsRemoved << arrow;
             }
 
+            // Remember the relatives, to lay out their family afterwards.
+            relatives << diagramItem->getParents().toList() << diagramItem->getChildren().toList();
+            if (diagramItem->isMarried()) {
+                relatives << diagramItem->getSpouse();
+            }
+
             diagramItem->removeArrows();
             delete treeItems[diagramItem->id()];
         }
@@ -247,6 +294,11 @@ void MainForm::deleteItem()
     }
 
     undoStack->push(new DeleteItemsUndo(scene, itemsRemoved.toList()));
+
+    // Lay out the family of the remaining relatives if required.
+    if (useAutoLayoutFamily() && !relatives.isEmpty()) {
+        autoLayoutFamily(relatives);
+    }
 }
 
 void MainForm::pointerGroupClicked(int)
@@ -314,7 +366,6 @@ void MainForm::itemInserted(DiagramItem *item, bool fromLoad)
     tree->addTopLevelItem(treeItem);
     treeItem->setData(0, Qt::UserRole, id);
     treeItems[id] = treeItem;
-    connect(item->textItem(), &DiagramTextItem::textEdited, this, &MainForm::onItemTextEdited);
 
     if (!fromLoad)
     {
@@ -482,7 +533,8 @@ void MainForm::newDiagram()
     undoStack->setClean();
 
     // Clear scene.
-    scene->clear();
+    scene->beginLoad(5000, 5000);
+    scene->buildTextIndex();
     tree->clear();
     treeItems.clear();
 
@@ -516,7 +568,9 @@ void MainForm::open()
     QString fileName =
             QFileDialog::getOpenFileName(this, tr("Open Genealogy File"),
                                          folderPath,
-                                         tr("Genealogy XML Files (*.xml)"));
+                                         tr("Genealogy Files (*.xml *.gmb);;"
+                                            "Genealogy XML Files (*.xml);;"
+                                            "Genealogy Binary Files (*.gmb)"));
 
     if (fileName.isEmpty())
         return;
@@ -535,13 +589,13 @@ void MainForm::save()
     if (!saveFileExists()) {
         QString title = tr("Save Genealogy File");
         QString dir = saveFileDir();
-        QString filter = tr("Genealogy XML Files (*.xml)");
+        QString filter = saveFileFilter();
         QString fileName = QFileDialog::getSaveFileName(this, title, dir, filter);
 
         if (fileName.isEmpty())
             return;
 
-        if (!fileName.endsWith(".xml")) {
+        if (!fileName.endsWith(".xml") && !DiagramBinary::isBinaryFileName(fileName)) {
             fileName += ".xml";
         }
 
@@ -549,28 +603,8 @@ void MainForm::save()
         m_saveFileName = fileName;
     }
 
-    // Open file.
-     QFile file(m_saveFileName);
-     if (!file.open(QFile::WriteOnly | QFile::Text)) {
-         QString message = tr("Cannot write file %1:\n%2.").arg(m_saveFileName).arg(file.errorString());
-         QMessageBox::warning(this, tr("Genealogy Maker"), message);
-         return;
-     }
-
-     // Save to file.
-     scene->save(&file, FileUtils::getPhotosFolderFor(m_saveFileName));
-
-     // Reset flag.
-     m_gedcomWasImported = false;
-
-     // Update window title.
-     updateWindowTitle();
-
-     // Mark undo stack.
-     undoStack->setClean();
-
-     // Update "Recent Files" menu.
-     prependToRecentFiles(m_saveFileName);
+    // Save to file in the background.
+    startSave(m_saveFileName);
 }
 
 void MainForm::saveAs()
@@ -581,41 +615,122 @@ void MainForm::saveAs()
     if (saveFileExists()) {
         dir = m_saveFileName;
     }
-    QString filter = tr("Genealogy XML Files (*.xml)");
+    QString filter = saveFileFilter();
     QString fileName = QFileDialog::getSaveFileName(this, title, dir, filter);
 
     if (fileName.isEmpty())
         return;
 
-    if (!fileName.endsWith(".xml")) {
+    if (!fileName.endsWith(".xml") && !DiagramBinary::isBinaryFileName(fileName)) {
         fileName += ".xml";
     }
 
-    // Open file.
-     QFile file(fileName);
-     if (!file.open(QFile::WriteOnly | QFile::Text)) {
-         QString message = tr("Cannot write file %1:\n%2.").arg(fileName).arg(file.errorString());
-         QMessageBox::warning(this, tr("Genealogy Maker"), message);
-         return;
-     }
+    // Store save file.
+    m_saveFileName = fileName;
+
+    // Save to file in the background.
+    startSave(m_saveFileName);
+}
+
+QString MainForm::saveFileFilter() const
+{
+    return tr("Genealogy XML Files (*.xml);;Genealogy Binary Files (*.gmb)");
+}
+
+/**
+ * @brief collectUndoPhotos Find the photos that an undo command can bring back.
+ * @param command The command.
+ * @param photos The list to add the photos to.
+ */
+static void collectUndoPhotos(const QUndoCommand *command, QStringList &photos)
+{
+    if (auto edit = dynamic_cast<const EditPersonDetailsUndo *>(command)) {
+        photos << edit->photos();
+    }
+    else if (auto deletion = dynamic_cast<const DeleteItemsUndo *>(command)) {
+        photos << deletion->photos();
+    }
+    else if (auto addition = dynamic_cast<const AddItemUndo *>(command)) {
+        photos << addition->photos();
+    }
+
+    for (int i = 0; i < command->childCount(); ++i) {
+        collectUndoPhotos(command->child(i), photos);
+    }
+}
+
+void MainForm::startSave(const QString &fileName)
+{
+    // Only one save at a time, and not half way through a layout.
+    waitForSave();
+    waitForLayout();
 
-     // Store save file.
-     m_saveFileName = fileName;
+    // Take a copy of the diagram to save.
+    m_savingFileName = fileName;
 
-     // Save to file.
-     scene->save(&file, getPhotosFolderFor(m_saveFileName));
+    // Note any undo or redo, or new edit, until the save is done. Comparing
+    // the undo index is not enough, since undo then a new edit gives the same index.
+    m_changedDuringSave = false;
+    m_saveChangeConnection = connect(undoStack, &QUndoStack::indexChanged, this, [this]() {
+        m_changedDuringSave = true;
+    });
 
-     // Set flag.
-     m_gedcomWasImported = false;
+    m_saveSnapshot = scene->snapshot(getPhotosFolderFor(fileName), useSharedPhotoStore());
 
-     // Update window title.
-     updateWindowTitle();
+    // Keep shared photos that undo can bring back.
+    for (int i = 0; i < undoStack->count(); ++i) {
+        collectUndoPhotos(undoStack->command(i), m_saveSnapshot.retainedPhotos);
+    }
+    m_saveErrorString.clear();
+    m_savePending = true;
 
-     // Mark undo stack.
-     undoStack->setClean();
+    ui->statusbar->showMessage(tr("Saving %1...").arg(QFileInfo(fileName).fileName()));
 
-     // Update "Recent Files" menu.
-     prependToRecentFiles(fileName);
+    // Write it on a worker thread.
+    m_saveWatcher->setFuture(QtConcurrent::run([this, fileName]() {
+        return DiagramWriter::save(m_saveSnapshot, fileName, &m_saveErrorString);
+    }));
+}
+
+void MainForm::onSaveFinished()
+{
+    m_savePending = false;
+    disconnect(m_saveChangeConnection);
+    ui->statusbar->clearMessage();
+
+    if (!m_saveWatcher->result()) {
+        QMessageBox::warning(this, tr("Genealogy Maker"), m_saveErrorString);
+        return;
+    }
+
+    // Use the copied photos.
+    scene->applyPhotos(m_saveSnapshot);
+    m_saveSnapshot = DiagramSnapshot();
+
+    // Reset flag.
+    m_gedcomWasImported = false;
+
+    // Mark undo stack, unless the diagram was changed during the save.
+    if (!m_changedDuringSave) {
+        undoStack->setClean();
+    }
+
+    // Update window title.
+    updateWindowTitle();
+
+    // Update "Recent Files" menu.
+    prependToRecentFiles(m_savingFileName);
+}
+
+void MainForm::waitForSave()
+{
+    if (!m_savePending) {
+        return;
+    }
+
+    QEventLoop loop;
+    connect(m_saveWatcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
 }
 
 void MainForm::onTreeItemDoubleClicked(QTreeWidgetItem *item, int column)
@@ -738,6 +853,11 @@ void MainForm::onArrowAdded(Arrow *arrow)
 {
     undoStack->push(new AddArrowUndo(scene, arrow));
 
+    // Lay out the family if required.
+    if (useAutoLayoutFamily()) {
+        autoLayoutFamily(QList<DiagramItem *>() << arrow->endItem());
+    }
+
     // Back to "pointer mode".
     pointerTypeGroup->button(int(DiagramScene::MoveItem))->setChecked(true);
     scene->setMode(DiagramScene::Mode(pointerTypeGroup->checkedId()));
@@ -770,6 +890,9 @@ void MainForm::onFind()
     if (!dialogFind) {
         dialogFind = new DialogFind(this);
         connect(dialogFind, SIGNAL(search(QString)), this, SLOT(onSearch(QString)));
+        connect(dialogFind, SIGNAL(searchPrevious(QString)), this, SLOT(onSearchPrevious(QString)));
+        connect(dialogFind, SIGNAL(searchTextChanged(QString)), this, SLOT(onSearchTextChanged(QString)));
+        connect(dialogFind, SIGNAL(matchChosen(int)), this, SLOT(onSearchMatchChosen(int)));
     }
 
     dialogFind->beforeShow();
@@ -778,66 +901,147 @@ void MainForm::onFind()
 
 void MainForm::onSearch(const QString &text)
 {
-    // Get items and count.
-    auto items = scene->items();
-    auto count = items.size();
+    updateSearchMatches(text);
 
-    // Search.
-    for (int i = m_searchFoundIndex + 1; i < count; ++i) {
-        if (searchCheckPerson(items, i, text)) return;
+    // Go to the next match, wrapping around.
+    if (!m_searchMatches.isEmpty()) {
+        goToSearchMatch((m_searchFoundIndex + 1) % m_searchMatches.size());
     }
+}
+
+void MainForm::onSearchPrevious(const QString &text)
+{
+    updateSearchMatches(text);
 
-    // Wrap search.
-    for (int i = 0; (i <= m_searchFoundIndex) && (i < count); ++i) {
-        if (searchCheckPerson(items, i, text)) return;
+    // Go to the previous match, wrapping around.
+    if (!m_searchMatches.isEmpty()) {
+        int count = m_searchMatches.size();
+        int index = (m_searchFoundIndex <= 0) ? count - 1 : m_searchFoundIndex - 1;
+        goToSearchMatch(qMin(index, count - 1));
     }
+}
+
+void MainForm::onSearchTextChanged(const QString &text)
+{
+    updateSearchMatches(text);
 
-    // Show message if not found.
     if (dialogFind) {
-        dialogFind->setStatus("Person not found.");
+        dialogFind->setMatchCount(m_searchMatches.size());
+
+        // List the ranked matches, best first.
+        if (m_searchMode != DialogFind::Names) {
+            dialogFind->setMatchList(m_searchLines);
+        }
+    }
+}
+
+void MainForm::onSearchMatchChosen(int index)
+{
+    if (index >= 0 && index < m_searchMatches.size() && m_searchMatches[index]->scene() == scene) {
+        goToSearchMatch(index);
     }
 }
 
+///
+/// \brief highlightedSnippet Show a text search hit as rich text, with the matching words in bold.
+///
+static QString highlightedSnippet(const TextIndex::Hit &hit)
+{
+    QString field;
+    switch (hit.field) {
+    case TextIndex::PlaceOfBirth:
+        field = MainForm::tr("Place of birth");
+        break;
+    case TextIndex::CountryOfBirth:
+        field = MainForm::tr("Country of birth");
+        break;
+    case TextIndex::PlaceOfDeath:
+        field = MainForm::tr("Place of death");
+        break;
+    default:
+        field = MainForm::tr("Bio");
+        break;
+    }
+
+    QString snippet;
+    int position = 0;
+    for (const auto &highlight: hit.highlights) {
+        snippet += hit.snippet.mid(position, highlight.first - position).toHtmlEscaped();
+        snippet += "<b>" + hit.snippet.mid(highlight.first, highlight.second).toHtmlEscaped() + "</b>";
+        position = highlight.first + highlight.second;
+    }
+    snippet += hit.snippet.mid(position).toHtmlEscaped();
+
+    return QString("<b>%1</b> <i>(%2)</i><br>%3").arg(hit.person->name().toHtmlEscaped(), field, snippet);
+}
+
 /**
- * @brief MainForm::searchCheckPerson Check if the item matches the search text. If so,
- * go to the item and update the "Find" dialog.
- * @param items The list of items.
- * @param index The index of the item to check.
+ * @brief MainForm::updateSearchMatches Find the persons whose name contains the text,
+ * or the ranked matches of the mode chosen in the "Find" dialog.
+ * The matches are found again if the text changed or a person was removed since.
  * @param text The search text.
- * @return True if the item matches the text.
  */
-bool MainForm::searchCheckPerson(QList<QGraphicsItem *> &items, int index, const QString &text)
+void MainForm::updateSearchMatches(const QString &text)
 {
-    // Get item.
-    auto item = items[index];
+    int mode = dialogFind ? dialogFind->mode() : DialogFind::Names;
+    bool current = (text == m_searchText && mode == m_searchMode);
 
-    // Check if person.
-    if (item->type() == DiagramItem::Type) {
-        auto diagramItem = qgraphicsitem_cast<DiagramItem *> (item);
+    for (int i = 0; current && i < m_searchMatches.size(); ++i) {
+        current = (m_searchMatches[i]->scene() == scene);
+    }
 
-        // Check if name matches.
-        if (diagramItem->name().contains(text, Qt::CaseInsensitive)) {
+    if (!current) {
+        m_searchText = text;
+        m_searchMode = mode;
+        m_searchMatches.clear();
+        m_searchLines.clear();
 
-            // Go to person in diagram.
-            view->centerOn(diagramItem);
+        if (mode == DialogFind::SimilarNames) {
+            for (const PhoneticIndex::Match &match: scene->phoneticIndex().find(text, maxRankedMatches)) {
+                m_searchMatches << match.person;
+                m_searchLines << match.person->name().toHtmlEscaped();
+            }
+        }
+        else if (mode == DialogFind::Details) {
+            for (const TextIndex::Hit &hit: scene->textIndex().find(text, maxRankedMatches)) {
+                m_searchMatches << hit.person;
+                m_searchLines << highlightedSnippet(hit);
+            }
+        }
+        else {
+            m_searchMatches = scene->nameIndex().find(text);
+        }
+        m_searchFoundIndex = -1;
+    }
 
-            // Highlight the person.
-            scene->highlightForSearch(diagramItem);
+    // Show message if not found.
+    if (m_searchMatches.isEmpty() && dialogFind) {
+        dialogFind->setStatus("Person not found.");
+    }
+}
 
-            // Update dialog.
-            dialogFind->setStatus("Person found.");
-            dialogFind->onFound();
+/**
+ * @brief MainForm::goToSearchMatch Go to a person found by the search and update the "Find" dialog.
+ * @param index The index of the match.
+ */
+void MainForm::goToSearchMatch(int index)
+{
+    DiagramItem *person = m_searchMatches[index];
 
-            // Save index for next search.
-            m_searchFoundIndex = index;
+    // Go to person in diagram.
+    view->centerOn(person);
 
-            // Return.
-            return true;
-        }
+    // Highlight the person.
+    scene->highlightForSearch(person);
+
+    // Update dialog.
+    if (dialogFind) {
+        dialogFind->setStatus(tr("Person %1 of %2 found.").arg(index + 1).arg(m_searchMatches.size()));
+        dialogFind->onFound();
     }
 
-    // Return.
-    return false;
+    // Save index for next search.
+    m_searchFoundIndex = index;
 }
 
 /// Export the diagram as an image.
@@ -944,19 +1148,198 @@ void MainForm::showFileProperties()
     dialogFileProperties->show();
 }
 
-void MainForm::autoLayoutDiagram()
+///
+/// \brief MainForm::autoLayoutFamily Lay out the family of persons whose links changed.
+/// Only the family moves, and the move can be undone.
+/// \param persons The persons whose links or marriages changed.
+///
+void MainForm::autoLayoutFamily(const QList<DiagramItem *> &persons)
 {
+    QList<DiagramItem *> family = scene->layoutFamily(persons);
+    if (family.isEmpty()) {
+        return;
+    }
+
+    QList<QGraphicsItem *> items;
+    for (DiagramItem *person: family) {
+        items << person;
+    }
+
     // Create undo object.
-    MoveItemsUndo *undo = new MoveItemsUndo(scene, scene->items());
+    MoveItemsUndo *undo = new MoveItemsUndo(scene, items);
 
-    // Layout the scene.
-    scene->autoLayout();
+    // Layout the family.
+    scene->autoLayoutFamily(family);
 
     // Store undo item.
     undo->storeAfterState();
-    undo->setText("auto layout");
-    undo->setMoveView(true);
+    undo->setText("lay out family");
     undoStack->push(undo);
+}
+
+///
+/// \brief MainForm::autoLayoutDiagram Lay out the whole diagram.
+/// The layout is worked out on a worker thread, then applied a batch at a
+/// time so the window stays responsive. A new layout replaces one that is
+/// still being worked out.
+/// \param undoable True to add the layout to the undo stack.
+///
+void MainForm::autoLayoutDiagram(bool undoable)
+{
+    // Replace any layout in progress.
+    completeLayout();
+    if (m_layoutCancelled) {
+        m_layoutCancelled->store(1);
+    }
+
+    // Take the sizes and links.
+    LayoutGraph graph = scene->layoutSnapshot(m_layoutUnits);
+    QSharedPointer<QAtomicInt> cancelled(new QAtomicInt(0));
+    m_layoutCancelled = cancelled;
+    m_layoutUndoable = undoable;
+    m_layoutPending = true;
+
+    ui->statusbar->showMessage(tr("Laying out diagram..."));
+
+    // Work out the positions on a worker thread.
+    m_layoutWatcher->setFuture(QtConcurrent::run([graph, cancelled]() {
+        return LayoutEngine::layout(graph, cancelled.data());
+    }));
+}
+
+void MainForm::onLayoutFinished()
+{
+    if (!takeLayoutResult()) {
+        return;
+    }
+
+    // Move the persons.
+    if (animateLayout() && m_layoutItems.size() <= maxAnimatedLayoutPersons) {
+        m_layoutAnimation->start();
+    }
+    else {
+        m_layoutNext = 0;
+        applyLayoutBatch();
+    }
+}
+
+///
+/// \brief MainForm::takeLayoutResult Take the worked out layout, find the
+/// persons to move and start the undo object.
+/// \return False if there is nothing to move.
+///
+bool MainForm::takeLayoutResult()
+{
+    LayoutResult result = m_layoutWatcher->result();
+
+    // Ignore a layout that was cancelled.
+    if (!m_layoutPending || result.positions.size() != m_layoutUnits.size()) {
+        return false;
+    }
+
+    m_layoutResult = result;
+
+    // Find the persons, skipping any deleted in the meantime.
+    m_layoutItems.clear();
+    m_layoutStart.clear();
+    for (const QUuid &id: m_layoutUnits) {
+        DiagramItem *person = scene->itemWithId(id);
+        m_layoutItems << person;
+        m_layoutStart << (person ? person->pos() : QPointF());
+    }
+
+    if (m_layoutItems.isEmpty()) {
+        finishLayout();
+        return false;
+    }
+
+    // Create undo object.
+    if (m_layoutUndoable) {
+        QList<QGraphicsItem *> persons;
+        persons.reserve(scene->persons().size());
+        for (DiagramItem *person: scene->persons()) {
+            persons << person;
+        }
+        m_layoutUndo = new MoveItemsUndo(scene, persons);
+    }
+
+    return true;
+}
+
+void MainForm::applyLayoutBatch()
+{
+    if (m_layoutItems.isEmpty()) {
+        return;
+    }
+
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+
+    while (m_layoutNext < m_layoutItems.size()) {
+        DiagramItem *person = m_layoutItems[m_layoutNext];
+        if (person && person->scene() == scene) {
+            person->setPos(m_layoutResult.positions[m_layoutNext]);
+        }
+        ++m_layoutNext;
+
+        // Let the window update before the next batch.
+        if (batchTimer.elapsed() >= openBatchMilliseconds) {
+            QTimer::singleShot(0, this, SLOT(applyLayoutBatch()));
+            return;
+        }
+    }
+
+    finishLayout();
+}
+
+void MainForm::onLayoutAnimationStep(qreal value)
+{
+    for (int i = 0; i < m_layoutItems.size(); ++i) {
+        if (m_layoutItems[i] && m_layoutItems[i]->scene() == scene) {
+            QPointF start = m_layoutStart[i];
+            m_layoutItems[i]->setPos(start + (m_layoutResult.positions[i] - start) * value);
+        }
+    }
+}
+
+void MainForm::finishLayout()
+{
+    if (!m_layoutPending) {
+        return;
+    }
+
+    // Make sure everyone has arrived, then make room for the tree. Skip
+    // persons that were taken out of the diagram in the meantime.
+    QVector<DiagramItem *> placed;
+    for (int i = 0; i < m_layoutItems.size(); ++i) {
+        if (m_layoutItems[i] && m_layoutItems[i]->scene() == scene) {
+            m_layoutItems[i]->setPos(m_layoutResult.positions[i]);
+            placed << m_layoutItems[i];
+        }
+    }
+    scene->growToFit(placed);
+
+    // Store undo item.
+    if (m_layoutUndo) {
+        m_layoutUndo->storeAfterState();
+        m_layoutUndo->setText("auto layout");
+        m_layoutUndo->setMoveView(true);
+        undoStack->push(m_layoutUndo);
+        m_layoutUndo = nullptr;
+    }
+
+    m_layoutItems.clear();
+    m_layoutStart.clear();
+    m_layoutPending = false;
+
+    // Warn about parent/child cycles.
+    if (m_layoutResult.cycleEdges > 0) {
+        ui->statusbar->showMessage(tr("%1 link(s) make a person their own ancestor. "
+                                      "Those links were ignored.").arg(m_layoutResult.cycleEdges));
+    }
+    else {
+        ui->statusbar->clearMessage();
+    }
 
     // Go to first item.
     if (!scene->isEmpty()) {
@@ -964,6 +1347,77 @@ void MainForm::autoLayoutDiagram()
     }
 }
 
+///
+/// \brief MainForm::cancelLayout Stop any layout in progress, leaving the persons where they are.
+///
+void MainForm::cancelLayout()
+{
+    if (m_layoutCancelled) {
+        m_layoutCancelled->store(1);
+    }
+
+    m_layoutAnimation->stop();
+    delete m_layoutUndo;
+    m_layoutUndo = nullptr;
+    m_layoutItems.clear();
+    m_layoutStart.clear();
+    m_layoutPending = false;
+}
+
+///
+/// \brief MainForm::completeLayout Put the persons of a layout that is being
+/// applied in their places at once, and add it to the undo stack.
+///
+void MainForm::completeLayout()
+{
+    if (m_layoutItems.isEmpty()) {
+        return;
+    }
+
+    m_layoutAnimation->stop();
+    finishLayout();
+}
+
+///
+/// \brief MainForm::waitForLayout Finish any layout in progress. This does
+/// not run the event loop, so no other action can start in the meantime.
+///
+void MainForm::waitForLayout()
+{
+    if (!m_layoutPending) {
+        return;
+    }
+
+    // Work out the rest on this thread, if it has not been applied yet.
+    if (m_layoutItems.isEmpty()) {
+        m_layoutWatcher->waitForFinished();
+        if (!takeLayoutResult()) {
+            cancelLayout();
+            return;
+        }
+    }
+
+    completeLayout();
+}
+
+void MainForm::onUndo()
+{
+    completeLayout();
+    undoStack->undo();
+}
+
+void MainForm::onRedo()
+{
+    completeLayout();
+    undoStack->redo();
+}
+
+bool MainForm::animateLayout() const
+{
+    QSettings settings;
+    return settings.value("diagram/animateLayout", true).toBool();
+}
+
 void MainForm::openExampleDiagram()
 {
     // Show examples folder.
@@ -985,6 +1439,18 @@ QString MainForm::exampleFileDir() const
     return QDir("examples").path();
 }
 
+bool MainForm::useSharedPhotoStore() const
+{
+    QSettings settings;
+    return settings.value("diagram/sharedPhotoStore", false).toBool();
+}
+
+bool MainForm::useAutoLayoutFamily() const
+{
+    QSettings settings;
+    return settings.value("diagram/autoLayoutFamily", false).toBool();
+}
+
 bool MainForm::shouldRemoveInvalidFiles() const
 {
     QSettings settings;
@@ -1031,6 +1497,11 @@ void MainForm::viewSelectedItemDetails()
 void MainForm::onPeopleMarried(DiagramItem *person1, DiagramItem *person2)
 {
     undoStack->push(new MarriageUndo(scene, person1, person2));
+
+    // Lay out the family if required.
+    if (useAutoLayoutFamily()) {
+        autoLayoutFamily(QList<DiagramItem *>() << person1 << person2);
+    }
 }
 
 void MainForm::removeMarriage()
@@ -1051,6 +1522,10 @@ void MainForm::viewMarriageDetails()
 
 void MainForm::onSceneCleared()
 {
+    cancelLayout();
+    m_searchMatches.clear();
+    m_searchLines.clear();
+    m_searchText.clear();
     treeItems.clear();
     tree->clear();
 }
@@ -1153,20 +1628,13 @@ void MainForm::moveToCenter()
     move(geometry.center() - offset);
 }
 
-void MainForm::onItemTextEdited(QGraphicsItem *item)
+void MainForm::onPersonNameChanged(DiagramItem *person)
 {
     if (m_beingDestroyed) return;
 
-    auto parent = item->parentItem();
-
-    if (parent) {
-        auto person = qgraphicsitem_cast<DiagramItem *>(parent);
-        if (person) {
-            auto treeItem = treeItems[person->id()];
-            if (treeItem) {
-                treeItem->setText(0, person->name());
-            }
-        }
+    auto treeItem = treeItems.value(person->id());
+    if (treeItem) {
+        treeItem->setText(0, person->name());
     }
 }
 
@@ -1316,6 +1784,12 @@ void MainForm::createActions()
     redoAction->setShortcut(QKeySequence::Redo);
     redoAction->setObjectName("redoAction");
 
+    // Let a layout that is moving persons finish before undo or redo.
+    disconnect(undoAction, nullptr, undoStack, nullptr);
+    disconnect(redoAction, nullptr, undoStack, nullptr);
+    connect(undoAction, SIGNAL(triggered()), this, SLOT(onUndo()));
+    connect(redoAction, SIGNAL(triggered()), this, SLOT(onRedo()));
+
 //    boldAction = new QAction(tr("Bold"), this);
 //    boldAction->setCheckable(true);
 //    QPixmap pixmap(":/images/bold.png");
@@ -1599,8 +2073,9 @@ void MainForm::open(const QString &fileName)
         return;
     }
 
+    // Binary diagrams must not be opened in text mode.
     QFile file(fileName);
-    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+    if (!file.open(QFile::ReadOnly)) {
         QMessageBox::warning(this, tr("Genealogy Maker"),
                              tr("Cannot read file %1:\n%2.")
                              .arg(fileName)
@@ -1611,16 +2086,79 @@ void MainForm::open(const QString &fileName)
         return;
     }
 
-    bool openedOK = scene->open(&file, getPhotosFolderFor(fileName));
+    // Create progress dialog.
+    QProgressDialog progress(tr("Reading file..."), tr("Cancel"), 0, 100, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.show();
 
-    // Exit if not opened OK.
-    if (!openedOK) {
-//        if (m_openingRecentFile) {
-//            removeFromRecentFiles(fileName);
-//        }
+    // Read the file on a worker thread.
+    DiagramReader reader;
+    QString photosFolderPath = getPhotosFolderFor(fileName);
+    QFutureWatcher<bool> watcher;
+    QEventLoop loop;
+    QTimer progressTimer;
+
+    connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    connect(&progress, &QProgressDialog::canceled, [&reader]() { reader.cancel(); });
+    connect(&progressTimer, &QTimer::timeout, [&progress, &reader]() {
+        progress.setValue(reader.percentRead() / 2);
+    });
+    progressTimer.start(100);
+
+    watcher.setFuture(QtConcurrent::run([&reader, &file, photosFolderPath]() {
+        return reader.read(&file, photosFolderPath);
+    }));
+    loop.exec();
+    progressTimer.stop();
+
+    // Exit if not read OK.
+    if (!watcher.result()) {
+        if (!reader.wasCancelled()) {
+            QMessageBox::information(this, tr("Genealogy Maker"), reader.errorString());
+        }
         return;
     }
 
+    // Add the persons in batches, so that the window stays responsive.
+    progress.setLabelText(tr("Adding persons..."));
+    scene->beginLoad(reader.width(), reader.height());
+
+    const QVector<PersonRecord> &persons = reader.persons();
+    scene->reservePersons(persons.size());
+    bool firstBatch = true;
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+
+    for (int i = 0; i < persons.size(); ++i) {
+        scene->addPerson(persons[i]);
+
+        if (batchTimer.elapsed() >= openBatchMilliseconds) {
+            // Show the first persons while the rest load.
+            if (firstBatch) {
+                view->centerOn(scene->firstItem());
+                firstBatch = false;
+            }
+
+            progress.setValue(50 + i * 50 / persons.size());
+            qApp->processEvents();
+            batchTimer.restart();
+
+            // Leave an empty diagram if cancelled.
+            if (progress.wasCanceled()) {
+                scene->beginLoad(reader.width(), reader.height());
+                scene->buildTextIndex();
+                m_saveFileName.clear();
+                updateWindowTitle();
+                undoStack->clear();
+                undoStack->setClean();
+                return;
+            }
+        }
+    }
+
+    scene->populateLinks(reader);
+    progress.setValue(100);
+
     // Scroll to first item.
     if (!scene->isEmpty()) {
         view->centerOn(scene->firstItem());
@@ -1846,6 +2384,9 @@ bool MainForm::saveFileExists() const
 
 bool MainForm::maybeSave()
 {
+    // Finish a save that is still running.
+    waitForSave();
+
     if (!undoStack->isClean()) {
         QString message = tr("The diagram has been modified.\n"
                              "Do you want to save your changes?");
@@ -1854,6 +2395,7 @@ bool MainForm::maybeSave()
         switch (ret) {
         case QMessageBox::Save:
             save();
+            waitForSave();
             return true;
         case QMessageBox::Cancel:
             return false;
@@ -1875,54 +2417,6 @@ void MainForm::viewPersonDetails(DiagramItem *person)
     dialogPersonDetails->show();
 }
 
-void MainForm::addPythonPath(QProcess *process) const
-{
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-
-    // Add Python library path if required.
-    QString key = "PYTHONPATH";
-    if (!env.contains(key)) {
-        env.insert(key, getPythonPath());
-    }
-
-    process->setProcessEnvironment(env);
-}
-
-QString MainForm::getPythonPath() const
-{
-    // Default path.
-    QString pythonPath = "C:\\Python27\\Lib";
-
-    // Run "where" to find the Python path
-    QString command("where");
-    QStringList params = QStringList() << "python";
-
-    // Create the process.
-    QProcess *process = new QProcess();
-
-    // Start the command.
-    process->start(command, params);
-    bool successful = process->waitForFinished(1000);
-
-    if (successful) {
-        // Read the path.
-        QString output(process->readAllStandardOutput());
-        QStringList lines = output.split("\n");
-        if (!lines.isEmpty()) {
-            pythonPath = lines.first().trimmed().replace("python.exe", "Lib");
-        }
-    }
-    else {
-        qDebug() << "Could not run 'where' to find Python path.";
-    }
-
-    // End the process.
-    process->close();
-
-    // Return the path.
-    return pythonPath;
-}
-
 DiagramScene *MainForm::getScene() const
 {
     return scene;
@@ -2019,79 +2513,27 @@ void MainForm::on_actionImportGedcomFile_triggered()
     // Create progress dialog.
     QProgressDialog progress("Importing GEDCOM File...", "Cancel", 0, 100, this);
     progress.setWindowModality(Qt::WindowModal);
-    progress.setLabelText("Setting up command...");
+    progress.setLabelText("Reading GEDCOM file...");
     progress.show();
     qApp->processEvents();
 
-    // Transform the file using Python.
-//    QString path = "/home/martin/lib/python-gedcom-1.0.0/";
-    QString path = "python-gedcom-1.0.0/";
-    QString command("python");
-    QString outputFileName("imported.xml");
-    QFileInfo outuptFileInfo(outputFileName);
-    QString outputFilePath = outuptFileInfo.absoluteFilePath();
-    QStringList params = QStringList() << "import_gedcom.py" << fileName << outputFilePath;
-
-    // Create the process.
-    QProcess *process = new QProcess();
-    process->setWorkingDirectory(path);
-
-    // Hack to set Python library path.
-#ifdef Q_OS_WIN
-    progress.setValue(10);
-    progress.setLabelText("Ensuring Python path exists...");
-    qApp->processEvents();
-
-    addPythonPath(process);
-#endif
-
-    // Start the command.
-    progress.setValue(20);
-    progress.setLabelText("Running conversion script...");
-    qApp->processEvents();
-
-    process->start(command, params);
-    bool successful = process->waitForFinished(3000);
-
-    if (!successful) {
-        // Warn the user if the import failed.
+    // Read the records.
+    GedcomImporter importer;
+    if (!importer.read(&file)) {
         QString title = tr("Import Error");
-        QString message = tr("<p>Could not import GEDCOM file, due to the following error:<br/>");
-        message += tr("%1</p>").arg(process->errorString());
-
-        // Advise about downloading Python.
-//        if (process->error() == QProcess::FailedToStart) {
-            message += tr("<p>The program requires Python to import GEDCOM files. "
-                    "You can download this from "
-                    "<a href=\"https://www.python.org/downloads/\">https://www.python.org/downloads/</a>.</p>");
-//        }
-
-        // Show the warning box.
-        QMessageBox msgBox(QMessageBox::Warning, title, message, QMessageBox::Ok, this);
-        msgBox.setTextFormat(Qt::RichText); // Make the link clickable.
-        msgBox.exec();
-
-        // Close the process and exit.
-        process->close();
+        QString message = tr("Could not import GEDCOM file, due to the following error:\n%1")
+                .arg(importer.errorString());
+        QMessageBox::warning(this, title, message);
         return;
     }
 
-    process->waitForFinished();
-
-    // Debug.
-//    qDebug() << "Std Error:" << process->readAllStandardError();
-//    qDebug() << "Std Output:" << process->readAllStandardOutput();
-
-    process->close();
-
-    // Load the transformed file.
+    // Add the persons to the diagram.
     progress.setValue(50);
-    progress.setLabelText("Opening transformed XML file...");
+    progress.setLabelText("Adding persons...");
     qApp->processEvents();
 
-    QFile outputXmlFile(outputFilePath);
-    scene->open(&outputXmlFile, getPhotosFolderFor(outputFilePath));
-    scene->autoLayout();
+    importer.populate(scene);
+    autoLayoutDiagram(false);
 
     // Scroll to first item.
     if (!scene->isEmpty()) {
@@ -2142,95 +2584,20 @@ void MainForm::on_actionExportGedcomFile_triggered()
         return;
     }
 
-    // Save a copy of the diagram.
-    //if (hasUnsavedChanges()) {
-    QTemporaryFile inputXmlFile;
-    if (inputXmlFile.open()) {
-        scene->save(&inputXmlFile, "");
-        inputXmlFile.close();
-    }
-    else {
-        QString message = tr("Cannot save temporary XML file %1:\n%2.")
-                .arg(inputXmlFile.fileName()).arg(inputXmlFile.errorString());
-        QMessageBox::warning(this, tr("Genealogy Maker"), message);
-        return;
-    }
-    //}
-
     // Create progress dialog.
     QProgressDialog progress("Exporting GEDCOM File...", "Cancel", 0, 100, this);
     progress.setWindowModality(Qt::WindowModal);
-    progress.setLabelText("Setting up command...");
+    progress.setLabelText("Writing GEDCOM file...");
     progress.show();
     qApp->processEvents();
 
-    // Transform the file using Python.
-    QString path = "python-gedcom-1.0.0/";
-    QString command("python");
-    QFileInfo outuptFileInfo(outputFileName);
-    QString outputFilePath = outuptFileInfo.absoluteFilePath();
-    QStringList params = QStringList() << "export_gedcom.py" << inputXmlFile.fileName() << outputFilePath;
-
-    // Create the process.
-    QProcess *process = new QProcess();
-    process->setWorkingDirectory(path);
-
-    // Hack to set Python library path.
-#ifdef Q_OS_WIN
-    progress.setValue(10);
-    progress.setLabelText("Ensuring Python path exists...");
-    qApp->processEvents();
-
-    addPythonPath(process);
-#endif
-
-    // Start the command.
-    progress.setValue(20);
-    progress.setLabelText("Running conversion script...");
-    qApp->processEvents();
-
-    process->start(command, params);
-    bool successful = process->waitForFinished(3000);
-
-    if (!successful) {
-        // Warn the user if the import failed.
-        QString title = tr("Export Error");
-        QString message = tr("<p>Could not export GEDCOM file, due to the following error:<br/>");
-        message += tr("%1</p>").arg(process->errorString());
-
-        // Advise about downloading Python.
-//        if (process->error() == QProcess::FailedToStart) {
-            message += tr("<p>The program requires Python to export GEDCOM files. "
-                    "You can download this from "
-                    "<a href=\"https://www.python.org/downloads/\">https://www.python.org/downloads/</a>.</p>");
-//        }
-
-        // Show the warning box.
-        QMessageBox msgBox(QMessageBox::Warning, title, message, QMessageBox::Ok, this);
-        msgBox.setTextFormat(Qt::RichText); // Make the link clickable.
-        msgBox.exec();
-
-        // Close the process and exit.
-        process->close();
-        return;
-    }
-
-    process->waitForFinished();
-
-    // Store error output.
-    QString errorOutput(process->readAllStandardError());
-
-    process->close();
-
-    // Check exit code.
-    int exitCode = process->exitCode();
-    if (exitCode != 0) {
-        // There was an error.
+    // Write the file.
+    GedcomExporter exporter;
+    if (!exporter.write(scene, &file)) {
         QString title = tr("Problem Exporting GEDCOM");
-        QString message = tr("There was a problem exporting the GEDCOM file:\n\n");
-        message += errorOutput;
-        QMessageBox msgBox(QMessageBox::Warning, title, message, QMessageBox::Ok, this);
-        msgBox.exec();
+        QString message = tr("There was a problem exporting the GEDCOM file:\n\n%1")
+                .arg(exporter.errorString());
+        QMessageBox::warning(this, title, message);
         return;
     }
 
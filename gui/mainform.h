@@ -19,8 +19,12 @@
 #define MAINFORM_H
 
 #include "diagramitem.h"
+#include "diagramwriter.h"
+#include "layoutengine.h"
 
+#include <QFutureWatcher>
 #include <QMainWindow>
+#include <QSharedPointer>
 
 namespace Ui {
 class MainForm;
@@ -52,10 +56,10 @@ class DialogMarriageDetails;
 //class DialogHelp;
 class HelpWindow;
 class PreferencesWindow;
-class QProcess;
 class QPushButton;
 class DialogFileProperties;
 class QSlider;
+class QTimeLine;
 QT_END_NAMESPACE
 
 //! [0]
@@ -73,9 +77,11 @@ public:
 
    void updateGuiFromPreferences();
    void open(const QString &fileName);
+   void waitForSave();
+   void waitForLayout();
 
 public slots:
-   void onItemTextEdited(QGraphicsItem *item);
+   void onPersonNameChanged(DiagramItem *person);
 
 private slots:
     void backgroundButtonGroupClicked(QAbstractButton *button);
@@ -117,6 +123,9 @@ private slots:
     void onItemsFinishedMoving();
     void onFind();
     void onSearch(const QString &text);
+    void onSearchPrevious(const QString &text);
+    void onSearchTextChanged(const QString &text);
+    void onSearchMatchChosen(int index);
     void viewSelectedItemDetails();
     void onPeopleMarried(DiagramItem *person1, DiagramItem *person2);
     void removeMarriage();
@@ -164,6 +173,20 @@ private slots:
 
     void on_actionFileExportImage_triggered();
 
+    void onSaveFinished();
+
+    void onLayoutFinished();
+
+    void applyLayoutBatch();
+
+    void onLayoutAnimationStep(qreal value);
+
+    void completeLayout();
+
+    void onUndo();
+
+    void onRedo();
+
 protected:
     void closeEvent(QCloseEvent *event) override;
 
@@ -184,9 +207,10 @@ private:
     QString saveFileDir();
     bool saveFileExists() const;
     bool maybeSave();
+    void startSave(const QString &fileName);
+    bool takeLayoutResult();
+    QString saveFileFilter() const;
     void viewPersonDetails(DiagramItem *person);
-    void addPythonPath(QProcess *process) const;
-    QString getPythonPath() const;
     void styleToolButton(QToolButton *button) const;
     QString getPhotosFolderFor(const QString &fileName) const;
 
@@ -197,7 +221,8 @@ private:
     void removeFromRecentFiles(const QString &fileName);
 
     // Search.
-    bool searchCheckPerson(QList<QGraphicsItem *> &items, int index, const QString &text);
+    void updateSearchMatches(const QString &text);
+    void goToSearchMatch(int index);
 
     void exportImage();
 
@@ -206,12 +231,18 @@ private:
 
     void showFileProperties();
 
-    void autoLayoutDiagram();
+    void autoLayoutDiagram(bool undoable = true);
+    void finishLayout();
+    void cancelLayout();
+    bool animateLayout() const;
 
     void openExampleDiagram();
     QString exampleFileDir() const;
 
     bool shouldRemoveInvalidFiles() const;
+    bool useSharedPhotoStore() const;
+    bool useAutoLayoutFamily() const;
+    void autoLayoutFamily(const QList<DiagramItem *> &persons);
 
     void setSceneScale(double scale);
 
@@ -326,6 +357,10 @@ private:
 
     // Search index.
     int m_searchFoundIndex;
+    QString m_searchText;
+    int m_searchMode;
+    QVector<DiagramItem *> m_searchMatches;
+    QStringList m_searchLines; ///< Rich text for each ranked match.
 
     QString m_lastDiagramOpenFolder;
     QString m_lastGedcomImportFolder;
@@ -335,6 +370,28 @@ private:
 
     // Flag for updating slider from combo-box.
     bool m_disableZoomSliderSignal;
+
+    // Background save.
+    QFutureWatcher<bool> *m_saveWatcher;
+    DiagramSnapshot m_saveSnapshot;
+    QString m_saveErrorString;
+    QString m_savingFileName;
+    QMetaObject::Connection m_saveChangeConnection;
+    bool m_changedDuringSave;
+    bool m_savePending;
+
+    // Background layout.
+    QFutureWatcher<LayoutResult> *m_layoutWatcher;
+    QSharedPointer<QAtomicInt> m_layoutCancelled;
+    QVector<QUuid> m_layoutUnits;
+    QVector<DiagramItem *> m_layoutItems;
+    QVector<QPointF> m_layoutStart;
+    LayoutResult m_layoutResult;
+    MoveItemsUndo *m_layoutUndo;
+    QTimeLine *m_layoutAnimation;
+    int m_layoutNext;
+    bool m_layoutUndoable;
+    bool m_layoutPending;
 };
 
 #endif // MAINFORM_H
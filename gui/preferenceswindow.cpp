@@ -59,6 +59,26 @@ void PreferencesWindow::loadPreferences()
     bool removeInvalidFiles = settings.value("interface/removeInvalidFiles", false).toBool();
     ui->checkBoxRemoveInvalidFiles->setChecked(removeInvalidFiles);
 
+    // Load shared photo store setting.
+    bool sharedPhotoStore = settings.value("diagram/sharedPhotoStore", false).toBool();
+    ui->checkBoxSharedPhotoStore->setChecked(sharedPhotoStore);
+
+    // Load family layout setting.
+    bool autoLayoutFamily = settings.value("diagram/autoLayoutFamily", false).toBool();
+    ui->checkBoxAutoLayoutFamily->setChecked(autoLayoutFamily);
+
+    // Load layout animation setting.
+    bool animateLayout = settings.value("diagram/animateLayout", true).toBool();
+    ui->checkBoxAnimateLayout->setChecked(animateLayout);
+
+    // Load arrow batching setting.
+    bool batchArrows = settings.value("diagram/batchArrows", false).toBool();
+    ui->checkBoxBatchArrows->setChecked(batchArrows);
+
+    // Load render cache setting.
+    bool renderCache = settings.value("diagram/renderCache", true).toBool();
+    ui->checkBoxRenderCache->setChecked(renderCache);
+
     // Load "diagram font size" setting.
     QString fontFamily = settings.value("diagram/fontFamily", "Arial").toString();
     ui->fontComboBoxDiagramFont->setCurrentText(fontFamily);
@@ -95,6 +115,26 @@ void PreferencesWindow::apply()
     bool removeInvalidFiles =  ui->checkBoxRemoveInvalidFiles->isChecked();
     settings.setValue("interface/removeInvalidFiles", removeInvalidFiles);
 
+    // Store the shared photo store setting.
+    bool sharedPhotoStore = ui->checkBoxSharedPhotoStore->isChecked();
+    settings.setValue("diagram/sharedPhotoStore", sharedPhotoStore);
+
+    // Store the family layout setting.
+    bool autoLayoutFamily = ui->checkBoxAutoLayoutFamily->isChecked();
+    settings.setValue("diagram/autoLayoutFamily", autoLayoutFamily);
+
+    // Store the layout animation setting.
+    bool animateLayout = ui->checkBoxAnimateLayout->isChecked();
+    settings.setValue("diagram/animateLayout", animateLayout);
+
+    // Store the arrow batching setting.
+    bool batchArrows = ui->checkBoxBatchArrows->isChecked();
+    settings.setValue("diagram/batchArrows", batchArrows);
+
+    // Store the render cache setting.
+    bool renderCache = ui->checkBoxRenderCache->isChecked();
+    settings.setValue("diagram/renderCache", renderCache);
+
     // Store the font setting.
     QFont font = ui->fontComboBoxDiagramFont->currentFont();
     settings.setValue("diagram/fontFamily", font.family());
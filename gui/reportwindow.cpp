@@ -3,6 +3,7 @@
 
 #include "diagramitem.h"
 #include "diagramscene.h"
+#include "generationindex.h"
 
 ReportWindow::ReportWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -29,15 +30,7 @@ void ReportWindow::createReportFor(DiagramScene *scene)
 {
     int row = 0;
 
-    for (auto item: scene->items()) {
-
-        // Skip if not a person.
-        if (item->type() != DiagramItem::Type) {
-            continue;
-        }
-
-        // Cast.
-        DiagramItem *person = dynamic_cast<DiagramItem*> (item);
+    for (DiagramItem *person: scene->persons()) {
 
         // Create row.
         ui->tableWidgetReport->setRowCount(row + 1);
@@ -64,6 +57,7 @@ void ReportWindow::createReportFor(DiagramScene *scene)
         }
         addCell(row, column++, person->getPlaceOfDeath());
         addCell(row, column++, person->getGender());
+        addCell(row, column++, QString::number(GenerationIndex::generation(person) + 1));
 
         // Go to next row.
         ++row;
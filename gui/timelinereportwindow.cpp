@@ -30,28 +30,17 @@ TimelineReportWindow::~TimelineReportWindow()
 
 void TimelineReportWindow::createReportFor(DiagramScene *scene)
 {
-    for (auto item: scene->items()) {
-        if (item->type() == MarriageItem::Type) {
-            // Cast.
-            MarriageItem *marriage = dynamic_cast<MarriageItem*> (item);
-
-            // Add event.
-            QString description = marriage->personLeft()->name() + " and "
-                    + marriage->personRight()->name() + " married.";
-            addRow(marriage->getDate(), "Marriage", description);
-        }
-        else if (item->type() == DiagramItem::Type) {
-            // Cast.
-            DiagramItem *person = dynamic_cast<DiagramItem*> (item);
-
-            // Get events.
-            person->getDateOfBirth();
-            person->getDateOfDeath();
+    for (MarriageItem *marriage: scene->marriages()) {
+        // Add event.
+        QString description = marriage->personLeft()->name() + " and "
+                + marriage->personRight()->name() + " married.";
+        addRow(marriage->getDate(), "Marriage", description);
+    }
 
-            // Create row.
-            addRow(person->getDateOfBirth(), "Birth", person->name() + " born.");
-            addRow(person->getDateOfDeath(), "Death", person->name() + " died.");
-        }
+    for (DiagramItem *person: scene->persons()) {
+        // Create row.
+        addRow(person->getDateOfBirth(), "Birth", person->name() + " born.");
+        addRow(person->getDateOfDeath(), "Death", person->name() + " died.");
     }
 
     // Resize columns.
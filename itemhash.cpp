@@ -0,0 +1,225 @@
+#include "itemhash.h"
+
+// The number of slots to start with.
+static const int minimumCapacity = 16;
+
+ItemHash::ItemHash() :
+    m_count(0)
+{
+
+}
+
+void ItemHash::reserve(int count)
+{
+    int capacity = minimumCapacity;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+
+    if (capacity > m_slots.size()) {
+        rehash(capacity);
+    }
+}
+
+void ItemHash::insert(const QUuid &id, DiagramItem *item)
+{
+    insertKey(key(id), item);
+}
+
+void ItemHash::insert(const QString &pointer, DiagramItem *item)
+{
+    Key packed;
+    if (packPointer(pointer, packed)) {
+        insertKey(packed, item);
+    }
+    else if (item) {
+        m_longPointers.insert(pointer, item);
+    }
+    else {
+        m_longPointers.remove(pointer);
+    }
+}
+
+DiagramItem *ItemHash::value(const QUuid &id) const
+{
+    int slot = find(key(id));
+    return (slot == -1) ? nullptr : m_slots[slot].item;
+}
+
+DiagramItem *ItemHash::value(const QString &pointer) const
+{
+    Key packed;
+    if (!packPointer(pointer, packed)) {
+        return m_longPointers.value(pointer);
+    }
+
+    int slot = find(packed);
+    return (slot == -1) ? nullptr : m_slots[slot].item;
+}
+
+void ItemHash::remove(const QUuid &id)
+{
+    removeKey(key(id));
+}
+
+void ItemHash::remove(const QString &pointer)
+{
+    Key packed;
+    if (packPointer(pointer, packed)) {
+        removeKey(packed);
+    }
+    else {
+        m_longPointers.remove(pointer);
+    }
+}
+
+void ItemHash::clear()
+{
+    m_slots.clear();
+    m_count = 0;
+    m_longPointers.clear();
+}
+
+int ItemHash::size() const
+{
+    return m_count + m_longPointers.size();
+}
+
+ItemHash::Key ItemHash::key(const QUuid &id)
+{
+    Key result;
+    result.high = (quint64(id.data1) << 32) | (quint64(id.data2) << 16) | id.data3;
+    result.low = 0;
+    for (int i = 0; i < 8; ++i) {
+        result.low = (result.low << 8) | id.data4[i];
+    }
+    return result;
+}
+
+///
+/// \brief ItemHash::packPointer Pack a pointer into a key, one byte per character.
+/// \return False if the pointer is too long, or has characters that do not fit in a byte.
+///
+bool ItemHash::packPointer(const QString &pointer, Key &key)
+{
+    if (pointer.size() > 16) {
+        return false;
+    }
+
+    // Pointers have no null characters, so the padding keeps each key unique.
+    key.high = 0;
+    key.low = 0;
+    for (int i = 0; i < pointer.size(); ++i) {
+        ushort c = pointer[i].unicode();
+        if (c == 0 || c > 0xff) {
+            return false;
+        }
+
+        quint64 &half = (i < 8) ? key.high : key.low;
+        half |= quint64(c) << (8 * (7 - i % 8));
+    }
+
+    return true;
+}
+
+int ItemHash::bucket(const Key &key) const
+{
+    // Mix the bits, since ids made from names or times differ in few of them.
+    quint64 hash = (key.high * Q_UINT64_C(0x9e3779b97f4a7c15)) ^ key.low;
+    hash ^= hash >> 32;
+    hash *= Q_UINT64_C(0xff51afd7ed558ccd);
+    hash ^= hash >> 29;
+    return int(hash & quint64(m_slots.size() - 1));
+}
+
+///
+/// \brief ItemHash::find Find the slot of a key.
+/// \return The slot, or -1 if the key is not listed.
+///
+int ItemHash::find(const Key &key) const
+{
+    if (m_count == 0) {
+        return -1;
+    }
+
+    int mask = m_slots.size() - 1;
+    for (int slot = bucket(key); m_slots[slot].item; slot = (slot + 1) & mask) {
+        const Key &found = m_slots[slot].key;
+        if (found.high == key.high && found.low == key.low) {
+            return slot;
+        }
+    }
+
+    return -1;
+}
+
+void ItemHash::insertKey(const Key &key, DiagramItem *item)
+{
+    if (!item) {
+        removeKey(key);
+        return;
+    }
+
+    if ((m_count + 1) * 2 > m_slots.size()) {
+        rehash(qMax(minimumCapacity, m_slots.size() * 2));
+    }
+
+    int mask = m_slots.size() - 1;
+    int slot = bucket(key);
+    while (m_slots[slot].item) {
+        const Key &found = m_slots[slot].key;
+        if (found.high == key.high && found.low == key.low) {
+            m_slots[slot].item = item;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    m_slots[slot].key = key;
+    m_slots[slot].item = item;
+    ++m_count;
+}
+
+void ItemHash::removeKey(const Key &key)
+{
+    int slot = find(key);
+    if (slot == -1) {
+        return;
+    }
+
+    // Move later keys of the run back into the gap, so that no marker is
+    // needed for removed keys.
+    int mask = m_slots.size() - 1;
+    int gap = slot;
+    for (int next = (gap + 1) & mask; m_slots[next].item; next = (next + 1) & mask) {
+        int home = bucket(m_slots[next].key);
+        bool canMove = (gap <= next) ? (home <= gap || home > next)
+                                     : (home <= gap && home > next);
+        if (canMove) {
+            m_slots[gap] = m_slots[next];
+            gap = next;
+        }
+    }
+
+    m_slots[gap].item = nullptr;
+    --m_count;
+}
+
+void ItemHash::rehash(int capacity)
+{
+    QVector<Slot> old;
+    old.swap(m_slots);
+
+    Slot empty;
+    empty.key.high = 0;
+    empty.key.low = 0;
+    empty.item = nullptr;
+    m_slots.fill(empty, capacity);
+    m_count = 0;
+
+    for (const Slot &slot: old) {
+        if (slot.item) {
+            insertKey(slot.key, slot.item);
+        }
+    }
+}
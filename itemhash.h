@@ -0,0 +1,75 @@
+#ifndef ITEMHASH_H
+#define ITEMHASH_H
+
+#include <QHash>
+#include <QString>
+#include <QUuid>
+#include <QVector>
+
+class DiagramItem;
+
+/**
+ * @brief The ItemHash class finds persons by their id, or by their GEDCOM
+ * pointer while importing.
+ *
+ * Keys are kept as 128 bits in one flat array, and found by linear probing,
+ * so a lookup reads one or two slots and no node is allocated per person.
+ * GEDCOM pointers such as "@I123@" are packed into the same 128 bits, so the
+ * text of each pointer is not kept. The rare pointer longer than 16 characters
+ * is kept in a normal hash.
+ *
+ * Looking up a key that is not listed does not add it.
+ */
+class ItemHash
+{
+public:
+    ItemHash();
+
+    /**
+     * @brief reserve Make room for a number of persons, to avoid growing while loading.
+     */
+    void reserve(int count);
+
+    void insert(const QUuid &id, DiagramItem *item);
+    void insert(const QString &pointer, DiagramItem *item);
+
+    /**
+     * @brief value Find a person.
+     * @return The person, or null if not listed.
+     */
+    DiagramItem *value(const QUuid &id) const;
+    DiagramItem *value(const QString &pointer) const;
+
+    void remove(const QUuid &id);
+    void remove(const QString &pointer);
+
+    void clear();
+    int size() const;
+
+private:
+    struct Key
+    {
+        quint64 high;
+        quint64 low;
+    };
+
+    struct Slot
+    {
+        Key key;
+        DiagramItem *item; ///< Null if the slot is free.
+    };
+
+    static Key key(const QUuid &id);
+    static bool packPointer(const QString &pointer, Key &key);
+    int bucket(const Key &key) const;
+    int find(const Key &key) const;
+    void insertKey(const Key &key, DiagramItem *item);
+    void removeKey(const Key &key);
+    void rehash(int capacity);
+
+    QVector<Slot> m_slots; ///< A power of two in size, at most half full.
+    int m_count;
+    QHash<QString, DiagramItem *> m_longPointers;
+};
+
+#endif // ITEMHASH_H
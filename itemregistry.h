@@ -0,0 +1,175 @@
+#ifndef ITEMREGISTRY_H
+#define ITEMREGISTRY_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+#include <algorithm>
+
+/**
+ * @brief The ItemRegistry class lists the scene items of one kind in a
+ * contiguous array, so that passes over all of them need no sorting or
+ * filtering, and no list is built.
+ *
+ * Items are kept in the order they were first added, so that saving and
+ * exporting write them in a stable order. Each item carries the number it
+ * was first added with in its data, so that an item added again, as by undo,
+ * goes back to its old place, while a new item goes last. Removing leaves a
+ * gap, and items added again are put after the others; both are sorted out
+ * at once the next time the items are read.
+ */
+template <typename T>
+class ItemRegistry
+{
+public:
+    /// The QGraphicsItem::data() key of the number an item was first added with.
+    static const int SequenceKey = 0x5e9;
+
+    ItemRegistry() :
+        m_gapCount(0),
+        m_sortedCount(0),
+        m_nextSequence(1)
+    {
+
+    }
+
+    /**
+     * @brief insert Add an item, unless already listed.
+     */
+    void insert(T *item)
+    {
+        if (m_positions.contains(item)) {
+            return;
+        }
+
+        // A new item goes last, and keeps its number when removed.
+        quint64 sequence = item->data(SequenceKey).toULongLong();
+        if (sequence == 0) {
+            sequence = m_nextSequence++;
+            item->setData(SequenceKey, sequence);
+        }
+
+        // An item added again is sorted into its place when read.
+        bool inOrder = (m_sequences.isEmpty() || m_sequences.last() < sequence);
+        if (inOrder && m_sortedCount == m_items.size()) {
+            ++m_sortedCount;
+        }
+
+        m_positions.insert(item, m_items.size());
+        m_items << item;
+        m_sequences << sequence;
+    }
+
+    /**
+     * @brief remove Remove an item, if listed.
+     */
+    void remove(T *item)
+    {
+        auto found = m_positions.find(item);
+        if (found == m_positions.end()) {
+            return;
+        }
+
+        // Leave a gap, to be closed when read.
+        int position = found.value();
+        m_positions.erase(found);
+        m_items[position] = nullptr;
+        ++m_gapCount;
+    }
+
+    void clear()
+    {
+        m_items.clear();
+        m_sequences.clear();
+        m_positions.clear();
+        m_gapCount = 0;
+        m_sortedCount = 0;
+    }
+
+    bool contains(T *item) const
+    {
+        return m_positions.contains(item);
+    }
+
+    int size() const
+    {
+        return m_positions.size();
+    }
+
+    /**
+     * @brief items Get the items, in the order they were first added.
+     */
+    const QVector<T *> &items() const
+    {
+        compact();
+        return m_items;
+    }
+
+private:
+    /**
+     * @brief compact Close the gaps left by removed items, and sort the items
+     * added again into their places.
+     */
+    void compact() const
+    {
+        if (m_gapCount == 0 && m_sortedCount == m_items.size()) {
+            return;
+        }
+
+        // Close the gaps, counting how many of the sorted items are left.
+        int next = 0;
+        int sortedCount = 0;
+        for (int i = 0; i < m_items.size(); ++i) {
+            T *item = m_items[i];
+            if (!item) {
+                continue;
+            }
+
+            m_items[next] = item;
+            m_sequences[next] = m_sequences[i];
+            if (i < m_sortedCount) {
+                ++sortedCount;
+            }
+            ++next;
+        }
+
+        m_items.resize(next);
+        m_sequences.resize(next);
+        m_gapCount = 0;
+
+        if (sortedCount < next) {
+            // Sort the items added again, then merge them with the others.
+            QVector<QPair<quint64, T *>> entries;
+            entries.reserve(next);
+            for (int i = 0; i < next; ++i) {
+                entries << qMakePair(m_sequences[i], m_items[i]);
+            }
+
+            std::sort(entries.begin() + sortedCount, entries.end());
+            std::inplace_merge(entries.begin(), entries.begin() + sortedCount, entries.end());
+
+            for (int i = 0; i < next; ++i) {
+                m_sequences[i] = entries[i].first;
+                m_items[i] = entries[i].second;
+            }
+        }
+
+        for (int i = 0; i < next; ++i) {
+            m_positions[m_items[i]] = i;
+        }
+        m_sortedCount = next;
+    }
+
+    // Compacted when read, so these change in const functions.
+    mutable QVector<T *> m_items;
+    mutable QVector<quint64> m_sequences; ///< The number each item was first added with.
+    mutable QHash<T *, int> m_positions;
+    mutable int m_gapCount;
+    mutable int m_sortedCount; ///< The items before this are in order; those after were added again.
+
+    quint64 m_nextSequence;
+};
+
+#endif // ITEMREGISTRY_H
@@ -0,0 +1,78 @@
+#include "kinshipgraph.h"
+#include "diagramitem.h"
+
+KinshipGraph::KinshipGraph()
+{
+
+}
+
+void KinshipGraph::descendants(DiagramItem *person, QVector<DiagramItem *> &result)
+{
+    walk(person, false, true, result);
+}
+
+void KinshipGraph::ancestors(DiagramItem *person, QVector<DiagramItem *> &result)
+{
+    walk(person, true, false, result);
+}
+
+bool KinshipGraph::isAncestorOf(DiagramItem *ancestor, DiagramItem *person)
+{
+    walk(person, true, false, m_ancestors);
+
+    // Skip the person.
+    for (int i = 1; i < m_ancestors.size(); ++i) {
+        if (m_ancestors[i] == ancestor) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void KinshipGraph::walk(DiagramItem *person, bool upwards, bool followSpouses,
+                        QVector<DiagramItem *> &result)
+{
+    // The result doubles as the queue, so nothing else is allocated.
+    const quint32 mark = nextMark();
+    result.clear();
+    result << person;
+    person->m_kinshipMark = mark;
+
+    for (int i = 0; i < result.size(); ++i) {
+        DiagramItem *current = result[i];
+
+        for (int side = 0; side < 2; ++side) {
+            DiagramItem *from = current;
+
+            // Follow the spouse's links too if required.
+            if (side == 1) {
+                if (!followSpouses || !current->isMarried()) {
+                    break;
+                }
+                from = current->getSpouse();
+            }
+
+            const QVector<DiagramItem *> &next = upwards ? from->getParents() : from->getChildren();
+            for (DiagramItem *relative: next) {
+                if (relative->m_kinshipMark != mark) {
+                    relative->m_kinshipMark = mark;
+                    result << relative;
+                }
+            }
+        }
+    }
+}
+
+quint32 KinshipGraph::nextMark()
+{
+    // Shared by all graphs, since an item can move between scenes.
+    static quint32 mark = 0;
+
+    // Items start with mark 0, so it is skipped when the counter wraps.
+    if (++mark == 0) {
+        ++mark;
+    }
+
+    return mark;
+}
@@ -0,0 +1,51 @@
+#ifndef KINSHIPGRAPH_H
+#define KINSHIPGRAPH_H
+
+#include <QVector>
+
+class DiagramItem;
+
+/**
+ * @brief The KinshipGraph class walks the parent and child links of a scene.
+ *
+ * Each person keeps its own parent and child arrays, updated whenever an
+ * arrow is added or removed, including through undo and redo. The walks
+ * mark visited persons in place, so each costs O(persons + links) and only
+ * allocates when its buffers first grow.
+ */
+class KinshipGraph
+{
+public:
+    KinshipGraph();
+
+    /**
+     * @brief descendants Get a person and their descendants, following the
+     * children of each person and of their spouse.
+     * @param person The person to start from.
+     * @param result Set to the persons found, each once, starting with the person.
+     */
+    void descendants(DiagramItem *person, QVector<DiagramItem *> &result);
+
+    /**
+     * @brief ancestors Get a person and their ancestors.
+     * @param person The person to start from.
+     * @param result Set to the persons found, each once, starting with the person.
+     */
+    void ancestors(DiagramItem *person, QVector<DiagramItem *> &result);
+
+    /**
+     * @brief isAncestorOf Check whether a person is an ancestor of another.
+     * @param ancestor The possible ancestor.
+     * @param person The person.
+     * @return True if the ancestor can be reached by following parent links.
+     */
+    bool isAncestorOf(DiagramItem *ancestor, DiagramItem *person);
+
+private:
+    void walk(DiagramItem *person, bool upwards, bool followSpouses, QVector<DiagramItem *> &result);
+    static quint32 nextMark();
+
+    QVector<DiagramItem *> m_ancestors;
+};
+
+#endif // KINSHIPGRAPH_H
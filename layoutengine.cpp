@@ -0,0 +1,604 @@
+#include "layoutengine.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <random>
+
+// Spacing, matching the old row layout.
+static const qreal leftMargin = 128;
+static const qreal topMargin = 64;
+static const qreal horizontalSpacing = 16;
+static const qreal rowSpacing = 256;
+
+// How hard to try.
+static const int sweepCount = 8;
+static const int trialCount = 8;
+static const int coordinatePassCount = 4;
+
+/**
+ * @brief The LayeredGraph struct is the graph split into rows, with invisible
+ * nodes added so that every link joins neighbouring rows.
+ */
+struct LayeredGraph
+{
+    int realCount = 0;
+    QVector<int> layer;
+    QVector<qreal> width;
+    QVector<QVector<int> > upper; ///< Neighbours in the row above.
+    QVector<QVector<int> > lower; ///< Neighbours in the row below.
+    int layerCount = 0;
+};
+
+static bool isCancelled(const QAtomicInt *cancelled)
+{
+    return cancelled && cancelled->load() != 0;
+}
+
+/**
+ * @brief The Trial struct is one attempt at ordering the rows.
+ */
+struct Trial
+{
+    unsigned int seed;
+    QVector<QVector<int> > order;
+    qint64 crossings;
+};
+
+///
+/// \brief removeCycles Find the links that close a parent/child cycle, with an iterative depth-first search.
+/// \param nodeCount The number of nodes.
+/// \param children The children of each node.
+/// \param removed Set to true for each link to ignore, indexed like the children.
+/// \return The number of links removed.
+///
+static int removeCycles(int nodeCount, const QVector<QVector<int> > &children,
+                        QVector<QVector<bool> > &removed)
+{
+    enum { White, Grey, Black };
+    QVector<char> colour(nodeCount, White);
+    QVector<QPair<int, int> > stack; // Node and next child index.
+    int removedCount = 0;
+
+    removed.resize(nodeCount);
+    for (int i = 0; i < nodeCount; ++i) {
+        removed[i].fill(false, children[i].size());
+    }
+
+    for (int root = 0; root < nodeCount; ++root) {
+        if (colour[root] != White) {
+            continue;
+        }
+
+        colour[root] = Grey;
+        stack << qMakePair(root, 0);
+
+        while (!stack.isEmpty()) {
+            int node = stack.last().first;
+            int &next = stack.last().second;
+
+            if (next == children[node].size()) {
+                colour[node] = Black;
+                stack.removeLast();
+                continue;
+            }
+
+            int index = next++;
+            int child = children[node][index];
+
+            if (colour[child] == Grey) {
+                // A link back to a node still being visited closes a cycle.
+                removed[node][index] = true;
+                ++removedCount;
+            }
+            else if (colour[child] == White) {
+                colour[child] = Grey;
+                stack << qMakePair(child, 0);
+            }
+        }
+    }
+
+    return removedCount;
+}
+
+///
+/// \brief assignLayers Put each node one row above its lowest child, so the
+/// oldest generations are at the top.
+/// \param children The children of each node.
+/// \param removed The links to ignore.
+/// \return The row of each node.
+///
+static QVector<int> assignLayers(const QVector<QVector<int> > &children,
+                                 const QVector<QVector<bool> > &removed)
+{
+    const int nodeCount = children.size();
+
+    // Count the remaining children of each node, and find the parents.
+    QVector<int> pending(nodeCount, 0);
+    QVector<QVector<int> > parents(nodeCount);
+
+    for (int node = 0; node < nodeCount; ++node) {
+        for (int i = 0; i < children[node].size(); ++i) {
+            if (!removed[node][i]) {
+                ++pending[node];
+                parents[children[node][i]] << node;
+            }
+        }
+    }
+
+    // Work upwards from the nodes without children.
+    QVector<int> rank(nodeCount, 0);
+    QVector<int> queue;
+    queue.reserve(nodeCount);
+
+    for (int node = 0; node < nodeCount; ++node) {
+        if (pending[node] == 0) {
+            queue << node;
+        }
+    }
+
+    for (int i = 0; i < queue.size(); ++i) {
+        int node = queue[i];
+        for (int parent: parents[node]) {
+            rank[parent] = qMax(rank[parent], rank[node] + 1);
+            if (--pending[parent] == 0) {
+                queue << parent;
+            }
+        }
+    }
+
+    // Turn the ranks into rows from the top.
+    int maxRank = 0;
+    for (int value: rank) {
+        maxRank = qMax(maxRank, value);
+    }
+
+    QVector<int> layers(nodeCount);
+    for (int node = 0; node < nodeCount; ++node) {
+        layers[node] = maxRank - rank[node];
+    }
+
+    return layers;
+}
+
+///
+/// \brief useRanks Use ranks that are already known, ignoring the links that do not go down.
+/// \param ranks The rank of each node.
+/// \param children The children of each node.
+/// \param removed Set to true for each link to ignore, indexed like the children.
+/// \param layers Set to the row of each node.
+/// \return The number of links ignored.
+///
+static int useRanks(const QVector<int> &ranks, const QVector<QVector<int> > &children,
+                    QVector<QVector<bool> > &removed, QVector<int> &layers)
+{
+    const int nodeCount = ranks.size();
+    int removedCount = 0;
+    int maxRank = 0;
+
+    removed.resize(nodeCount);
+    for (int node = 0; node < nodeCount; ++node) {
+        removed[node].resize(children[node].size());
+        for (int i = 0; i < children[node].size(); ++i) {
+            removed[node][i] = ranks[node] <= ranks[children[node][i]];
+            if (removed[node][i]) {
+                ++removedCount;
+            }
+        }
+        maxRank = qMax(maxRank, ranks[node]);
+    }
+
+    layers.resize(nodeCount);
+    for (int node = 0; node < nodeCount; ++node) {
+        layers[node] = maxRank - ranks[node];
+    }
+
+    return removedCount;
+}
+
+///
+/// \brief buildLayeredGraph Split the links that span several rows with invisible nodes.
+///
+static LayeredGraph buildLayeredGraph(const LayoutGraph &graph, const QVector<int> &layers,
+                                      const QVector<QVector<int> > &children,
+                                      const QVector<QVector<bool> > &removed)
+{
+    LayeredGraph layered;
+    layered.realCount = graph.nodes.size();
+    layered.layer = layers;
+    layered.upper.resize(layered.realCount);
+    layered.lower.resize(layered.realCount);
+    layered.width.resize(layered.realCount);
+
+    for (int node = 0; node < layered.realCount; ++node) {
+        layered.width[node] = graph.nodes[node].width;
+        layered.layerCount = qMax(layered.layerCount, layers[node] + 1);
+    }
+
+    for (int node = 0; node < layered.realCount; ++node) {
+        for (int i = 0; i < children[node].size(); ++i) {
+            if (removed[node][i]) {
+                continue;
+            }
+
+            int child = children[node][i];
+            int previous = node;
+
+            // Add an invisible node for each row the link passes through.
+            for (int row = layers[node] + 1; row < layers[child]; ++row) {
+                int dummy = layered.layer.size();
+                layered.layer << row;
+                layered.width << 0;
+                layered.upper << QVector<int>();
+                layered.lower << QVector<int>();
+                layered.lower[previous] << dummy;
+                layered.upper[dummy] << previous;
+                previous = dummy;
+            }
+
+            layered.lower[previous] << child;
+            layered.upper[child] << previous;
+        }
+    }
+
+    return layered;
+}
+
+///
+/// \brief initialOrder Order the rows by a depth-first walk from the top, so
+/// that families start out together.
+///
+static QVector<QVector<int> > initialOrder(const LayeredGraph &layered)
+{
+    const int nodeCount = layered.layer.size();
+    QVector<QVector<int> > order(layered.layerCount);
+    QVector<bool> visited(nodeCount, false);
+    QVector<int> stack;
+
+    // Start from the nodes without parents, top rows first.
+    QVector<int> roots;
+    for (int node = 0; node < nodeCount; ++node) {
+        if (layered.upper[node].isEmpty()) {
+            roots << node;
+        }
+    }
+    std::stable_sort(roots.begin(), roots.end(), [&layered](int a, int b) {
+        return layered.layer[a] < layered.layer[b];
+    });
+
+    for (int root: roots) {
+        if (visited[root]) {
+            continue;
+        }
+        stack << root;
+
+        while (!stack.isEmpty()) {
+            int node = stack.takeLast();
+            if (visited[node]) {
+                continue;
+            }
+            visited[node] = true;
+            order[layered.layer[node]] << node;
+
+            // Push in reverse, so the first child is visited first.
+            const QVector<int> &lower = layered.lower[node];
+            for (int i = lower.size() - 1; i >= 0; --i) {
+                if (!visited[lower[i]]) {
+                    stack << lower[i];
+                }
+            }
+        }
+    }
+
+    return order;
+}
+
+///
+/// \brief countCrossings Count the crossings between two neighbouring rows,
+/// using a Fenwick tree over the lower row.
+///
+static qint64 countCrossings(const LayeredGraph &layered, const QVector<int> &upperRow,
+                             const QVector<int> &lowerRow, const QVector<int> &position)
+{
+    // List the lower ends of the links, in order of their upper ends.
+    QVector<int> ends;
+    for (int node: upperRow) {
+        int start = ends.size();
+        for (int child: layered.lower[node]) {
+            ends << position[child];
+        }
+        std::sort(ends.begin() + start, ends.end());
+    }
+
+    // Count the pairs that are out of order.
+    const int size = lowerRow.size();
+    QVector<int> tree(size + 1, 0);
+    qint64 crossings = 0;
+
+    for (int i = 0; i < ends.size(); ++i) {
+        // Count the ends already added that lie to the right.
+        int lessOrEqual = 0;
+        for (int j = ends[i] + 1; j > 0; j -= j & -j) {
+            lessOrEqual += tree[j];
+        }
+        crossings += i - lessOrEqual;
+
+        for (int j = ends[i] + 1; j <= size; j += j & -j) {
+            ++tree[j];
+        }
+    }
+
+    return crossings;
+}
+
+static qint64 totalCrossings(const LayeredGraph &layered, const QVector<QVector<int> > &order,
+                             QVector<int> &position)
+{
+    qint64 crossings = 0;
+    for (int row = 0; row + 1 < order.size(); ++row) {
+        crossings += countCrossings(layered, order[row], order[row + 1], position);
+    }
+    return crossings;
+}
+
+static void updatePositions(const QVector<int> &row, QVector<int> &position)
+{
+    for (int i = 0; i < row.size(); ++i) {
+        position[row[i]] = i;
+    }
+}
+
+///
+/// \brief sortByBarycenter Order a row by the average position of each node's
+/// neighbours in the fixed row. Nodes without neighbours keep their place.
+///
+static void sortByBarycenter(QVector<int> &row, const QVector<QVector<int> > &neighbours,
+                             QVector<int> &position, QVector<QPair<qreal, int> > &keys)
+{
+    keys.resize(row.size());
+
+    for (int i = 0; i < row.size(); ++i) {
+        int node = row[i];
+        const QVector<int> &fixed = neighbours[node];
+        qreal key = i;
+
+        if (!fixed.isEmpty()) {
+            qreal sum = 0;
+            for (int neighbour: fixed) {
+                sum += position[neighbour];
+            }
+            key = sum / fixed.size();
+        }
+
+        keys[i] = qMakePair(key, node);
+    }
+
+    std::stable_sort(keys.begin(), keys.end(), [](const QPair<qreal, int> &a, const QPair<qreal, int> &b) {
+        return a.first < b.first;
+    });
+
+    for (int i = 0; i < row.size(); ++i) {
+        row[i] = keys[i].second;
+    }
+    updatePositions(row, position);
+}
+
+///
+/// \brief runTrial Reduce crossings with alternating down and up sweeps, keeping the best order found.
+///
+static void runTrial(const LayeredGraph &layered, Trial &trial, const QAtomicInt *cancelled)
+{
+    QVector<int> position(layered.layer.size(), 0);
+    QVector<QPair<qreal, int> > keys;
+
+    // Shuffle the starting order, except in the first trial.
+    if (trial.seed != 0) {
+        std::mt19937 random(trial.seed);
+        for (QVector<int> &row: trial.order) {
+            std::shuffle(row.begin(), row.end(), random);
+        }
+    }
+
+    for (const QVector<int> &row: trial.order) {
+        updatePositions(row, position);
+    }
+
+    QVector<QVector<int> > order = trial.order;
+    trial.crossings = totalCrossings(layered, order, position);
+
+    for (int sweep = 0; sweep < sweepCount && trial.crossings > 0 && !isCancelled(cancelled); ++sweep) {
+        // Down: order each row by the row above.
+        for (int row = 1; row < order.size(); ++row) {
+            sortByBarycenter(order[row], layered.upper, position, keys);
+        }
+
+        // Up: order each row by the row below.
+        for (int row = order.size() - 2; row >= 0; --row) {
+            sortByBarycenter(order[row], layered.lower, position, keys);
+        }
+
+        qint64 crossings = totalCrossings(layered, order, position);
+        if (crossings < trial.crossings) {
+            trial.crossings = crossings;
+            trial.order = order;
+        }
+    }
+}
+
+///
+/// \brief placeRow Place a row as close as possible to the desired centers,
+/// keeping its order and spacing. This is isotonic regression, solved with
+/// the pool adjacent violators algorithm in O(n).
+///
+static void placeRow(const LayeredGraph &layered, const QVector<int> &row,
+                     const QVector<qreal> &desired, QVector<qreal> &center)
+{
+    const int size = row.size();
+    if (size == 0) {
+        return;
+    }
+
+    // Offset of each node when packed tightly.
+    QVector<qreal> offset(size);
+    offset[0] = 0;
+    for (int i = 1; i < size; ++i) {
+        qreal gap = (layered.width[row[i - 1]] + layered.width[row[i]]) / 2 + horizontalSpacing;
+        offset[i] = offset[i - 1] + gap;
+    }
+
+    // Merge blocks whose averages are out of order.
+    QVector<qreal> blockSum;
+    QVector<int> blockCount;
+
+    for (int i = 0; i < size; ++i) {
+        blockSum << desired[i] - offset[i];
+        blockCount << 1;
+
+        while (blockSum.size() > 1) {
+            int last = blockSum.size() - 1;
+            if (blockSum[last - 1] / blockCount[last - 1] <= blockSum[last] / blockCount[last]) {
+                break;
+            }
+            blockSum[last - 1] += blockSum[last];
+            blockCount[last - 1] += blockCount[last];
+            blockSum.removeLast();
+            blockCount.removeLast();
+        }
+    }
+
+    // Set the centers.
+    int i = 0;
+    for (int block = 0; block < blockSum.size(); ++block) {
+        qreal base = blockSum[block] / blockCount[block];
+        for (int j = 0; j < blockCount[block]; ++j, ++i) {
+            center[row[i]] = base + offset[i];
+        }
+    }
+}
+
+///
+/// \brief assignCoordinates Move each node towards the average of its
+/// neighbours, alternating downwards and upwards.
+///
+static QVector<qreal> assignCoordinates(const LayeredGraph &layered, const QVector<QVector<int> > &order)
+{
+    QVector<qreal> center(layered.layer.size(), 0);
+    QVector<qreal> desired;
+
+    // Start packed to the left.
+    for (const QVector<int> &row: order) {
+        qreal x = 0;
+        for (int node: row) {
+            center[node] = x + layered.width[node] / 2;
+            x += layered.width[node] + horizontalSpacing;
+        }
+    }
+
+    auto placeByNeighbours = [&](const QVector<int> &row, const QVector<QVector<int> > &neighbours) {
+        desired.resize(row.size());
+        for (int i = 0; i < row.size(); ++i) {
+            const QVector<int> &fixed = neighbours[row[i]];
+            if (fixed.isEmpty()) {
+                desired[i] = center[row[i]];
+                continue;
+            }
+            qreal sum = 0;
+            for (int neighbour: fixed) {
+                sum += center[neighbour];
+            }
+            desired[i] = sum / fixed.size();
+        }
+        placeRow(layered, row, desired, center);
+    };
+
+    for (int pass = 0; pass < coordinatePassCount; ++pass) {
+        for (int row = 1; row < order.size(); ++row) {
+            placeByNeighbours(order[row], layered.upper);
+        }
+        for (int row = order.size() - 2; row >= 0; --row) {
+            placeByNeighbours(order[row], layered.lower);
+        }
+    }
+
+    return center;
+}
+
+LayoutResult LayoutEngine::layout(const LayoutGraph &graph, const QAtomicInt *cancelled)
+{
+    LayoutResult result;
+    const int nodeCount = graph.nodes.size();
+    if (nodeCount == 0) {
+        return result;
+    }
+
+    // Collect the children of each node, without repeats or loops.
+    QVector<QVector<int> > children(nodeCount);
+    for (const auto &edge: graph.edges) {
+        if (edge.first != edge.second && !children[edge.first].contains(edge.second)) {
+            children[edge.first] << edge.second;
+        }
+    }
+
+    // Rank assignment.
+    QVector<QVector<bool> > removed;
+    QVector<int> layers;
+
+    if (graph.ranks.size() == nodeCount) {
+        result.cycleEdges = useRanks(graph.ranks, children, removed, layers);
+    }
+    else {
+        result.cycleEdges = removeCycles(nodeCount, children, removed);
+        layers = assignLayers(children, removed);
+    }
+    LayeredGraph layered = buildLayeredGraph(graph, layers, children, removed);
+
+    // Crossing reduction. The same trials are run on any machine, spread over
+    // the cores there are.
+    QVector<QVector<int> > order = initialOrder(layered);
+
+    QVector<Trial> trials(trialCount);
+    for (int i = 0; i < trialCount; ++i) {
+        trials[i].seed = i;
+        trials[i].order = order;
+        trials[i].crossings = 0;
+    }
+
+    QtConcurrent::blockingMap(trials, [&layered, cancelled](Trial &trial) {
+        runTrial(layered, trial, cancelled);
+    });
+
+    if (isCancelled(cancelled)) {
+        return LayoutResult();
+    }
+
+    // Keep the best. Ties go to the earliest trial, so the result does not
+    // depend on which trial finished first.
+    const Trial *best = &trials[0];
+    for (const Trial &trial: trials) {
+        if (trial.crossings < best->crossings) {
+            best = &trial;
+        }
+    }
+    result.crossings = best->crossings;
+
+    // Coordinate assignment.
+    QVector<qreal> center = assignCoordinates(layered, best->order);
+
+    qreal minLeft = center[0] - layered.width[0] / 2;
+    for (int node = 0; node < center.size(); ++node) {
+        minLeft = qMin(minLeft, center[node] - layered.width[node] / 2);
+    }
+
+    // Set the positions of the real nodes.
+    result.positions.resize(nodeCount);
+    result.layers = layers;
+
+    for (int node = 0; node < nodeCount; ++node) {
+        const LayoutGraph::Node &box = graph.nodes[node];
+        qreal left = center[node] - box.width / 2 - minLeft + leftMargin;
+        qreal top = topMargin + layers[node] * rowSpacing;
+        result.positions[node] = QPointF(left + box.anchor, top);
+    }
+
+    return result;
+}
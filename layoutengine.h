@@ -0,0 +1,66 @@
+#ifndef LAYOUTENGINE_H
+#define LAYOUTENGINE_H
+
+#include <QAtomicInt>
+#include <QPair>
+#include <QPointF>
+#include <QVector>
+
+/**
+ * @brief The LayoutGraph struct is the input to the layout engine: the boxes
+ * to place and the parent to child links between them. It holds no scene
+ * items, so it can be laid out on a worker thread.
+ */
+struct LayoutGraph
+{
+    struct Node
+    {
+        qreal width; ///< The width of the box, including the spouse.
+        qreal height;
+        qreal anchor; ///< The x offset of the item position from the left of the box.
+    };
+
+    QVector<Node> nodes;
+    QVector<QPair<int, int> > edges; ///< Parent node to child node.
+    QVector<int> ranks; ///< The generations below each node, if already known. Otherwise they are worked out.
+};
+
+/**
+ * @brief The LayoutResult struct holds the positions chosen by the layout engine.
+ */
+struct LayoutResult
+{
+    QVector<QPointF> positions; ///< The item position of each node.
+    QVector<int> layers; ///< The row of each node, counted from the top.
+    qint64 crossings = 0; ///< The number of links that cross.
+    int cycleEdges = 0; ///< The number of links ignored to break parent/child cycles.
+};
+
+/**
+ * @brief The LayoutEngine class places a family tree in layers.
+ *
+ * It works in three stages:
+ * 1. Rank assignment puts each node one row above its lowest child.
+ * 2. Crossing reduction orders each row by the barycenter of its neighbours.
+ *    Several differently seeded trials run in parallel, and the order with
+ *    the fewest crossings wins.
+ * 3. Coordinate assignment moves each node towards its neighbours, keeping the
+ *    order of the row and the spacing between boxes.
+ *
+ * Links that span several rows are routed through invisible nodes. Each pass
+ * costs O((V + E) log V).
+ */
+class LayoutEngine
+{
+public:
+    /**
+     * @brief layout Lay out the graph.
+     * Safe to call from a worker thread.
+     * @param graph The nodes and links.
+     * @param cancelled If given, the layout stops early when this is set to non-zero.
+     * @return The positions, or no positions if cancelled.
+     */
+    static LayoutResult layout(const LayoutGraph &graph, const QAtomicInt *cancelled = nullptr);
+};
+
+#endif // LAYOUTENGINE_H
@@ -16,15 +16,33 @@
  */
 
 //#include "mainwindow.h"
+#include "diagrambinary.h"
 #include "gui/mainform.h"
 
 #include <QApplication>
+#include <QTextStream>
+#include <QTimer>
 
 int main(int argv, char *args[])
 {
     Q_INIT_RESOURCE(genealogymaker);
 
     QApplication app(argv, args);
+
+    // Convert between the XML and binary formats without showing the window:
+    // genealogymaker --convert input.xml output.gmb
+    auto argList = app.arguments();
+    if (argList.size() == 4 && argList[1] == "--convert")
+    {
+        QString errorString;
+        if (!DiagramBinary::convert(argList[2], argList[3], &errorString))
+        {
+            QTextStream(stderr) << errorString << endl;
+            return 1;
+        }
+        return 0;
+    }
+
 //    MainWindow mainWindow;
     MainForm mainWindow;
 //    mainWindow.setGeometry(100, 100, 800, 500);
@@ -32,11 +50,13 @@ int main(int argv, char *args[])
     mainWindow.show();
 
     // Load diagram if passed as parameter.
-    auto argList = app.arguments();
+    // This is done once the event loop runs, so that the window appears first.
     if (argList.size() >= 2)
     {
         QString fileName = argList[1];
-        mainWindow.open(fileName);
+        QTimer::singleShot(0, &mainWindow, [&mainWindow, fileName]() {
+            mainWindow.open(fileName);
+        });
     }
 
     return app.exec();
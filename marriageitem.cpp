@@ -1,10 +1,13 @@
 #include "marriageitem.h"
 
 #include "diagramitem.h"
+#include "diagramscene.h"
+#include "rendercache.h"
 
 #include <QGraphicsScene>
 #include <QMenu>
 #include <QGraphicsSceneContextMenuEvent>
+#include <QPainter>
 
 QMenu *MarriageItem::m_contextMenu = nullptr;
 MarriageItem *MarriageItem::m_selectedMarriage = nullptr;
@@ -59,6 +62,58 @@ void MarriageItem::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
     m_contextMenu->exec(event->screenPos());
 }
 
+void MarriageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    // The ring is too small to see when zoomed far out.
+    if (DiagramItem::detail(option, painter) == DiagramItem::LowDetail) {
+        return;
+    }
+
+    // The key is kept until the selection changes, since paint is called often.
+    if (m_renderKey.isEmpty()) {
+        QRectF ring = rect();
+        m_renderKey = QString("ring|%1|%2|%3|%4|%5|%6|%7")
+                .arg(isSelected() ? 1 : 0)
+                .arg(ring.width())
+                .arg(ring.height())
+                .arg(pen().color().rgba())
+                .arg(pen().widthF())
+                .arg(brush().color().rgba())
+                .arg(brush().style());
+    }
+
+    auto paintRing = [&](QPainter *cachePainter) {
+        QGraphicsEllipseItem::paint(cachePainter, option, widget);
+    };
+
+    if (!RenderCache::draw(painter, m_renderKey, boundingRect(), paintRing)) {
+        paintRing(painter);
+    }
+}
+
+QVariant MarriageItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    if (change == QGraphicsItem::ItemSelectedHasChanged) {
+        m_renderKey.clear();
+    }
+
+    // Keep the marriage registry of the scene up to date.
+    if (change == QGraphicsItem::ItemSceneChange) {
+        auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+        if (diagramScene) {
+            diagramScene->unregisterMarriage(this);
+        }
+    }
+    else if (change == QGraphicsItem::ItemSceneHasChanged) {
+        auto diagramScene = dynamic_cast<DiagramScene *>(scene());
+        if (diagramScene) {
+            diagramScene->registerMarriage(this);
+        }
+    }
+
+    return QGraphicsEllipseItem::itemChange(change, value);
+}
+
 QString MarriageItem::getPlace() const
 {
     return m_place;
@@ -31,6 +31,8 @@ public:
 
 protected:
     void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
 
 private:
     DiagramItem *m_personLeft;
@@ -39,6 +41,8 @@ private:
     QDate m_date;
     QString m_place;
 
+    QString m_renderKey; ///< The appearance, as found in the render cache.
+
     static QMenu *m_contextMenu;
     static MarriageItem *m_selectedMarriage;
 };
@@ -18,6 +18,8 @@ MyGraphicsView::MyGraphicsView(DiagramScene *scene, QWidget *owner) :
     m_diagramScene = scene;
     m_minScale = 0.10;  // 10%
     m_maxScale = 2.50;  // 250%
+
+    connect(this, &QGraphicsView::rubberBandChanged, this, &MyGraphicsView::onRubberBandChanged);
 }
 
 void MyGraphicsView::onMouseReleased()
@@ -28,6 +30,20 @@ void MyGraphicsView::onMouseReleased()
     setDragMode(QGraphicsView::DragMode::NoDrag);
 }
 
+void MyGraphicsView::onRubberBandChanged(const QRect &rubberBandRect)
+{
+    // The band ended.
+    if (rubberBandRect.isNull()) {
+        return;
+    }
+
+    // Show the batched arrows under the band, before the view selects the area.
+    QPainterPath area;
+    area.addPolygon(mapToScene(rubberBandRect));
+    area.closeSubpath();
+    m_diagramScene->showArrowsIn(area);
+}
+
 bool MyGraphicsView::eventFilter(QObject *object, QEvent *event) {
 
     Q_UNUSED(object);
@@ -14,6 +14,9 @@ public:
 public slots:
     void onMouseReleased();
 
+private slots:
+    void onRubberBandChanged(const QRect &rubberBandRect);
+
 private:
     bool eventFilter(QObject* object, QEvent* event) override;
     void wheelEvent(QWheelEvent *event) override;
@@ -0,0 +1,215 @@
+#include "nameindex.h"
+#include "diagramitem.h"
+
+#include <algorithm>
+#include <iterator>
+
+// The longest piece of a name that is listed.
+static const int maxPieceLength = 3;
+
+///
+/// \brief pack Pack up to three characters into a number.
+///
+static quint64 pack(const QChar *chars, int length)
+{
+    quint64 key = length;
+    for (int i = 0; i < length; ++i) {
+        key = (key << 16) | chars[i].unicode();
+    }
+    return key;
+}
+
+NameIndex::NameIndex()
+{
+
+}
+
+void NameIndex::insert(DiagramItem *person)
+{
+    QString folded = fold(person->name());
+
+    // Check if already listed.
+    auto existing = m_entryOf.constFind(person);
+    if (existing != m_entryOf.constEnd()) {
+        if (m_entries[existing.value()].folded == folded) {
+            return;
+        }
+        remove(person);
+    }
+
+    // Reuse a free entry if possible.
+    int entry;
+    if (!m_freeEntries.isEmpty()) {
+        entry = m_freeEntries.takeLast();
+    }
+    else {
+        entry = m_entries.size();
+        m_entries.resize(entry + 1);
+    }
+
+    m_entries[entry].person = person;
+    m_entries[entry].folded = folded;
+    m_entryOf.insert(person, entry);
+
+    for (quint64 piece: pieces(folded, 1, maxPieceLength)) {
+        addPosting(piece, entry);
+    }
+}
+
+void NameIndex::remove(DiagramItem *person)
+{
+    int entry = m_entryOf.value(person, -1);
+    if (entry == -1) {
+        return;
+    }
+
+    for (quint64 piece: pieces(m_entries[entry].folded, 1, maxPieceLength)) {
+        removePosting(piece, entry);
+    }
+
+    m_entries[entry].person = nullptr;
+    m_entries[entry].folded.clear();
+    m_entryOf.remove(person);
+    m_freeEntries << entry;
+}
+
+void NameIndex::clear()
+{
+    m_entries.clear();
+    m_freeEntries.clear();
+    m_entryOf.clear();
+    m_postings.clear();
+}
+
+QVector<DiagramItem *> NameIndex::find(const QString &text) const
+{
+    QVector<DiagramItem *> result;
+    QString query = fold(text);
+
+    if (query.isEmpty()) {
+        return result;
+    }
+
+    QVector<int> matches;
+
+    if (query.size() <= maxPieceLength) {
+        // Short text is listed as it is.
+        matches = m_postings.value(pack(query.constData(), query.size()));
+    }
+    else {
+        // Get the lists for each piece, shortest first.
+        QVector<const QVector<int> *> lists;
+        for (quint64 piece: pieces(query, maxPieceLength, maxPieceLength)) {
+            auto found = m_postings.constFind(piece);
+            if (found == m_postings.constEnd()) {
+                return result;
+            }
+            lists << &found.value();
+        }
+
+        std::sort(lists.begin(), lists.end(), [](const QVector<int> *a, const QVector<int> *b) {
+            return a->size() < b->size();
+        });
+
+        // Keep the entries in every list.
+        matches = *lists.first();
+        QVector<int> common;
+        for (int i = 1; i < lists.size() && !matches.isEmpty(); ++i) {
+            common.clear();
+            std::set_intersection(matches.constBegin(), matches.constEnd(),
+                                  lists[i]->constBegin(), lists[i]->constEnd(),
+                                  std::back_inserter(common));
+            matches.swap(common);
+        }
+
+        // The pieces may be in a different order, so check the whole text.
+        matches.erase(std::remove_if(matches.begin(), matches.end(), [this, &query](int entry) {
+            return !m_entries[entry].folded.contains(query);
+        }), matches.end());
+    }
+
+    result.reserve(matches.size());
+    for (int entry: matches) {
+        result << m_entries[entry].person;
+    }
+
+    return result;
+}
+
+int NameIndex::size() const
+{
+    return m_entryOf.size();
+}
+
+QString NameIndex::fold(const QString &text)
+{
+    // Split accented letters into the letter and the accent, and drop the accent.
+    QString decomposed = text.normalized(QString::NormalizationForm_KD);
+    QString folded;
+    folded.reserve(decomposed.size());
+
+    for (QChar c: decomposed) {
+        if (c.category() != QChar::Mark_NonSpacing) {
+            folded += c;
+        }
+    }
+
+    folded = folded.toCaseFolded();
+
+    // Letters that do not decompose.
+    folded.replace(QChar(0x00DF), QLatin1String("ss")); // Sharp s.
+    folded.replace(QChar(0x00E6), QLatin1String("ae"));
+    folded.replace(QChar(0x0153), QLatin1String("oe"));
+    folded.replace(QChar(0x00F8), QLatin1Char('o'));
+    folded.replace(QChar(0x0142), QLatin1Char('l'));
+    folded.replace(QChar(0x0111), QLatin1Char('d'));
+
+    return folded;
+}
+
+QVector<quint64> NameIndex::pieces(const QString &folded, int minLength, int maxLength)
+{
+    QVector<quint64> result;
+
+    for (int length = minLength; length <= maxLength; ++length) {
+        for (int i = 0; i + length <= folded.size(); ++i) {
+            result << pack(folded.constData() + i, length);
+        }
+    }
+
+    // List each piece once.
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
+void NameIndex::addPosting(quint64 piece, int entry)
+{
+    QVector<int> &list = m_postings[piece];
+
+    if (list.isEmpty() || list.last() < entry) {
+        list << entry;
+    }
+    else {
+        list.insert(std::lower_bound(list.begin(), list.end(), entry), entry);
+    }
+}
+
+void NameIndex::removePosting(quint64 piece, int entry)
+{
+    auto found = m_postings.find(piece);
+    if (found == m_postings.end()) {
+        return;
+    }
+
+    QVector<int> &list = found.value();
+    auto position = std::lower_bound(list.begin(), list.end(), entry);
+    if (position != list.end() && *position == entry) {
+        list.erase(position);
+    }
+
+    if (list.isEmpty()) {
+        m_postings.erase(found);
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+class DiagramItem;
+
+/**
+ * @brief The NameIndex class finds persons whose name contains some text,
+ * ignoring case and accents, without checking every person.
+ *
+ * Each name is folded to lower case without accents, and every piece of one,
+ * two and three letters is listed with the persons that contain it. A search
+ * for one or two letters reads a single list. A longer search intersects the
+ * lists of its three-letter pieces, starting with the shortest, then checks
+ * the few persons left.
+ */
+class NameIndex
+{
+public:
+    NameIndex();
+
+    /**
+     * @brief insert Add a person, or update them if their name changed.
+     * @param person The person.
+     */
+    void insert(DiagramItem *person);
+
+    /**
+     * @brief remove Remove a person.
+     * @param person The person.
+     */
+    void remove(DiagramItem *person);
+
+    /**
+     * @brief clear Remove all persons.
+     */
+    void clear();
+
+    /**
+     * @brief find Find the persons whose name contains the text.
+     * @param text The search text.
+     * @return The persons, in a fixed order.
+     */
+    QVector<DiagramItem *> find(const QString &text) const;
+
+    /**
+     * @brief size Get the number of persons in the index.
+     */
+    int size() const;
+
+    /**
+     * @brief fold Convert text to the form used for matching: lower case, with accents removed.
+     * @param text The text.
+     * @return The folded text.
+     */
+    static QString fold(const QString &text);
+
+private:
+    struct Entry
+    {
+        DiagramItem *person;
+        QString folded;
+    };
+
+    static QVector<quint64> pieces(const QString &folded, int minLength, int maxLength);
+    void addPosting(quint64 piece, int entry);
+    void removePosting(quint64 piece, int entry);
+
+    QVector<Entry> m_entries;
+    QVector<int> m_freeEntries;
+    QHash<DiagramItem *, int> m_entryOf;
+    QHash<quint64, QVector<int> > m_postings; ///< Sorted entry numbers for each piece of a name.
+};
+
+#endif // NAMEINDEX_H
@@ -0,0 +1,937 @@
+#include "phonetic.h"
+#include "nameindex.h"
+
+#include <QVector>
+
+#include <initializer_list>
+
+QString Phonetic::letters(const QString &name)
+{
+    QString folded = NameIndex::fold(name).toUpper();
+    QString result;
+    result.reserve(folded.size());
+
+    for (QChar c: folded) {
+        if (c >= QLatin1Char('A') && c <= QLatin1Char('Z')) {
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+//
+// Soundex.
+//
+
+static char soundexDigit(char c)
+{
+    switch (c) {
+    case 'B': case 'F': case 'P': case 'V':
+        return '1';
+    case 'C': case 'G': case 'J': case 'K': case 'Q': case 'S': case 'X': case 'Z':
+        return '2';
+    case 'D': case 'T':
+        return '3';
+    case 'L':
+        return '4';
+    case 'M': case 'N':
+        return '5';
+    case 'R':
+        return '6';
+    case 'H': case 'W':
+        return '-'; // Does not separate letters with the same code.
+    default:
+        return '0'; // Vowels separate letters with the same code.
+    }
+}
+
+QString Phonetic::soundex(const QString &name)
+{
+    QByteArray word = letters(name).toLatin1();
+    if (word.isEmpty()) {
+        return QString();
+    }
+
+    QByteArray code;
+    code += word[0];
+    char previous = soundexDigit(word[0]);
+
+    for (int i = 1; i < word.size() && code.size() < 4; ++i) {
+        char digit = soundexDigit(word[i]);
+        if (digit == '-') {
+            continue;
+        }
+        if (digit != '0' && digit != previous) {
+            code += digit;
+        }
+        previous = digit;
+    }
+
+    while (code.size() < 4) {
+        code += '0';
+    }
+
+    return QString::fromLatin1(code);
+}
+
+//
+// Daitch-Mokotoff Soundex.
+//
+
+/**
+ * @brief The MokotoffRule struct is a row of the Daitch-Mokotoff coding chart.
+ * Each column holds the code, or two codes separated by "|" when the letters
+ * can sound two ways.
+ */
+struct MokotoffRule
+{
+    const char *letters;
+    const char *atStart;
+    const char *beforeVowel;
+    const char *otherwise;
+};
+
+static const MokotoffRule mokotoffRules[] = {
+    { "AI", "0", "1", "" }, { "AJ", "0", "1", "" }, { "AY", "0", "1", "" },
+    { "AU", "0", "7", "" },
+    { "A", "0", "", "" },
+    { "B", "7", "7", "7" },
+    { "CHS", "5", "54", "54" },
+    { "CH", "5|4", "5|4", "5|4" },
+    { "CK", "5|45", "5|45", "5|45" },
+    { "CZ", "4", "4", "4" }, { "CS", "4", "4", "4" }, { "CSZ", "4", "4", "4" }, { "CZS", "4", "4", "4" },
+    { "C", "5|4", "5|4", "5|4" },
+    { "DRZ", "4", "4", "4" }, { "DRS", "4", "4", "4" },
+    { "DS", "4", "4", "4" }, { "DSH", "4", "4", "4" }, { "DSZ", "4", "4", "4" },
+    { "DZ", "4", "4", "4" }, { "DZH", "4", "4", "4" }, { "DZS", "4", "4", "4" },
+    { "D", "3", "3", "3" }, { "DT", "3", "3", "3" },
+    { "EI", "0", "1", "" }, { "EJ", "0", "1", "" }, { "EY", "0", "1", "" },
+    { "EU", "1", "1", "" },
+    { "E", "0", "", "" },
+    { "FB", "7", "7", "7" },
+    { "F", "7", "7", "7" },
+    { "G", "5", "5", "5" },
+    { "H", "5", "5", "" },
+    { "IA", "1", "", "" }, { "IE", "1", "", "" }, { "IO", "1", "", "" }, { "IU", "1", "", "" },
+    { "I", "0", "", "" },
+    { "J", "1|4", "1|4", "1|4" },
+    { "KS", "5", "54", "54" },
+    { "KH", "5", "5", "5" },
+    { "K", "5", "5", "5" },
+    { "L", "8", "8", "8" },
+    { "MN", "66", "66", "66" },
+    { "M", "6", "6", "6" },
+    { "NM", "66", "66", "66" },
+    { "N", "6", "6", "6" },
+    { "OI", "0", "1", "" }, { "OJ", "0", "1", "" }, { "OY", "0", "1", "" },
+    { "O", "0", "", "" },
+    { "P", "7", "7", "7" }, { "PF", "7", "7", "7" }, { "PH", "7", "7", "7" },
+    { "Q", "5", "5", "5" },
+    { "RZ", "94|4", "94|4", "94|4" }, { "RS", "94|4", "94|4", "94|4" },
+    { "R", "9", "9", "9" },
+    { "SCHTSCH", "2", "4", "4" }, { "SCHTSH", "2", "4", "4" }, { "SCHTCH", "2", "4", "4" },
+    { "SCH", "4", "4", "4" },
+    { "SHTCH", "2", "4", "4" }, { "SHCH", "2", "4", "4" }, { "SHTSH", "2", "4", "4" },
+    { "SHT", "2", "43", "43" }, { "SCHT", "2", "43", "43" }, { "SCHD", "2", "43", "43" },
+    { "SH", "4", "4", "4" },
+    { "STCH", "2", "4", "4" }, { "STSCH", "2", "4", "4" }, { "SC", "2", "4", "4" },
+    { "STRZ", "2", "4", "4" }, { "STRS", "2", "4", "4" }, { "STSH", "2", "4", "4" },
+    { "ST", "2", "43", "43" },
+    { "SZCZ", "2", "4", "4" }, { "SZCS", "2", "4", "4" },
+    { "SZT", "2", "43", "43" }, { "SHD", "2", "43", "43" }, { "SZD", "2", "43", "43" }, { "SD", "2", "43", "43" },
+    { "SZ", "4", "4", "4" },
+    { "S", "4", "4", "4" },
+    { "TCH", "4", "4", "4" }, { "TTCH", "4", "4", "4" }, { "TTSCH", "4", "4", "4" },
+    { "TH", "3", "3", "3" },
+    { "TRZ", "4", "4", "4" }, { "TRS", "4", "4", "4" },
+    { "TSCH", "4", "4", "4" }, { "TSH", "4", "4", "4" },
+    { "TS", "4", "4", "4" }, { "TTS", "4", "4", "4" }, { "TTSZ", "4", "4", "4" }, { "TC", "4", "4", "4" },
+    { "TZ", "4", "4", "4" }, { "TTZ", "4", "4", "4" }, { "TZS", "4", "4", "4" }, { "TSZ", "4", "4", "4" },
+    { "T", "3", "3", "3" },
+    { "UI", "0", "1", "" }, { "UJ", "0", "1", "" }, { "UY", "0", "1", "" },
+    { "UE", "0", "", "" },
+    { "U", "0", "", "" },
+    { "V", "7", "7", "7" },
+    { "W", "7", "7", "7" },
+    { "X", "5", "54", "54" },
+    { "Y", "1", "", "" },
+    { "ZDZ", "2", "4", "4" }, { "ZDZH", "2", "4", "4" }, { "ZHDZH", "2", "4", "4" },
+    { "ZD", "2", "43", "43" }, { "ZHD", "2", "43", "43" },
+    { "ZH", "4", "4", "4" }, { "ZS", "4", "4", "4" }, { "ZSCH", "4", "4", "4" }, { "ZSH", "4", "4", "4" },
+    { "Z", "4", "4", "4" }
+};
+
+static bool isMokotoffVowel(char c)
+{
+    return c == 'A' || c == 'E' || c == 'I' || c == 'O' || c == 'U' || c == 'J' || c == 'Y';
+}
+
+QStringList Phonetic::daitchMokotoff(const QString &name)
+{
+    QByteArray word = letters(name).toLatin1();
+    if (word.isEmpty()) {
+        return QStringList();
+    }
+
+    // Each way of reading the name, with the last code added.
+    struct Branch
+    {
+        QString code;
+        QString lastCode;
+    };
+    QVector<Branch> branches(1);
+
+    int position = 0;
+    while (position < word.size()) {
+        // Find the longest rule that matches here.
+        const MokotoffRule *match = nullptr;
+        int matchLength = 0;
+        for (const MokotoffRule &rule: mokotoffRules) {
+            int length = int(qstrlen(rule.letters));
+            if (length > matchLength && word.mid(position, length) == rule.letters) {
+                match = &rule;
+                matchLength = length;
+            }
+        }
+
+        int next = position + matchLength;
+        const char *column;
+        if (position == 0) {
+            column = match->atStart;
+        }
+        else if (next < word.size() && isMokotoffVowel(word[next])) {
+            column = match->beforeVowel;
+        }
+        else {
+            column = match->otherwise;
+        }
+
+        // Follow each way the letters can sound.
+        QStringList alternatives = QString::fromLatin1(column).split('|');
+        QVector<Branch> nextBranches;
+
+        for (const Branch &branch: branches) {
+            for (const QString &alternative: alternatives) {
+                Branch nextBranch = branch;
+                if (alternative != branch.lastCode) {
+                    nextBranch.code += alternative;
+                }
+                nextBranch.lastCode = alternative;
+
+                bool duplicate = false;
+                for (const Branch &other: nextBranches) {
+                    duplicate = duplicate || (other.code == nextBranch.code && other.lastCode == nextBranch.lastCode);
+                }
+                if (!duplicate) {
+                    nextBranches << nextBranch;
+                }
+            }
+        }
+
+        branches = nextBranches;
+        position = next;
+    }
+
+    // Make each code six digits.
+    QStringList codes;
+    for (const Branch &branch: branches) {
+        QString code = branch.code.left(6).leftJustified(6, QLatin1Char('0'));
+        if (!codes.contains(code)) {
+            codes << code;
+        }
+    }
+
+    return codes;
+}
+
+//
+// Double Metaphone, after the algorithm published by Lawrence Philips.
+//
+
+static const int metaphoneLength = 4;
+
+/**
+ * @brief The Metaphone class holds the state while encoding one word.
+ */
+class Metaphone
+{
+public:
+    explicit Metaphone(const QByteArray &word) :
+        m_word(word),
+        m_length(word.size()),
+        m_last(word.size() - 1)
+    {
+        m_slavoGermanic = word.contains('W') || word.contains('K') || word.contains("CZ");
+    }
+
+    void encode();
+
+    QByteArray primary;
+    QByteArray secondary;
+
+private:
+    char at(int i) const
+    {
+        return (i < 0 || i >= m_length) ? '\0' : m_word[i];
+    }
+
+    bool isVowel(int i) const
+    {
+        char c = at(i);
+        return c == 'A' || c == 'E' || c == 'I' || c == 'O' || c == 'U' || c == 'Y';
+    }
+
+    bool stringAt(int start, int length, std::initializer_list<const char *> list) const
+    {
+        if (start < 0 || start + length > m_length) {
+            return false;
+        }
+        for (const char *s: list) {
+            if (qstrncmp(m_word.constData() + start, s, uint(length)) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool atEnd(int i) const
+    {
+        return i >= m_length;
+    }
+
+    void add(const char *main)
+    {
+        primary += main;
+        secondary += main;
+    }
+
+    void add(const char *main, const char *alternate)
+    {
+        primary += main;
+        secondary += alternate;
+    }
+
+    int encodeC(int current);
+    int encodeG(int current);
+    int encodeS(int current);
+
+    QByteArray m_word;
+    int m_length;
+    int m_last;
+    bool m_slavoGermanic;
+};
+
+void Metaphone::encode()
+{
+    int current = 0;
+
+    // Skip these when at the start of the word.
+    if (stringAt(0, 2, {"GN", "KN", "PN", "WR", "PS"})) {
+        current += 1;
+    }
+
+    // An initial X is pronounced Z, e.g. "Xavier".
+    if (at(0) == 'X') {
+        add("S");
+        current += 1;
+    }
+
+    while ((primary.size() < metaphoneLength || secondary.size() < metaphoneLength) && current < m_length) {
+        switch (at(current)) {
+        case 'A': case 'E': case 'I': case 'O': case 'U': case 'Y':
+            // Only an initial vowel is coded.
+            if (current == 0) {
+                add("A");
+            }
+            current += 1;
+            break;
+
+        case 'B':
+            add("P");
+            current += (at(current + 1) == 'B') ? 2 : 1;
+            break;
+
+        case 'C':
+            current = encodeC(current);
+            break;
+
+        case 'D':
+            if (stringAt(current, 2, {"DG"})) {
+                if (stringAt(current + 2, 1, {"I", "E", "Y"})) {
+                    // E.g. "edge".
+                    add("J");
+                    current += 3;
+                }
+                else {
+                    // E.g. "Edgar".
+                    add("TK");
+                    current += 2;
+                }
+            }
+            else if (stringAt(current, 2, {"DT", "DD"})) {
+                add("T");
+                current += 2;
+            }
+            else {
+                add("T");
+                current += 1;
+            }
+            break;
+
+        case 'F':
+            add("F");
+            current += (at(current + 1) == 'F') ? 2 : 1;
+            break;
+
+        case 'G':
+            current = encodeG(current);
+            break;
+
+        case 'H':
+            // Only keep if first and before a vowel, or between two vowels.
+            if ((current == 0 || isVowel(current - 1)) && isVowel(current + 1)) {
+                add("H");
+                current += 2;
+            }
+            else {
+                current += 1;
+            }
+            break;
+
+        case 'J':
+            if (stringAt(current, 4, {"JOSE"})) {
+                // Spanish, e.g. "Jose".
+                if (current == 0 && atEnd(current + 4)) {
+                    add("H");
+                }
+                else {
+                    add("J", "H");
+                }
+                current += 1;
+                break;
+            }
+
+            if (current == 0) {
+                // E.g. "Yankelovich", "Jankelowicz".
+                add("J", "A");
+            }
+            else if (isVowel(current - 1) && !m_slavoGermanic && (at(current + 1) == 'A' || at(current + 1) == 'O')) {
+                // Spanish, e.g. "bajador".
+                add("J", "H");
+            }
+            else if (current == m_last) {
+                add("J", "");
+            }
+            else if (!stringAt(current + 1, 1, {"L", "T", "K", "S", "N", "M", "B", "Z"})
+                     && !stringAt(current - 1, 1, {"S", "K", "L"})) {
+                add("J");
+            }
+
+            current += (at(current + 1) == 'J') ? 2 : 1;
+            break;
+
+        case 'K':
+            add("K");
+            current += (at(current + 1) == 'K') ? 2 : 1;
+            break;
+
+        case 'L':
+            if (at(current + 1) == 'L') {
+                // Spanish, e.g. "Cabrillo", "Gallegos".
+                if ((current == m_length - 3 && stringAt(current - 1, 4, {"ILLO", "ILLA", "ALLE"}))
+                        || ((stringAt(m_last - 1, 2, {"AS", "OS"}) || stringAt(m_last, 1, {"A", "O"}))
+                            && stringAt(current - 1, 4, {"ALLE"}))) {
+                    add("L", "");
+                    current += 2;
+                    break;
+                }
+                current += 2;
+            }
+            else {
+                current += 1;
+            }
+            add("L");
+            break;
+
+        case 'M':
+            if ((stringAt(current - 1, 3, {"UMB"}) && (current + 1 == m_last || stringAt(current + 2, 2, {"ER"})))
+                    || at(current + 1) == 'M') {
+                // E.g. "dumb", "thumb".
+                current += 2;
+            }
+            else {
+                current += 1;
+            }
+            add("M");
+            break;
+
+        case 'N':
+            add("N");
+            current += (at(current + 1) == 'N') ? 2 : 1;
+            break;
+
+        case 'P':
+            if (at(current + 1) == 'H') {
+                add("F");
+                current += 2;
+                break;
+            }
+            // Also account for "Campbell" and "raspberry".
+            add("P");
+            current += stringAt(current + 1, 1, {"P", "B"}) ? 2 : 1;
+            break;
+
+        case 'Q':
+            add("K");
+            current += (at(current + 1) == 'Q') ? 2 : 1;
+            break;
+
+        case 'R':
+            // French, e.g. "Rogier", but not "Hochmeier".
+            if (current == m_last && !m_slavoGermanic && stringAt(current - 2, 2, {"IE"})
+                    && !stringAt(current - 4, 2, {"ME", "MA"})) {
+                add("", "R");
+            }
+            else {
+                add("R");
+            }
+            current += (at(current + 1) == 'R') ? 2 : 1;
+            break;
+
+        case 'S':
+            current = encodeS(current);
+            break;
+
+        case 'T':
+            if (stringAt(current, 4, {"TION"}) || stringAt(current, 3, {"TIA", "TCH"})) {
+                add("X");
+                current += 3;
+                break;
+            }
+
+            if (stringAt(current, 2, {"TH"}) || stringAt(current, 3, {"TTH"})) {
+                // Special case "Thomas", "Thames" or Germanic.
+                if (stringAt(current + 2, 2, {"OM", "AM"}) || stringAt(0, 3, {"SCH"})) {
+                    add("T");
+                }
+                else {
+                    add("0", "T");
+                }
+                current += 2;
+                break;
+            }
+
+            add("T");
+            current += stringAt(current + 1, 1, {"T", "D"}) ? 2 : 1;
+            break;
+
+        case 'V':
+            add("F");
+            current += (at(current + 1) == 'V') ? 2 : 1;
+            break;
+
+        case 'W':
+            // Can also be in the middle of a word.
+            if (stringAt(current, 2, {"WR"})) {
+                add("R");
+                current += 2;
+                break;
+            }
+
+            if (current == 0 && (isVowel(current + 1) || stringAt(current, 2, {"WH"}))) {
+                // "Wasserman" should match "Vasserman".
+                if (isVowel(current + 1)) {
+                    add("A", "F");
+                }
+                else {
+                    // "Uomo" should match "Womo".
+                    add("A");
+                }
+            }
+
+            // "Arnow" should match "Arnoff".
+            if ((current == m_last && isVowel(current - 1))
+                    || stringAt(current - 1, 5, {"EWSKI", "EWSKY", "OWSKI", "OWSKY"})
+                    || stringAt(0, 3, {"SCH"})) {
+                add("", "F");
+                current += 1;
+                break;
+            }
+
+            // Polish, e.g. "Filipowicz".
+            if (stringAt(current, 4, {"WICZ", "WITZ"})) {
+                add("TS", "FX");
+                current += 4;
+                break;
+            }
+
+            current += 1;
+            break;
+
+        case 'X':
+            // French, e.g. "breaux".
+            if (!(current == m_last && (stringAt(current - 3, 3, {"IAU", "EAU"}) || stringAt(current - 2, 2, {"AU", "OU"})))) {
+                add("KS");
+            }
+            current += stringAt(current + 1, 1, {"C", "X"}) ? 2 : 1;
+            break;
+
+        case 'Z':
+            if (at(current + 1) == 'H') {
+                // Chinese pinyin, e.g. "Zhao".
+                add("J");
+                current += 2;
+                break;
+            }
+            if (stringAt(current + 1, 2, {"ZO", "ZI", "ZA"}) || (m_slavoGermanic && current > 0 && at(current - 1) != 'T')) {
+                add("S", "TS");
+            }
+            else {
+                add("S");
+            }
+            current += (at(current + 1) == 'Z') ? 2 : 1;
+            break;
+
+        default:
+            current += 1;
+            break;
+        }
+    }
+
+    primary.truncate(metaphoneLength);
+    secondary.truncate(metaphoneLength);
+}
+
+int Metaphone::encodeC(int current)
+{
+    // Various Germanic, e.g. "Bacher", "Macher".
+    if (current > 1 && !isVowel(current - 2) && stringAt(current - 1, 3, {"ACH"})
+            && at(current + 2) != 'I'
+            && (at(current + 2) != 'E' || stringAt(current - 2, 6, {"BACHER", "MACHER"}))) {
+        add("K");
+        return current + 2;
+    }
+
+    // Special case "Caesar".
+    if (current == 0 && stringAt(current, 6, {"CAESAR"})) {
+        add("S");
+        return current + 2;
+    }
+
+    // Italian "Chianti".
+    if (stringAt(current, 4, {"CHIA"})) {
+        add("K");
+        return current + 2;
+    }
+
+    if (stringAt(current, 2, {"CH"})) {
+        // E.g. "Michael".
+        if (current > 0 && stringAt(current, 4, {"CHAE"})) {
+            add("K", "X");
+            return current + 2;
+        }
+
+        // Greek roots, e.g. "chemistry", "chorus".
+        if (current == 0
+                && (stringAt(current + 1, 5, {"HARAC", "HARIS"}) || stringAt(current + 1, 3, {"HOR", "HYM", "HIA", "HEM"}))
+                && !stringAt(0, 5, {"CHORE"})) {
+            add("K");
+            return current + 2;
+        }
+
+        // Germanic, Greek, or otherwise "ch" for the "kh" sound.
+        if (stringAt(0, 3, {"SCH"})
+                || stringAt(current - 2, 6, {"ORCHES", "ARCHIT", "ORCHID"})
+                || stringAt(current + 2, 1, {"T", "S"})
+                || ((stringAt(current - 1, 1, {"A", "O", "U", "E"}) || current == 0)
+                    && (stringAt(current + 2, 1, {"L", "R", "N", "M", "B", "H", "F", "V", "W"}) || atEnd(current + 2)))) {
+            add("K");
+        }
+        else if (current > 0) {
+            // E.g. "McHugh".
+            if (stringAt(0, 2, {"MC"})) {
+                add("K");
+            }
+            else {
+                add("X", "K");
+            }
+        }
+        else {
+            add("X");
+        }
+        return current + 2;
+    }
+
+    // E.g. "Czerny".
+    if (stringAt(current, 2, {"CZ"}) && !stringAt(current - 2, 4, {"WICZ"})) {
+        add("S", "X");
+        return current + 2;
+    }
+
+    // E.g. "focaccia".
+    if (stringAt(current + 1, 3, {"CIA"})) {
+        add("X");
+        return current + 3;
+    }
+
+    // Double C, but not if e.g. "McClellan".
+    if (stringAt(current, 2, {"CC"}) && !(current == 1 && at(0) == 'M')) {
+        // E.g. "Bellocchio", but not "bacchus".
+        if (stringAt(current + 2, 1, {"I", "E", "H"}) && !stringAt(current + 2, 2, {"HU"})) {
+            // E.g. "accident", "accede", "succeed".
+            if ((current == 1 && at(current - 1) == 'A') || stringAt(current - 1, 5, {"UCCEE", "UCCES"})) {
+                add("KS");
+            }
+            else {
+                // E.g. "bacci", "bertucci".
+                add("X");
+            }
+            return current + 3;
+        }
+
+        // Pierce's rule.
+        add("K");
+        return current + 2;
+    }
+
+    if (stringAt(current, 2, {"CK", "CG", "CQ"})) {
+        add("K");
+        return current + 2;
+    }
+
+    if (stringAt(current, 2, {"CI", "CE", "CY"})) {
+        // Italian or English.
+        if (stringAt(current, 3, {"CIO", "CIE", "CIA"})) {
+            add("S", "X");
+        }
+        else {
+            add("S");
+        }
+        return current + 2;
+    }
+
+    add("K");
+
+    if (stringAt(current + 1, 1, {"C", "K", "Q"}) && !stringAt(current + 1, 2, {"CE", "CI"})) {
+        return current + 2;
+    }
+    return current + 1;
+}
+
+int Metaphone::encodeG(int current)
+{
+    if (at(current + 1) == 'H') {
+        if (current > 0 && !isVowel(current - 1)) {
+            add("K");
+            return current + 2;
+        }
+
+        // E.g. "Ghislane", "Ghiradelli".
+        if (current == 0) {
+            if (at(current + 2) == 'I') {
+                add("J");
+            }
+            else {
+                add("K");
+            }
+            return current + 2;
+        }
+
+        // Parker's rule, e.g. "Hugh", "bough", "broughton".
+        if ((current > 1 && stringAt(current - 2, 1, {"B", "H", "D"}))
+                || (current > 2 && stringAt(current - 3, 1, {"B", "H", "D"}))
+                || (current > 3 && stringAt(current - 4, 1, {"B", "H"}))) {
+            return current + 2;
+        }
+
+        // E.g. "laugh", "McLaughlin", "cough", "tough".
+        if (current > 2 && at(current - 1) == 'U' && stringAt(current - 3, 1, {"C", "G", "L", "R", "T"})) {
+            add("F");
+        }
+        else if (current > 0 && at(current - 1) != 'I') {
+            add("K");
+        }
+        return current + 2;
+    }
+
+    if (at(current + 1) == 'N') {
+        if (current == 1 && isVowel(0) && !m_slavoGermanic) {
+            add("KN", "N");
+        }
+        else if (!stringAt(current + 2, 2, {"EY"}) && at(current + 1) != 'Y' && !m_slavoGermanic) {
+            // Not e.g. "Cagney".
+            add("N", "KN");
+        }
+        else {
+            add("KN");
+        }
+        return current + 2;
+    }
+
+    // E.g. "Tagliaro".
+    if (stringAt(current + 1, 2, {"LI"}) && !m_slavoGermanic) {
+        add("KL", "L");
+        return current + 2;
+    }
+
+    // E.g. "Gerald", "Gibson" at the start.
+    if (current == 0
+            && (at(current + 1) == 'Y'
+                || stringAt(current + 1, 2, {"ES", "EP", "EB", "EL", "EY", "IB", "IL", "IN", "IE", "EI", "ER"}))) {
+        add("K", "J");
+        return current + 2;
+    }
+
+    // E.g. "Hagerty", but not "danger", "ranger", "manger", "Regy", "Ogy".
+    if ((stringAt(current + 1, 2, {"ER"}) || at(current + 1) == 'Y')
+            && !stringAt(0, 6, {"DANGER", "RANGER", "MANGER"})
+            && !stringAt(current - 1, 1, {"E", "I"})
+            && !stringAt(current - 1, 3, {"RGY", "OGY"})) {
+        add("K", "J");
+        return current + 2;
+    }
+
+    // Italian, e.g. "Biaggi".
+    if (stringAt(current + 1, 1, {"E", "I", "Y"}) || stringAt(current - 1, 4, {"AGGI", "OGGI"})) {
+        // Germanic.
+        if (stringAt(0, 3, {"SCH"}) || stringAt(current + 1, 2, {"ET"})) {
+            add("K");
+        }
+        else if (stringAt(current + 1, 3, {"IER"}) && atEnd(current + 4)) {
+            add("J");
+        }
+        else {
+            add("J", "K");
+        }
+        return current + 2;
+    }
+
+    add("K");
+    return current + ((at(current + 1) == 'G') ? 2 : 1);
+}
+
+int Metaphone::encodeS(int current)
+{
+    // Special cases "island", "isle", "Carlisle", "Carlysle".
+    if (stringAt(current - 1, 3, {"ISL", "YSL"})) {
+        return current + 1;
+    }
+
+    // Special case "sugar".
+    if (current == 0 && stringAt(current, 5, {"SUGAR"})) {
+        add("X", "S");
+        return current + 1;
+    }
+
+    if (stringAt(current, 2, {"SH"})) {
+        // Germanic.
+        if (stringAt(current + 1, 4, {"HEIM", "HOEK", "HOLM", "HOLZ"})) {
+            add("S");
+        }
+        else {
+            add("X");
+        }
+        return current + 2;
+    }
+
+    // Italian and Armenian.
+    if (stringAt(current, 3, {"SIO", "SIA"}) || stringAt(current, 4, {"SIAN"})) {
+        if (!m_slavoGermanic) {
+            add("S", "X");
+        }
+        else {
+            add("S");
+        }
+        return current + 3;
+    }
+
+    // German and anglicisations, e.g. "Smith" should match "Schmidt".
+    if ((current == 0 && stringAt(current + 1, 1, {"M", "N", "L", "W"})) || stringAt(current + 1, 1, {"Z"})) {
+        add("S", "X");
+        return current + (stringAt(current + 1, 1, {"Z"}) ? 2 : 1);
+    }
+
+    if (stringAt(current, 2, {"SC"})) {
+        // Schlesinger's rule.
+        if (at(current + 2) == 'H') {
+            // Dutch origin, e.g. "school", "schooner".
+            if (stringAt(current + 3, 2, {"OO", "ER", "EN", "UY", "ED", "EM"})) {
+                // E.g. "Schermerhorn", "Schenker".
+                if (stringAt(current + 3, 2, {"ER", "EN"})) {
+                    add("X", "SK");
+                }
+                else {
+                    add("SK");
+                }
+                return current + 3;
+            }
+
+            if (current == 0 && !isVowel(3) && at(3) != 'W') {
+                add("X", "S");
+            }
+            else {
+                add("X");
+            }
+            return current + 3;
+        }
+
+        if (stringAt(current + 2, 1, {"I", "E", "Y"})) {
+            add("S");
+            return current + 3;
+        }
+
+        add("SK");
+        return current + 3;
+    }
+
+    // French, e.g. "resnais", "artois".
+    if (current == m_last && stringAt(current - 2, 2, {"AI", "OI"})) {
+        add("", "S");
+    }
+    else {
+        add("S");
+    }
+
+    return current + (stringAt(current + 1, 1, {"S", "Z"}) ? 2 : 1);
+}
+
+QStringList Phonetic::doubleMetaphone(const QString &name)
+{
+    QByteArray word = letters(name).toLatin1();
+    if (word.isEmpty()) {
+        return QStringList();
+    }
+
+    Metaphone metaphone(word);
+    metaphone.encode();
+
+    QStringList keys;
+    keys << QString::fromLatin1(metaphone.primary);
+    if (metaphone.secondary != metaphone.primary) {
+        keys << QString::fromLatin1(metaphone.secondary);
+    }
+
+    return keys;
+}
+
+int Phonetic::editDistance(const QString &a, const QString &b)
+{
+    QVector<int> previous(b.size() + 1);
+    QVector<int> current(b.size() + 1);
+
+    for (int j = 0; j <= b.size(); ++j) {
+        previous[j] = j;
+    }
+
+    for (int i = 1; i <= a.size(); ++i) {
+        current[0] = i;
+        for (int j = 1; j <= b.size(); ++j) {
+            int cost = (a[i - 1] == b[j - 1]) ? 0 : 1;
+            current[j] = qMin(qMin(previous[j] + 1, current[j - 1] + 1), previous[j - 1] + cost);
+        }
+        previous.swap(current);
+    }
+
+    return previous[b.size()];
+}
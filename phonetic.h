@@ -0,0 +1,54 @@
+#ifndef PHONETIC_H
+#define PHONETIC_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief The Phonetic class computes sound-alike keys for names, so that
+ * different spellings of the same name, e.g. Zijl, Zyl and Ziel, can be matched.
+ *
+ * Accents are ignored, and any character that is not a letter is skipped.
+ */
+class Phonetic
+{
+public:
+    /**
+     * @brief soundex Get the American Soundex code of a name, e.g. "R163" for "Robert".
+     * @param name The name.
+     * @return The four-character code, or an empty string if the name has no letters.
+     */
+    static QString soundex(const QString &name);
+
+    /**
+     * @brief daitchMokotoff Get the Daitch-Mokotoff Soundex codes of a name.
+     * Some letters can sound two ways, so a name can have several codes.
+     * @param name The name.
+     * @return The six-digit codes, or an empty list if the name has no letters.
+     */
+    static QStringList daitchMokotoff(const QString &name);
+
+    /**
+     * @brief doubleMetaphone Get the Double Metaphone keys of a name.
+     * @param name The name.
+     * @return The primary key, followed by the alternate key if it differs.
+     */
+    static QStringList doubleMetaphone(const QString &name);
+
+    /**
+     * @brief editDistance Get the Levenshtein distance between two words.
+     * @param a The first word.
+     * @param b The second word.
+     * @return The number of letters to insert, delete or change to turn one word into the other.
+     */
+    static int editDistance(const QString &a, const QString &b);
+
+    /**
+     * @brief letters Convert a name to upper-case letters A to Z, dropping accents and anything else.
+     * @param name The name.
+     * @return The letters.
+     */
+    static QString letters(const QString &name);
+};
+
+#endif // PHONETIC_H
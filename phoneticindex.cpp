@@ -0,0 +1,355 @@
+#include "phoneticindex.h"
+#include "diagramitem.h"
+#include "phonetic.h"
+
+#include <QRegularExpression>
+
+#include <algorithm>
+
+// Scores for each way a word can match.
+static const int exactScore = 100;
+static const int distanceStep = 25;
+static const int metaphoneScore = 70;
+static const int mokotoffScore = 60;
+static const int soundexScore = 50;
+
+// The fewest removed words for which the tree is rebuilt.
+static const int minDeadNodes = 64;
+
+///
+/// \brief maxDistance Get the number of spelling differences allowed for a word.
+///
+static int maxDistance(const QString &word)
+{
+    if (word.size() <= 2) {
+        return 0;
+    }
+    if (word.size() <= 4) {
+        return 1;
+    }
+    return 2;
+}
+
+PhoneticIndex::PhoneticIndex() :
+    m_deadNodes(0)
+{
+
+}
+
+void PhoneticIndex::insert(DiagramItem *person)
+{
+    QStringList words = personWords(person);
+
+    // Check if already listed.
+    auto existing = m_wordsOf.constFind(person);
+    if (existing != m_wordsOf.constEnd()) {
+        if (existing.value() == words) {
+            return;
+        }
+        remove(person);
+    }
+
+    m_wordsOf.insert(person, words);
+
+    for (const QString &word: words) {
+        addWord(word, person);
+    }
+}
+
+void PhoneticIndex::remove(DiagramItem *person)
+{
+    auto existing = m_wordsOf.find(person);
+    if (existing == m_wordsOf.end()) {
+        return;
+    }
+
+    for (const QString &word: existing.value()) {
+        removeWord(word, person);
+    }
+
+    m_wordsOf.erase(existing);
+}
+
+void PhoneticIndex::clear()
+{
+    m_wordsOf.clear();
+    m_words.clear();
+    m_wordsWithKey.clear();
+    m_nodes.clear();
+    m_deadNodes = 0;
+}
+
+QVector<PhoneticIndex::Match> PhoneticIndex::find(const QString &text, int maxResults) const
+{
+    QHash<DiagramItem *, int> scores;
+
+    for (const QString &queryWord: words(text)) {
+        // Score the words like this one.
+        QHash<QString, int> wordScores;
+
+        for (const auto &near: nearWords(queryWord, maxDistance(queryWord))) {
+            wordScores[near.first] = exactScore - near.second * distanceStep;
+        }
+
+        for (const QString &key: keys(queryWord)) {
+            int keyScore = soundexScore;
+            if (key.startsWith(QLatin1String("M:"))) {
+                keyScore = metaphoneScore;
+            }
+            else if (key.startsWith(QLatin1String("D:"))) {
+                keyScore = mokotoffScore;
+            }
+
+            for (const QString &word: m_wordsWithKey.value(key)) {
+                int &score = wordScores[word];
+                score = qMax(score, keyScore);
+            }
+        }
+
+        // Give each person the score of their best word.
+        QHash<DiagramItem *, int> personScores;
+        for (auto it = wordScores.constBegin(); it != wordScores.constEnd(); ++it) {
+            for (DiagramItem *person: m_words[it.key()].persons) {
+                int &score = personScores[person];
+                score = qMax(score, it.value());
+            }
+        }
+
+        for (auto it = personScores.constBegin(); it != personScores.constEnd(); ++it) {
+            scores[it.key()] += it.value();
+        }
+    }
+
+    QVector<Match> result;
+    result.reserve(scores.size());
+    for (auto it = scores.constBegin(); it != scores.constEnd(); ++it) {
+        result << Match { it.key(), it.value() };
+    }
+
+    // Best first. Ties are sorted by name so the order does not change between searches.
+    auto better = [](const Match &a, const Match &b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        int order = QString::localeAwareCompare(a.person->name(), b.person->name());
+        if (order != 0) {
+            return order < 0;
+        }
+        return a.person < b.person;
+    };
+
+    int count = qMin(maxResults, result.size());
+    std::partial_sort(result.begin(), result.begin() + count, result.end(), better);
+    result.resize(count);
+
+    return result;
+}
+
+int PhoneticIndex::size() const
+{
+    return m_wordsOf.size();
+}
+
+QStringList PhoneticIndex::words(const QString &text)
+{
+    static const QRegularExpression separators("[\\s\\-,./()\"']+");
+
+    QStringList result;
+    for (const QString &part: text.split(separators, QString::SkipEmptyParts)) {
+        QString word = Phonetic::letters(part);
+        if (!word.isEmpty() && !result.contains(word)) {
+            result << word;
+        }
+    }
+
+    return result;
+}
+
+QStringList PhoneticIndex::personWords(DiagramItem *person)
+{
+    QStringList result = words(person->getFirstName() + ' ' + person->getLastName());
+
+    // Not all persons have the name split into first and last names.
+    if (result.isEmpty()) {
+        result = words(person->name());
+    }
+
+    return result;
+}
+
+QStringList PhoneticIndex::keys(const QString &word)
+{
+    QStringList result;
+
+    for (const QString &key: Phonetic::doubleMetaphone(word)) {
+        result << QLatin1String("M:") + key;
+    }
+    for (const QString &key: Phonetic::daitchMokotoff(word)) {
+        result << QLatin1String("D:") + key;
+    }
+    result << QLatin1String("S:") + Phonetic::soundex(word);
+
+    return result;
+}
+
+void PhoneticIndex::addWord(const QString &word, DiagramItem *person)
+{
+    auto existing = m_words.find(word);
+    if (existing != m_words.end()) {
+        existing.value().persons << person;
+        return;
+    }
+
+    // A new word.
+    Word &entry = m_words[word];
+    entry.persons << person;
+    entry.keys = keys(word);
+
+    for (const QString &key: entry.keys) {
+        m_wordsWithKey[key] << word;
+    }
+
+    addNode(word);
+}
+
+void PhoneticIndex::removeWord(const QString &word, DiagramItem *person)
+{
+    auto existing = m_words.find(word);
+    if (existing == m_words.end()) {
+        return;
+    }
+
+    Word &entry = existing.value();
+    entry.persons.removeOne(person);
+    if (!entry.persons.isEmpty()) {
+        return;
+    }
+
+    // No one else uses the word.
+    for (const QString &key: entry.keys) {
+        auto list = m_wordsWithKey.find(key);
+        if (list != m_wordsWithKey.end()) {
+            list.value().removeOne(word);
+            if (list.value().isEmpty()) {
+                m_wordsWithKey.erase(list);
+            }
+        }
+    }
+
+    m_words.erase(existing);
+    removeNode(word);
+}
+
+void PhoneticIndex::addNode(const QString &word)
+{
+    if (m_nodes.isEmpty()) {
+        m_nodes << Node { word, true, {} };
+        return;
+    }
+
+    int current = 0;
+    while (true) {
+        Node &node = m_nodes[current];
+        int distance = Phonetic::editDistance(word, node.word);
+
+        if (distance == 0) {
+            // The word was removed before.
+            if (!node.live) {
+                node.live = true;
+                --m_deadNodes;
+            }
+            return;
+        }
+
+        int next = -1;
+        for (const auto &child: node.children) {
+            if (child.first == distance) {
+                next = child.second;
+                break;
+            }
+        }
+
+        if (next == -1) {
+            int added = m_nodes.size();
+            node.children << qMakePair(distance, added);
+            m_nodes << Node { word, true, {} };
+            return;
+        }
+
+        current = next;
+    }
+}
+
+void PhoneticIndex::removeNode(const QString &word)
+{
+    if (m_nodes.isEmpty()) {
+        return;
+    }
+
+    int current = 0;
+    while (current != -1) {
+        Node &node = m_nodes[current];
+        int distance = Phonetic::editDistance(word, node.word);
+
+        if (distance == 0) {
+            if (node.live) {
+                node.live = false;
+                ++m_deadNodes;
+            }
+            break;
+        }
+
+        int next = -1;
+        for (const auto &child: node.children) {
+            if (child.first == distance) {
+                next = child.second;
+                break;
+            }
+        }
+        current = next;
+    }
+
+    if (m_deadNodes >= minDeadNodes && m_deadNodes > m_words.size()) {
+        rebuildTree();
+    }
+}
+
+void PhoneticIndex::rebuildTree()
+{
+    m_nodes.clear();
+    m_deadNodes = 0;
+    m_nodes.reserve(m_words.size());
+
+    for (auto it = m_words.constBegin(); it != m_words.constEnd(); ++it) {
+        addNode(it.key());
+    }
+}
+
+QVector<QPair<QString, int> > PhoneticIndex::nearWords(const QString &word, int maxDistance) const
+{
+    QVector<QPair<QString, int> > result;
+    if (m_nodes.isEmpty()) {
+        return result;
+    }
+
+    QVector<int> pending;
+    pending << 0;
+
+    while (!pending.isEmpty()) {
+        const Node &node = m_nodes[pending.takeLast()];
+        int distance = Phonetic::editDistance(word, node.word);
+
+        if (node.live && distance <= maxDistance) {
+            result << qMakePair(node.word, distance);
+        }
+
+        // Only children in this range can be close enough.
+        for (const auto &child: node.children) {
+            if (qAbs(child.first - distance) <= maxDistance) {
+                pending << child.second;
+            }
+        }
+    }
+
+    return result;
+}
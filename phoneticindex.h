@@ -0,0 +1,105 @@
+#ifndef PHONETICINDEX_H
+#define PHONETICINDEX_H
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class DiagramItem;
+
+/**
+ * @brief The PhoneticIndex class finds persons whose first or last name sounds
+ * like, or is spelled almost like, the search text, e.g. "Zyl" finds "Zijl".
+ *
+ * Each word of a name is listed once with the persons that use it. Its Soundex,
+ * Daitch-Mokotoff and Double Metaphone keys are worked out when the word is
+ * first added, so a search only looks up the keys of the search words. Words
+ * within a small edit distance are found with a BK-tree, which only compares
+ * the search word with a few of the words.
+ */
+class PhoneticIndex
+{
+public:
+    /**
+     * @brief The Match struct is a person found by a search, with how well they match.
+     */
+    struct Match
+    {
+        DiagramItem *person;
+        int score; ///< Higher is better. Each search word adds up to 100.
+    };
+
+    PhoneticIndex();
+
+    /**
+     * @brief insert Add a person, or update them if their name changed.
+     * @param person The person.
+     */
+    void insert(DiagramItem *person);
+
+    /**
+     * @brief remove Remove a person.
+     * @param person The person.
+     */
+    void remove(DiagramItem *person);
+
+    /**
+     * @brief clear Remove all persons.
+     */
+    void clear();
+
+    /**
+     * @brief find Find the persons with names like the text.
+     * @param text The search text. Each word is matched separately.
+     * @param maxResults The most matches to return.
+     * @return The best matches first.
+     */
+    QVector<Match> find(const QString &text, int maxResults = 50) const;
+
+    /**
+     * @brief size Get the number of persons in the index.
+     */
+    int size() const;
+
+    /**
+     * @brief words Get the words of a name used for matching.
+     * @param text The name.
+     * @return The words, in upper case without accents.
+     */
+    static QStringList words(const QString &text);
+
+private:
+    struct Word
+    {
+        QVector<DiagramItem *> persons;
+        QStringList keys;
+    };
+
+    struct Node
+    {
+        QString word;
+        bool live;
+        QVector<QPair<int, int> > children; ///< Edit distance and node.
+    };
+
+    static QStringList personWords(DiagramItem *person);
+    static QStringList keys(const QString &word);
+    void addWord(const QString &word, DiagramItem *person);
+    void removeWord(const QString &word, DiagramItem *person);
+    void addNode(const QString &word);
+    void removeNode(const QString &word);
+    void rebuildTree();
+    QVector<QPair<QString, int> > nearWords(const QString &word, int maxDistance) const;
+
+    QHash<DiagramItem *, QStringList> m_wordsOf;
+    QHash<QString, Word> m_words;
+    QHash<QString, QStringList> m_wordsWithKey;
+
+    // The BK-tree. Removed words are marked, and the tree is rebuilt when most are removed.
+    QVector<Node> m_nodes;
+    int m_deadNodes;
+};
+
+#endif // PHONETICINDEX_H
@@ -0,0 +1,72 @@
+#include "photostore.h"
+#include "diagramwriter.h"
+#include "fileutils.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+
+QString PhotoStore::folderFor(const QString &photosFolderPath)
+{
+    return photosFolderPath + "/store";
+}
+
+QString PhotoStore::pathFor(const QString &storeFolderPath, const QString &source)
+{
+    QByteArray hash = FileUtils::hashFile(source);
+    if (hash.isEmpty()) {
+        return QString();
+    }
+
+    // Keep the extension, so the photo viewer knows the format.
+    QString fileName = QString::fromLatin1(hash.toHex());
+    QString suffix = QFileInfo(source).suffix().toLower();
+    if (!suffix.isEmpty()) {
+        fileName += "." + suffix;
+    }
+
+    return QDir(storeFolderPath).absoluteFilePath(fileName);
+}
+
+int PhotoStore::collectGarbage(const DiagramSnapshot &snapshot)
+{
+    if (snapshot.photosFolderPath.isEmpty()) {
+        return 0;
+    }
+
+    QDir storeDir(folderFor(snapshot.photosFolderPath));
+    if (!storeDir.exists()) {
+        return 0;
+    }
+
+    // Find the photos in use.
+    QSet<QString> referenced;
+    for (const PersonRecord &person: snapshot.persons) {
+        for (const QString &photo: person.photos) {
+            referenced.insert(QFileInfo(photo).absoluteFilePath());
+        }
+    }
+    for (const QString &photo: snapshot.retainedPhotos) {
+        referenced.insert(QFileInfo(photo).absoluteFilePath());
+    }
+
+    // Delete the rest.
+    int deletedCount = 0;
+    const QFileInfoList files = storeDir.entryInfoList(QDir::Files);
+
+    for (const QFileInfo &file: files) {
+        if (referenced.contains(file.absoluteFilePath())) {
+            continue;
+        }
+
+        if (QFile::remove(file.absoluteFilePath())) {
+            ++deletedCount;
+        }
+        else {
+            qDebug() << "Could not remove unused photo" << file.absoluteFilePath();
+        }
+    }
+
+    return deletedCount;
+}
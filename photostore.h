@@ -0,0 +1,42 @@
+#ifndef PHOTOSTORE_H
+#define PHOTOSTORE_H
+
+#include <QString>
+
+struct DiagramSnapshot;
+
+/**
+ * @brief The PhotoStore class manages the shared photo store of a project.
+ *
+ * The store is a folder inside the project photos folder that holds each
+ * photo once, named by the hash of its contents. Persons with the same photo
+ * refer to the same file.
+ */
+class PhotoStore
+{
+public:
+    /**
+     * @brief folderFor Get the store folder of a project.
+     * @param photosFolderPath The project photos folder.
+     * @return The store folder path.
+     */
+    static QString folderFor(const QString &photosFolderPath);
+
+    /**
+     * @brief pathFor Get the path of a photo in the store. Reads the photo.
+     * @param storeFolderPath The store folder.
+     * @param source The photo to store.
+     * @return The path, or an empty string if the photo cannot be read.
+     */
+    static QString pathFor(const QString &storeFolderPath, const QString &source);
+
+    /**
+     * @brief collectGarbage Delete the photos in the store that the snapshot
+     * does not refer to, and that undo cannot bring back.
+     * @param snapshot The saved snapshot.
+     * @return The number of photos deleted.
+     */
+    static int collectGarbage(const DiagramSnapshot &snapshot);
+};
+
+#endif // PHOTOSTORE_H
@@ -0,0 +1,234 @@
+#include "rendercache.h"
+
+#include <QCache>
+#include <QPainter>
+#include <QPixmap>
+#include <QtMath>
+
+// The memory limit to start with, in kilobytes.
+static const int defaultLimit = 32 * 1024;
+
+// The number of drawings after which the hit rate is checked.
+static const int windowSize = 500;
+
+// The number of drawings for which the cache is left out when it does not help.
+static const int bypassLength = 2000;
+
+namespace {
+
+///
+/// \brief The PictureKey struct finds a picture by appearance, zoom and pixel ratio.
+///
+struct PictureKey
+{
+    QString appearance;
+    qreal scaleX;
+    qreal scaleY;
+    qreal pixelRatio;
+
+    bool operator==(const PictureKey &other) const
+    {
+        return scaleX == other.scaleX && scaleY == other.scaleY &&
+                pixelRatio == other.pixelRatio && appearance == other.appearance;
+    }
+};
+
+uint qHash(const PictureKey &key, uint seed = 0)
+{
+    return ::qHash(key.appearance, seed) ^ ::qHash(key.scaleX) ^ (::qHash(key.scaleY) * 31) ^ ::qHash(key.pixelRatio);
+}
+
+struct State
+{
+    State() :
+        enabled(true),
+        hits(0),
+        misses(0),
+        windowLookups(0),
+        windowHits(0),
+        bypassLeft(0)
+    {
+        pictures.setMaxCost(defaultLimit);
+    }
+
+    QCache<PictureKey, QPixmap> pictures; ///< The cost of each is its size in kilobytes.
+    bool enabled;
+    int hits;
+    int misses;
+    int windowLookups;
+    int windowHits;
+    int bypassLeft;
+};
+
+}
+
+static State &state()
+{
+    static State instance;
+    return instance;
+}
+
+///
+/// \brief recordLookup Count a lookup, and leave the cache out for a while if
+/// almost nothing was found in a full cache.
+///
+static void recordLookup(bool hit)
+{
+    State &s = state();
+
+    if (hit) {
+        ++s.hits;
+        ++s.windowHits;
+    }
+    else {
+        ++s.misses;
+    }
+
+    if (++s.windowLookups < windowSize) {
+        return;
+    }
+
+    bool full = (s.pictures.totalCost() * 10 >= s.pictures.maxCost() * 9);
+    if (full && s.windowHits * 10 < s.windowLookups) {
+        s.bypassLeft = bypassLength;
+    }
+
+    s.windowLookups = 0;
+    s.windowHits = 0;
+}
+
+bool RenderCache::isEnabled()
+{
+    return state().enabled;
+}
+
+void RenderCache::setEnabled(bool enabled)
+{
+    State &s = state();
+    s.enabled = enabled;
+    s.bypassLeft = 0;
+
+    if (!enabled) {
+        s.pictures.clear();
+    }
+}
+
+int RenderCache::limit()
+{
+    return state().pictures.maxCost();
+}
+
+void RenderCache::setLimit(int kilobytes)
+{
+    state().pictures.setMaxCost(qMax(0, kilobytes));
+}
+
+bool RenderCache::draw(QPainter *painter, const QString &key, const QRectF &rect,
+                       const std::function<void(QPainter *)> &paint)
+{
+    State &s = state();
+    if (!s.enabled) {
+        return false;
+    }
+
+    if (s.bypassLeft > 0) {
+        --s.bypassLeft;
+        return false;
+    }
+
+    // Only a scale and a move can be undone by copying pixels.
+    QTransform transform = painter->worldTransform();
+    if (transform.type() > QTransform::TxScale || transform.m11() <= 0 || transform.m22() <= 0) {
+        return false;
+    }
+
+    // Draw in the pixels of the screen, which on high resolution screens are
+    // smaller than the device coordinates.
+    qreal pixelRatio = painter->device()->devicePixelRatioF();
+    QRectF deviceRect = transform.mapRect(rect);
+    QSize size(qCeil(deviceRect.width() * pixelRatio) + 1, qCeil(deviceRect.height() * pixelRatio) + 1);
+
+    // A picture bigger than a quarter of the limit would push out most of the others.
+    int cost = (size.width() * size.height() * 4) / 1024 + 1;
+    if (cost * 4 > s.pictures.maxCost()) {
+        return false;
+    }
+
+    PictureKey pictureKey;
+    pictureKey.appearance = key;
+    pictureKey.scaleX = transform.m11();
+    pictureKey.scaleY = transform.m22();
+    pictureKey.pixelRatio = pixelRatio;
+
+    QPixmap *picture = s.pictures.object(pictureKey);
+    recordLookup(picture != nullptr);
+
+    if (!picture) {
+        picture = new QPixmap(size);
+        picture->setDevicePixelRatio(pixelRatio);
+        picture->fill(Qt::transparent);
+
+        QPainter picturePainter(picture);
+        picturePainter.setRenderHints(painter->renderHints());
+        picturePainter.scale(transform.m11(), transform.m22());
+        picturePainter.translate(-rect.topLeft());
+        paint(&picturePainter);
+        picturePainter.end();
+
+        s.pictures.insert(pictureKey, picture, cost);
+    }
+
+    // Copy the picture in device pixels, rounding to the nearest one.
+    painter->save();
+    painter->setWorldTransform(QTransform());
+    painter->drawPixmap(deviceRect.topLeft().toPoint(), *picture);
+    painter->restore();
+
+    return true;
+}
+
+void RenderCache::clear()
+{
+    state().pictures.clear();
+}
+
+int RenderCache::hitCount()
+{
+    return state().hits;
+}
+
+int RenderCache::missCount()
+{
+    return state().misses;
+}
+
+qreal RenderCache::hitRate()
+{
+    const State &s = state();
+    int lookups = s.hits + s.misses;
+    return (lookups == 0) ? 0.0 : qreal(s.hits) / lookups;
+}
+
+int RenderCache::memoryUsed()
+{
+    return state().pictures.totalCost();
+}
+
+int RenderCache::pictureCount()
+{
+    return state().pictures.size();
+}
+
+bool RenderCache::isBypassed()
+{
+    return state().bypassLeft > 0;
+}
+
+void RenderCache::resetStatistics()
+{
+    State &s = state();
+    s.hits = 0;
+    s.misses = 0;
+    s.windowLookups = 0;
+    s.windowHits = 0;
+}
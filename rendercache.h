@@ -0,0 +1,79 @@
+#ifndef RENDERCACHE_H
+#define RENDERCACHE_H
+
+#include <QRectF>
+#include <QString>
+
+#include <functional>
+
+class QPainter;
+
+/**
+ * @brief The RenderCache class keeps pictures of persons and marriage rings,
+ * as drawn at the current zoom, so that scrolling copies pixels instead of
+ * laying out text and outlines again.
+ *
+ * Pictures are found by a key that describes everything that changes how an
+ * item looks: its text, colors, border, size and selection. An item that
+ * changes gets a new key, so no picture has to be thrown away by hand, and
+ * items that look the same share one picture. The pictures used least
+ * recently are dropped when the memory limit is reached.
+ *
+ * If pictures keep being dropped before they are used again, as when more
+ * items are shown than fit in the limit, the cache is left out for a while,
+ * since it would only add work.
+ */
+class RenderCache
+{
+public:
+    static bool isEnabled();
+
+    /**
+     * @brief setEnabled Turn the cache on or off. Turning it off frees the pictures.
+     */
+    static void setEnabled(bool enabled);
+
+    /// The memory limit, in kilobytes.
+    static int limit();
+    static void setLimit(int kilobytes);
+
+    /**
+     * @brief draw Draw an item from its picture, making the picture first if needed.
+     * @param painter The painter of the view.
+     * @param key The appearance of the item. The zoom is added to it.
+     * @param rect The area to draw, in item coordinates.
+     * @param paint Draws the item, in item coordinates.
+     * @return False if nothing was drawn, since the cache is off or left out,
+     * or the view is rotated. The caller then draws the item itself.
+     */
+    static bool draw(QPainter *painter, const QString &key, const QRectF &rect,
+                     const std::function<void(QPainter *)> &paint);
+
+    /**
+     * @brief clear Drop all pictures.
+     */
+    static void clear();
+
+    static int hitCount();
+    static int missCount();
+
+    /**
+     * @brief hitRate Get the part of the drawings copied from a picture, from 0 to 1.
+     */
+    static qreal hitRate();
+
+    /// The memory used by the pictures, in kilobytes.
+    static int memoryUsed();
+
+    static int pictureCount();
+
+    /**
+     * @brief isBypassed Check if the cache is left out for now, since pictures
+     * were dropped before they could be used.
+     */
+    static bool isBypassed();
+
+    static void resetStatistics();
+};
+
+#endif // RENDERCACHE_H
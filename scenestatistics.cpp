@@ -0,0 +1,129 @@
+#include "scenestatistics.h"
+#include "diagramitem.h"
+#include "generationindex.h"
+
+SceneStatistics::SceneStatistics() :
+    m_nextOrder(0),
+    m_personsWithPhotosCount(0)
+{
+
+}
+
+///
+/// \brief knownDate Get a date, or an invalid date if it was left at the default.
+///
+static QDate knownDate(const QDate &date, const QDate &defaultDate)
+{
+    return (date == defaultDate) ? QDate() : date;
+}
+
+void SceneStatistics::updatePerson(DiagramItem *person)
+{
+    Entry entry;
+    entry.dateOfBirth = knownDate(person->getDateOfBirth(), DiagramItem::defaultDateOfBirth());
+    entry.dateOfDeath = knownDate(person->getDateOfDeath(), DiagramItem::defaultDateOfDeath());
+    entry.hasPhotos = !person->photos().isEmpty();
+
+    auto existing = m_entries.find(person);
+    if (existing != m_entries.end()) {
+        // Undo the old details, but keep the place in the order.
+        Entry &old = existing.value();
+        if (old.dateOfBirth == entry.dateOfBirth && old.dateOfDeath == entry.dateOfDeath && old.hasPhotos == entry.hasPhotos) {
+            return;
+        }
+
+        removeDate(old.dateOfBirth);
+        removeDate(old.dateOfDeath);
+        m_personsWithPhotosCount -= old.hasPhotos ? 1 : 0;
+        entry.order = old.order;
+        old = entry;
+    }
+    else {
+        entry.order = m_nextOrder++;
+        m_entries.insert(person, entry);
+        m_order.insert(entry.order, person);
+    }
+
+    addDate(entry.dateOfBirth);
+    addDate(entry.dateOfDeath);
+    m_personsWithPhotosCount += entry.hasPhotos ? 1 : 0;
+}
+
+void SceneStatistics::removePerson(DiagramItem *person)
+{
+    auto existing = m_entries.find(person);
+    if (existing == m_entries.end()) {
+        return;
+    }
+
+    const Entry &entry = existing.value();
+    removeDate(entry.dateOfBirth);
+    removeDate(entry.dateOfDeath);
+    m_personsWithPhotosCount -= entry.hasPhotos ? 1 : 0;
+    m_order.remove(entry.order);
+    m_entries.erase(existing);
+}
+
+void SceneStatistics::clear()
+{
+    m_entries.clear();
+    m_order.clear();
+    m_nextOrder = 0;
+    m_dates.clear();
+    m_personsWithPhotosCount = 0;
+}
+
+int SceneStatistics::personCount() const
+{
+    return m_entries.size();
+}
+
+int SceneStatistics::personsWithPhotosCount() const
+{
+    return m_personsWithPhotosCount;
+}
+
+DiagramItem *SceneStatistics::firstPerson() const
+{
+    return m_order.isEmpty() ? nullptr : m_order.first();
+}
+
+QDate SceneStatistics::earliestDate() const
+{
+    return m_dates.isEmpty() ? QDate() : m_dates.firstKey();
+}
+
+QDate SceneStatistics::latestDate() const
+{
+    return m_dates.isEmpty() ? QDate() : m_dates.lastKey();
+}
+
+int SceneStatistics::generationCount() const
+{
+    int count = 0;
+
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        count = qMax(count, GenerationIndex::generation(it.key()) + 1);
+    }
+
+    return count;
+}
+
+void SceneStatistics::addDate(const QDate &date)
+{
+    if (date.isValid()) {
+        ++m_dates[date];
+    }
+}
+
+void SceneStatistics::removeDate(const QDate &date)
+{
+    if (!date.isValid()) {
+        return;
+    }
+
+    auto found = m_dates.find(date);
+    if (found != m_dates.end() && --found.value() == 0) {
+        m_dates.erase(found);
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef SCENESTATISTICS_H
+#define SCENESTATISTICS_H
+
+#include <QDate>
+#include <QHash>
+#include <QMap>
+
+class DiagramItem;
+
+/**
+ * @brief The SceneStatistics class keeps totals of the persons in a diagram,
+ * so they can be read without going through every person.
+ *
+ * Persons are added and removed by the scene as they enter and leave it,
+ * which covers adding, deleting, undo and loading. Persons also report changes
+ * to their dates and photos.
+ */
+class SceneStatistics
+{
+public:
+    SceneStatistics();
+
+    /**
+     * @brief updatePerson Add a person, or read their dates and photos again.
+     * @param person The person.
+     */
+    void updatePerson(DiagramItem *person);
+
+    /**
+     * @brief removePerson Remove a person.
+     * @param person The person.
+     */
+    void removePerson(DiagramItem *person);
+
+    /**
+     * @brief clear Reset all counts, when the scene is cleared.
+     */
+    void clear();
+
+    int personCount() const;
+
+    /**
+     * @brief personsWithPhotosCount Get the number of persons with at least one photo.
+     */
+    int personsWithPhotosCount() const;
+
+    /**
+     * @brief firstPerson Get the person added first of those still in the diagram.
+     * @return The person, or null if there are no persons.
+     */
+    DiagramItem *firstPerson() const;
+
+    /**
+     * @brief earliestDate Get the earliest known date of birth or death.
+     * @return The date, or an invalid date if none are known.
+     */
+    QDate earliestDate() const;
+
+    /**
+     * @brief latestDate Get the latest known date of birth or death.
+     * @return The date, or an invalid date if none are known.
+     */
+    QDate latestDate() const;
+
+    /**
+     * @brief generationCount Get the number of generations in the longest line of descent.
+     * Reads the cached generation of each person, so it is not constant time.
+     */
+    int generationCount() const;
+
+private:
+    struct Entry
+    {
+        quint64 order;
+        QDate dateOfBirth; ///< Invalid if not known.
+        QDate dateOfDeath; ///< Invalid if not known.
+        bool hasPhotos;
+    };
+
+    void addDate(const QDate &date);
+    void removeDate(const QDate &date);
+
+    QHash<DiagramItem *, Entry> m_entries;
+    QMap<quint64, DiagramItem *> m_order; ///< Persons in the order added.
+    quint64 m_nextOrder;
+    QMap<QDate, int> m_dates; ///< The number of persons with each known date.
+    int m_personsWithPhotosCount;
+};
+
+#endif // SCENESTATISTICS_H
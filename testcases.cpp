@@ -1,10 +1,29 @@
 #include <QtWidgets>
 #include <QtTest/QtTest>
 
+#include "arrow.h"
+#include "diagrambinary.h"
 #include "diagramitem.h"
+#include "diagramreader.h"
 #include "diagramscene.h"
+#include "diagramtextitem.h"
+#include "diagramwriter.h"
+#include "edgelayer.h"
 #include "fileutils.h"
+#include "gedcomexporter.h"
+#include "gedcomimporter.h"
+#include "generationindex.h"
+#include "itemhash.h"
+#include "itemregistry.h"
+#include "kinshipgraph.h"
+#include "layoutengine.h"
 #include "marriageitem.h"
+#include "nameindex.h"
+#include "phonetic.h"
+#include "photostore.h"
+#include "rendercache.h"
+#include "scenestatistics.h"
+#include "textindex.h"
 #include "gui/dialogchangesize.h"
 #include "gui/dialogfileproperties.h"
 #include "gui/dialogfind.h"
@@ -873,6 +892,33 @@ private slots:
     void personListReportDefaultDateTest();
     void setDiagramFontTest();
     void setFillColorTest();
+    void openForwardReferencesTest();
+    void saveThenOpenFromBufferTest();
+    void gedcomImporterTest();
+    void gedcomExporterTest();
+    void diagramReaderTest();
+    void saveSnapshotTest();
+    void binaryRoundTripTest();
+    void syncFileTest();
+    void sharedPhotoStoreTest();
+    void kinshipGraphTest();
+    void layoutEngineTest();
+    void generationIndexTest();
+    void autoLayoutFamilyTest();
+    void autoLayoutSupersedeTest();
+    void nameIndexTest();
+    void phoneticTest();
+    void textIndexTest();
+    void sceneStatisticsTest();
+    void itemRegistryTest();
+    void itemHashTest();
+    void arrowGeometryTest();
+    void edgeLayerTest();
+    void levelOfDetailTest();
+    void nameEditorTest();
+    void renderCacheTest();
+    void saveDuringEditTest();
+    void autoLayoutUndoTest();
 
 private slots:
     void testFontWarning();
@@ -918,6 +964,7 @@ void TestCases::saveTestFileAs(const QString &fileName)
         return;
     }
     action->trigger();
+    m_mainWindow->waitForSave();
 
     QFileInfo info(fileName);
     QString baseName = info.fileName();
@@ -1013,6 +1060,7 @@ void TestCases::testSave()
     m_helper->setSaveFileName("saved-diagram.xml");
     QTimer::singleShot(1000, m_helper, SLOT(handleSaveDialog()));
     QTest::keyClicks(m_mainWindow, "S", Qt::ControlModifier);
+    m_mainWindow->waitForSave();
 
     QCOMPARE(m_mainWindow->windowTitle(), QString("Genealogy Maker Qt - saved-diagram.xml"));
 }
@@ -1069,6 +1117,7 @@ void TestCases::volumeTest()
     m_helper->setSaveFileName("volume-test.xml");
     QTimer::singleShot(1000, m_helper, SLOT(handleSaveDialog()));
     QTest::keyClicks(m_mainWindow, "S", Qt::ControlModifier);
+    m_mainWindow->waitForSave();
 }
 
 void TestCases::setGenderTest()
@@ -1209,7 +1258,7 @@ void TestCases::setDisplayNameTest()
     }
 
     // Check display name was set.
-    QCOMPARE(person->textItem()->text(), QString("New Display Name"));
+    QCOMPARE(person->name(), QString("New Display Name"));
 }
 
 void TestCases::importGedcomTest()
@@ -1269,6 +1318,7 @@ void TestCases::saveFillColorTest()
     m_helper->setSaveFileName(diagramFileName);
     QTimer::singleShot(1000, m_helper, SLOT(handleSaveDialog()));
     QTest::keyClicks(m_mainWindow, "S", Qt::ControlModifier);
+    m_mainWindow->waitForSave();
 
     QCOMPARE(m_mainWindow->windowTitle(), QString("Genealogy Maker Qt - save-fill-color-test.xml"));
 
@@ -1449,7 +1499,7 @@ void TestCases::treeViewTest()
     }
 
     // Check display name was set.
-    QCOMPARE(person->textItem()->text(), QString("New Display Name"));
+    QCOMPARE(person->name(), QString("New Display Name"));
 
     // Check that the entry is renamed.
     QCOMPARE(treeViewItem->text(0), QString("New Display Name"));
@@ -1481,6 +1531,7 @@ void TestCases::importGedcomThenSaveTest()
     QTimer::singleShot(1000, m_helper, SLOT(handleSaveDialog()));
 
     action = m_mainWindow->findChild<QAction*>("saveAction");
+    m_mainWindow->waitForSave();
     action->trigger();
 
     // Check that diagram was saved correctly.
@@ -1598,7 +1649,7 @@ void TestCases::testLongName()
 
     // Check that name fits in box.
     int boxWidth = person->boundingRect().width();
-    int textWidth = person->textItem()->boundingRect().width();
+    int textWidth = person->nameRect().width();
 
     QVERIFY(boxWidth >= textWidth);
 
@@ -1817,6 +1868,7 @@ void TestCases::importGedcomFile(const QString &fileName)
     // Import the GEDCOM file.
     QTimer::singleShot(1000, m_helper, SLOT(handleOpenDialog()));
     action->trigger();
+    m_mainWindow->waitForLayout();
 
     //    QCOMPARE(m_mainWindow->windowTitle(), QString("Genealogy Maker Qt - New Diagram (Imported from GEDCOM)"));
 }
@@ -2280,6 +2332,7 @@ void TestCases::autoLayoutTest()
     QAction *action = m_mainWindow->findChild<QAction*>("actionAutoLayout");
     QVERIFY(action);
     action->trigger();
+    m_mainWindow->waitForLayout();
 
     // Undo.
     action = m_mainWindow->findChild<QAction*>("undoAction");
@@ -2360,7 +2413,7 @@ void TestCases::setDiagramFontTest()
     }
 
     // Check values.
-    QFont font = getFirstPerson()->textItem()->font();
+    QFont font = getFirstPerson()->nameFont();
     QCOMPARE(font.family(), QString("Serif"));
     QCOMPARE(font.pointSize(), 10);
 }
@@ -2566,6 +2619,1304 @@ void TestCases::exportImageTest()
 //    action->trigger(); // TODO: The dialog does not close automatically. Must close manually.
 }
 
+void TestCases::openForwardReferencesTest()
+{
+    // Relationship and marriage are listed before the persons they refer to.
+    QByteArray xml =
+            "<genealogy width=\"5000\" height=\"5000\">"
+            "<relationship from=\"{00000000-0000-0000-0000-000000000001}\" to=\"{00000000-0000-0000-0000-000000000003}\"/>"
+            "<marriage person_left=\"{00000000-0000-0000-0000-000000000001}\" person_right=\"{00000000-0000-0000-0000-000000000002}\" place=\"Pretoria\"/>"
+            "<item id=\"{00000000-0000-0000-0000-000000000001}\" name=\"Father\" x=\"100\" y=\"100\"/>"
+            "<item id=\"{00000000-0000-0000-0000-000000000002}\" name=\"Mother\" x=\"300\" y=\"100\"/>"
+            "<item id=\"{00000000-0000-0000-0000-000000000003}\" name=\"Child\" x=\"200\" y=\"300\">"
+            "<photo path=\"Photo.png\"/>"
+            "</item>"
+            "</genealogy>";
+    QBuffer buffer(&xml);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    // Open.
+    DiagramScene *scene = m_mainWindow->getScene();
+    QVERIFY(scene->open(&buffer, QString()));
+
+    // Check the links were resolved.
+    QCOMPARE(scene->personCount(), 3);
+    QCOMPARE(scene->relationshipCount(), 1);
+    QCOMPARE(scene->marriageCount(), 1);
+
+    DiagramItem *child = getPersonWithName("Child");
+    QVERIFY(child);
+    QCOMPARE(child->photos().size(), 1);
+    QCOMPARE(child->getParents().size(), 1);
+}
+
+void TestCases::saveThenOpenFromBufferTest()
+{
+    // Open test file.
+    openTestFile(getTestInputFilePathFor("smith-new.xml"));
+
+    DiagramScene *scene = m_mainWindow->getScene();
+    int personCount = scene->personCount();
+    int relationshipCount = scene->relationshipCount();
+    int marriageCount = scene->marriageCount();
+    QVERIFY(personCount > 0);
+
+    // Save to memory.
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    scene->save(&buffer, QString());
+    buffer.close();
+
+    // Check the element layout.
+    QVERIFY(buffer.data().startsWith("<genealogy width=\"5000\" height=\"5000\">\n    <item "));
+
+    // Open again.
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QVERIFY(scene->open(&buffer, QString()));
+
+    // Check nothing was lost.
+    QCOMPARE(scene->personCount(), personCount);
+    QCOMPARE(scene->relationshipCount(), relationshipCount);
+    QCOMPARE(scene->marriageCount(), marriageCount);
+}
+
+void TestCases::gedcomImporterTest()
+{
+    QByteArray gedcom =
+            "0 HEAD\n"
+            "0 @I1@ INDI\n"
+            "1 NAME John /Smith/\n"
+            "1 SEX M\n"
+            "1 BIRT\n"
+            "2 DATE 1 JAN 1900\n"
+            "2 PLAC London\n"
+            "1 FAMS @F1@\n"
+            "0 @I2@ INDI\n"
+            "1 NAME\n"
+            "2 GIVN Mary\n"
+            "2 SURN Jones\n"
+            "1 FAMS @F1@\n"
+            "0 @I3@ INDI\n"
+            "1 NAME Sally /Smith/\n"
+            "1 DEAT\n"
+            "2 DATE 2 FEB 1990\n"
+            "1 FAMC @F1@\n"
+            "0 @F1@ FAM\n"
+            "1 HUSB @I1@\n"
+            "1 WIFE @I2@\n"
+            "1 CHIL @I3@\n"
+            "1 MARR\n"
+            "2 DATE 3 MAR 1920\n"
+            "2 PLAC Paris\n"
+            "0 TRLR\n";
+    QBuffer buffer(&gedcom);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    // Read the records.
+    GedcomImporter importer;
+    QVERIFY(importer.read(&buffer));
+
+    QCOMPARE(importer.persons().size(), 3);
+    QCOMPARE(importer.persons()[0].name, QString("John Smith"));
+    QCOMPARE(importer.persons()[0].gender, QString("M"));
+    QCOMPARE(importer.persons()[0].dateOfBirth, QDate(1900, 1, 1));
+    QCOMPARE(importer.persons()[0].placeOfBirth, QString("London"));
+    QCOMPARE(importer.persons()[1].firstName, QString("Mary"));
+    QCOMPARE(importer.persons()[1].lastName, QString("Jones"));
+    QVERIFY(importer.persons()[2].hasDateOfDeath);
+    QCOMPARE(importer.relationships().size(), 2);
+    QCOMPARE(importer.marriages().size(), 1);
+    QCOMPARE(importer.marriages()[0].place, QString("Paris"));
+
+    // Add to the scene.
+    DiagramScene *scene = m_mainWindow->getScene();
+    importer.populate(scene);
+
+    QCOMPARE(scene->personCount(), 3);
+    QCOMPARE(scene->relationshipCount(), 2);
+    QCOMPARE(scene->marriageCount(), 1);
+
+    // Check that an invalid line is reported.
+    QByteArray invalid = "0 HEAD\nnot a gedcom line\n";
+    QBuffer invalidBuffer(&invalid);
+    QVERIFY(invalidBuffer.open(QIODevice::ReadOnly));
+    QVERIFY(!importer.read(&invalidBuffer));
+    QVERIFY(importer.errorString().contains("2"));
+}
+
+void TestCases::gedcomExporterTest()
+{
+    // Open test file.
+    openTestFile(getTestInputFilePathFor("smith-new.xml"));
+
+    DiagramScene *scene = m_mainWindow->getScene();
+    int personCount = scene->personCount();
+    int relationshipCount = scene->relationshipCount();
+    int marriageCount = scene->marriageCount();
+    QVERIFY(personCount > 0);
+
+    // Export to memory.
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    GedcomExporter exporter;
+    QVERIFY(exporter.write(scene, &buffer));
+    buffer.close();
+
+    QVERIFY(buffer.data().startsWith("0 HEAD\n0 @I1@ INDI\n1 NAME "));
+    QVERIFY(buffer.data().endsWith("0 TRLR\n"));
+
+    // Import again.
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    GedcomImporter importer;
+    QVERIFY(importer.read(&buffer));
+    importer.populate(scene);
+
+    // Check nothing was lost.
+    QCOMPARE(scene->personCount(), personCount);
+    QCOMPARE(scene->marriageCount(), marriageCount);
+
+    // Children are linked to both parents in a family.
+    QVERIFY(scene->relationshipCount() >= relationshipCount);
+}
+
+void TestCases::diagramReaderTest()
+{
+    // Read test file.
+    QFile file(getTestInputFilePathFor("smith-new.xml"));
+    QVERIFY(file.open(QFile::ReadOnly | QFile::Text));
+
+    DiagramReader reader;
+    QVERIFY(reader.read(&file, QString()));
+    QCOMPARE(reader.percentRead(), 100);
+    QCOMPARE(reader.persons().size(), 7);
+    QCOMPARE(reader.relationships().size(), 3);
+    QCOMPARE(reader.marriages().size(), 1);
+
+    // Check that a cancelled read fails.
+    file.seek(0);
+    reader.cancel();
+    QVERIFY(!reader.read(&file, QString()));
+    QVERIFY(reader.wasCancelled());
+    QVERIFY(reader.errorString().isEmpty());
+}
+
+void TestCases::saveSnapshotTest()
+{
+    // Open test file.
+    openTestFile(getTestInputFilePathFor("smith-new.xml"));
+
+    DiagramScene *scene = m_mainWindow->getScene();
+    int personCount = scene->personCount();
+    int marriageCount = scene->marriageCount();
+    QVERIFY(personCount > 0);
+
+    // Take a snapshot, then change the diagram.
+    DiagramSnapshot snapshot = scene->snapshot(QString());
+    scene->beginLoad(5000, 5000);
+    QCOMPARE(scene->personCount(), 0);
+
+    // Write the snapshot.
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    DiagramWriter::write(snapshot, &buffer);
+    buffer.close();
+
+    // Check the snapshot was not affected by the change.
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QVERIFY(scene->open(&buffer, QString()));
+    QCOMPARE(scene->personCount(), personCount);
+    QCOMPARE(scene->marriageCount(), marriageCount);
+}
+
+void TestCases::binaryRoundTripTest()
+{
+    // Read test file.
+    QString fileName = getTestInputFilePathFor("smith-new.xml");
+    QString photosFolderPath = FileUtils::getPhotosFolderFor(fileName);
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::ReadOnly));
+
+    DiagramReader xmlReader;
+    QVERIFY(xmlReader.read(&file, photosFolderPath));
+    QVERIFY(xmlReader.persons().size() > 0);
+
+    // Write as XML, for comparison.
+    QBuffer xmlBuffer;
+    QVERIFY(xmlBuffer.open(QIODevice::WriteOnly));
+    DiagramWriter::write(xmlReader.snapshot(photosFolderPath), &xmlBuffer);
+    xmlBuffer.close();
+
+    // Convert to binary.
+    QBuffer binaryBuffer;
+    QVERIFY(binaryBuffer.open(QIODevice::WriteOnly));
+    DiagramBinary::write(xmlReader.snapshot(photosFolderPath), &binaryBuffer);
+    binaryBuffer.close();
+
+    // Read the binary file.
+    QVERIFY(binaryBuffer.open(QIODevice::ReadOnly));
+    QVERIFY(DiagramBinary::isBinary(&binaryBuffer));
+    DiagramReader binaryReader;
+    QVERIFY(binaryReader.read(&binaryBuffer, photosFolderPath));
+    QCOMPARE(binaryReader.width(), xmlReader.width());
+    QCOMPARE(binaryReader.height(), xmlReader.height());
+
+    // Convert back to XML. Nothing should be lost.
+    QBuffer roundTripBuffer;
+    QVERIFY(roundTripBuffer.open(QIODevice::WriteOnly));
+    DiagramWriter::write(binaryReader.snapshot(photosFolderPath), &roundTripBuffer);
+    roundTripBuffer.close();
+
+    QCOMPARE(roundTripBuffer.data(), xmlBuffer.data());
+
+    // A damaged file should be rejected.
+    QBuffer damagedBuffer;
+    damagedBuffer.setData(binaryBuffer.data().left(200));
+    QVERIFY(damagedBuffer.open(QIODevice::ReadOnly));
+    DiagramReader damagedReader;
+    QVERIFY(!damagedReader.read(&damagedBuffer, photosFolderPath));
+}
+
+void TestCases::syncFileTest()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString source = dir.filePath("source.txt");
+    QString dest = dir.filePath("dest.txt");
+
+    QFile sourceFile(source);
+    QVERIFY(sourceFile.open(QFile::WriteOnly));
+    sourceFile.write("first version");
+    sourceFile.close();
+
+    // The first sync copies the file.
+    bool skipped = true;
+    QVERIFY(FileUtils::syncFile(source, dest, &skipped));
+    QVERIFY(!skipped);
+    QVERIFY(FileUtils::hasSameContents(source, dest));
+
+    // The second sync finds it unchanged.
+    QVERIFY(FileUtils::syncFile(source, dest, &skipped));
+    QVERIFY(skipped);
+
+    // A changed source is copied again.
+    QVERIFY(sourceFile.open(QFile::WriteOnly));
+    sourceFile.write("second version");
+    sourceFile.close();
+
+    QVERIFY(FileUtils::syncFile(source, dest, &skipped));
+    QVERIFY(!skipped);
+    QVERIFY(FileUtils::hasSameContents(source, dest));
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files | QDir::Hidden).size(), 2);
+
+    // If the copy fails, the previous copy is kept. A folder in the way of the
+    // temporary copy makes it fail.
+    QVERIFY(sourceFile.open(QFile::WriteOnly));
+    sourceFile.write("third version");
+    sourceFile.close();
+    QVERIFY(QDir(dir.path()).mkdir(".dest.txt.part"));
+
+    QVERIFY(!FileUtils::syncFile(source, dest, &skipped));
+    QFile destFile(dest);
+    QVERIFY(destFile.open(QFile::ReadOnly));
+    QCOMPARE(destFile.readAll(), QByteArray("second version"));
+}
+
+void TestCases::sharedPhotoStoreTest()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Create a photo outside the project.
+    QString photo = dir.filePath("group.png");
+    QFile photoFile(photo);
+    QVERIFY(photoFile.open(QFile::WriteOnly));
+    photoFile.write("group photo");
+    photoFile.close();
+
+    // Give the same photo to two persons.
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(5000, 5000);
+
+    PersonRecord first;
+    first.name = "First";
+    first.photos << photo;
+    DiagramItem *firstItem = scene->addPerson(first);
+
+    PersonRecord second;
+    second.name = "Second";
+    second.pos = QPointF(200, 0);
+    second.photos << photo;
+    DiagramItem *secondItem = scene->addPerson(second);
+
+    // Save with the shared store.
+    QString fileName = dir.filePath("store-test.xml");
+    QString photosFolderPath = FileUtils::getPhotosFolderFor(fileName);
+    DiagramSnapshot snapshot = scene->snapshot(photosFolderPath, true);
+    QString errorString;
+    QVERIFY(DiagramWriter::save(snapshot, fileName, &errorString));
+    scene->applyPhotos(snapshot);
+
+    // The photo should be stored once, and shared.
+    QDir storeDir(PhotoStore::folderFor(photosFolderPath));
+    QCOMPARE(storeDir.entryList(QDir::Files).size(), 1);
+    QCOMPARE(firstItem->photos().size(), 1);
+    QVERIFY(firstItem->photos().first().startsWith(storeDir.absolutePath()));
+    QCOMPARE(secondItem->photos(), firstItem->photos());
+
+    // Remove the photo. It should be deleted on the next save.
+    firstItem->setPhotos(QStringList());
+    secondItem->setPhotos(QStringList());
+    snapshot = scene->snapshot(photosFolderPath, true);
+    QVERIFY(DiagramWriter::save(snapshot, fileName, &errorString));
+    QCOMPARE(storeDir.entryList(QDir::Files).size(), 0);
+}
+
+void TestCases::kinshipGraphTest()
+{
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(5000, 5000);
+
+    // Create three generations.
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    DiagramItem *grandparent = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    DiagramItem *parent = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    DiagramItem *child = scene->addPerson(record);
+
+    RelationshipRecord relationship;
+    relationship.from = grandparent->id();
+    relationship.to = parent->id();
+    QVERIFY(scene->addRelationship(relationship));
+    relationship.from = parent->id();
+    relationship.to = child->id();
+    QVERIFY(scene->addRelationship(relationship));
+
+    // Check the links.
+    QCOMPARE(parent->getParents().size(), 1);
+    QCOMPARE(parent->getParents().first(), grandparent);
+    QCOMPARE(parent->getChildren().size(), 1);
+    QCOMPARE(parent->getChildren().first(), child);
+    QVERIFY(!grandparent->hasParent());
+
+    // Check the walks.
+    KinshipGraph graph;
+    QVector<DiagramItem *> found;
+    graph.descendants(grandparent, found);
+    QCOMPARE(found.size(), 3);
+    graph.ancestors(child, found);
+    QCOMPARE(found.size(), 3);
+    QVERIFY(graph.isAncestorOf(grandparent, child));
+    QVERIFY(!graph.isAncestorOf(child, grandparent));
+
+    // Removing the arrow should update the links.
+    Arrow *arrow = child->getArrows().first();
+    arrow->startItem()->removeArrow(arrow);
+    arrow->endItem()->removeArrow(arrow);
+    QVERIFY(parent->getChildren().isEmpty());
+    QVERIFY(!child->hasParent());
+    QVERIFY(!graph.isAncestorOf(grandparent, child));
+
+    // Adding it back, as undo does, should restore them.
+    arrow->startItem()->addArrow(arrow);
+    arrow->endItem()->addArrow(arrow);
+    QVERIFY(graph.isAncestorOf(grandparent, child));
+}
+
+void TestCases::layoutEngineTest()
+{
+    // Three generations, a link that skips one, and a two-person cycle.
+    LayoutGraph graph;
+    for (int i = 0; i < 6; ++i) {
+        LayoutGraph::Node node;
+        node.width = (i == 1) ? 400 : 200;
+        node.height = 50;
+        node.anchor = 100;
+        graph.nodes << node;
+    }
+    graph.edges << qMakePair(0, 1) << qMakePair(0, 2) << qMakePair(1, 3) << qMakePair(0, 3);
+    graph.edges << qMakePair(4, 5) << qMakePair(5, 4);
+
+    LayoutResult result = LayoutEngine::layout(graph);
+    QCOMPARE(result.positions.size(), 6);
+    QCOMPARE(result.cycleEdges, 1);
+
+    // Parents should be above their children.
+    QCOMPARE(result.layers[0], 0);
+    QCOMPARE(result.layers[1], 1);
+    QCOMPARE(result.layers[3], 2);
+    QVERIFY(result.positions[0].y() < result.positions[1].y());
+    QVERIFY(result.positions[1].y() < result.positions[3].y());
+    QCOMPARE(result.crossings, qint64(0));
+
+    // Boxes in the same row should not overlap.
+    for (int i = 0; i < 6; ++i) {
+        for (int j = i + 1; j < 6; ++j) {
+            if (result.layers[i] != result.layers[j]) {
+                continue;
+            }
+            qreal left1 = result.positions[i].x() - graph.nodes[i].anchor;
+            qreal left2 = result.positions[j].x() - graph.nodes[j].anchor;
+            QVERIFY(left1 + graph.nodes[i].width <= left2 || left2 + graph.nodes[j].width <= left1);
+        }
+    }
+
+    // The layout should not depend on the number of threads.
+    QThreadPool *pool = QThreadPool::globalInstance();
+    int maxThreadCount = pool->maxThreadCount();
+    pool->setMaxThreadCount(1);
+    LayoutResult again = LayoutEngine::layout(graph);
+    pool->setMaxThreadCount(maxThreadCount);
+    QCOMPARE(again.positions, result.positions);
+    QCOMPARE(again.crossings, result.crossings);
+}
+
+void TestCases::generationIndexTest()
+{
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(5000, 5000);
+
+    // Create a long line of descendants.
+    const int count = 2000;
+    QVector<DiagramItem *> line;
+    PersonRecord record;
+    RelationshipRecord relationship;
+
+    for (int i = 0; i < count; ++i) {
+        record.id = QUuid::createUuid();
+        line << scene->addPerson(record);
+        if (i > 0) {
+            relationship.from = line[i - 1]->id();
+            relationship.to = line[i]->id();
+            QVERIFY(scene->addRelationship(relationship));
+        }
+    }
+
+    // Check the numbers.
+    QCOMPARE(GenerationIndex::generation(line.last()), count - 1);
+    QCOMPARE(GenerationIndex::depth(line.first()), count - 1);
+    QCOMPARE(GenerationIndex::generation(line[10]), 10);
+    QVERIFY(!GenerationIndex::closesCycle(line.last()));
+
+    // Adding an ancestor should update the cached numbers.
+    record.id = QUuid::createUuid();
+    DiagramItem *ancestor = scene->addPerson(record);
+    relationship.from = ancestor->id();
+    relationship.to = line.first()->id();
+    QVERIFY(scene->addRelationship(relationship));
+    QCOMPARE(GenerationIndex::generation(line.last()), count);
+    QCOMPARE(GenerationIndex::depth(ancestor), count);
+
+    // A spouse shares the depth.
+    record.id = QUuid::createUuid();
+    DiagramItem *spouse = scene->addPerson(record);
+    scene->marry(line.first(), spouse, true);
+    QCOMPARE(GenerationIndex::depth(spouse), count - 1);
+
+    // A cycle should be reported rather than loop forever.
+    relationship.from = line.last()->id();
+    relationship.to = ancestor->id();
+    QVERIFY(scene->addRelationship(relationship));
+    GenerationIndex::generation(line.last());
+    GenerationIndex::depth(ancestor);
+    bool found = false;
+    for (DiagramItem *person: line) {
+        found = found || GenerationIndex::closesCycle(person);
+    }
+    QVERIFY(found || GenerationIndex::closesCycle(ancestor));
+    QVERIFY(scene->autoLayout() > 0);
+}
+
+void TestCases::autoLayoutFamilyTest()
+{
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(5000, 5000);
+
+    // Create a parent with two children, and a stranger.
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    DiagramItem *parent = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    DiagramItem *child1 = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    DiagramItem *child2 = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    DiagramItem *stranger = scene->addPerson(record);
+
+    parent->setPos(1000, 1000);
+    stranger->setPos(3000, 3000);
+
+    RelationshipRecord relationship;
+    relationship.from = parent->id();
+    relationship.to = child1->id();
+    QVERIFY(scene->addRelationship(relationship));
+    relationship.to = child2->id();
+    QVERIFY(scene->addRelationship(relationship));
+
+    // The family should include the siblings but not the stranger.
+    QList<DiagramItem *> family = scene->layoutFamily(QList<DiagramItem *>() << child2);
+    QCOMPARE(family.size(), 3);
+    QCOMPARE(family.first(), parent);
+    QVERIFY(!family.contains(stranger));
+
+    // Only the family should move, and the parent should keep their place.
+    scene->autoLayoutFamily(family);
+    QCOMPARE(parent->pos(), QPointF(1000, 1000));
+    QCOMPARE(stranger->pos(), QPointF(3000, 3000));
+    QVERIFY(child1->y() > parent->y());
+    QCOMPARE(child1->y(), child2->y());
+    QVERIFY(!child1->sceneBoundingRect().intersects(child2->sceneBoundingRect()));
+
+    // A family laid out over a row of strangers should move past all of them.
+    record.id = QUuid::createUuid();
+    DiagramItem *stranger2 = scene->addPerson(record);
+    stranger->setPos(parent->pos());
+    stranger2->setPos(parent->pos() + QPointF(stranger->sceneBoundingRect().width(), 0));
+    QVERIFY(scene->clearingShift(family) > 0);
+
+    scene->autoLayoutFamily(family);
+    for (DiagramItem *person: family) {
+        QVERIFY(!person->sceneBoundingRect().intersects(stranger->sceneBoundingRect()));
+        QVERIFY(!person->sceneBoundingRect().intersects(stranger2->sceneBoundingRect()));
+    }
+    QCOMPARE(scene->clearingShift(family), 0.0);
+}
+
+void TestCases::autoLayoutSupersedeTest()
+{
+    // Open test file.
+    openTestFile(getTestInputFilePathFor("smith-new.xml"));
+
+    QUndoStack *undoStack = m_mainWindow->findChild<QUndoStack*>();
+    QVERIFY(undoStack);
+    int count = undoStack->count();
+
+    // Ask twice. The second layout should replace the first.
+    QAction *action = m_mainWindow->findChild<QAction*>("actionAutoLayout");
+    QVERIFY(action);
+    action->trigger();
+    action->trigger();
+    m_mainWindow->waitForLayout();
+
+    QCOMPARE(undoStack->count(), count + 1);
+}
+
+void TestCases::nameIndexTest()
+{
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(5000, 5000);
+
+    // Create some persons.
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    record.name = QString::fromUtf8("\xc3\x89mile Zola");
+    DiagramItem *emile = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    record.name = "Emma Smith";
+    DiagramItem *emma = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    record.name = "John Smithson";
+    DiagramItem *john = scene->addPerson(record);
+
+    // Case and accents should be ignored.
+    NameIndex &index = scene->nameIndex();
+    QCOMPARE(index.size(), 3);
+    QCOMPARE(index.find("emi"), QVector<DiagramItem *>() << emile);
+    QCOMPARE(index.find("SMITH").size(), 2);
+    QCOMPARE(index.find("e").size(), 2);
+    QCOMPARE(index.find("mile zo"), QVector<DiagramItem *>() << emile);
+    QVERIFY(index.find("zol a").isEmpty());
+
+    // Renaming should update the index.
+    emma->setName("Emma Jones");
+    QCOMPARE(index.find("smith"), QVector<DiagramItem *>() << john);
+    QCOMPARE(index.find("jones"), QVector<DiagramItem *>() << emma);
+
+    // So should removing.
+    scene->removeItem(john);
+    QVERIFY(index.find("smith").isEmpty());
+    scene->addItem(john);
+    QCOMPARE(index.find("smith"), QVector<DiagramItem *>() << john);
+}
+
+void TestCases::phoneticTest()
+{
+    // Known codes.
+    QCOMPARE(Phonetic::soundex("Robert"), QString("R163"));
+    QCOMPARE(Phonetic::soundex("Ashcraft"), QString("A261"));
+    QCOMPARE(Phonetic::daitchMokotoff("Moskowitz"), QStringList() << "645740");
+    QCOMPARE(Phonetic::doubleMetaphone("Smith"), QStringList() << "SM0" << "XMT");
+    QCOMPARE(Phonetic::editDistance("kitten", "sitting"), 3);
+    QCOMPARE(Phonetic::letters(QString::fromUtf8("Zi\xc3\xabl")), QString("ZIEL"));
+
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(5000, 5000);
+
+    // Create some persons.
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    record.firstName = "Jan";
+    record.lastName = "Zijl";
+    record.name = "Jan Zijl";
+    DiagramItem *zijl = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    record.firstName = "Pieter";
+    record.lastName = "Zyl";
+    record.name = "Pieter Zyl";
+    DiagramItem *zyl = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    record.firstName.clear();
+    record.lastName.clear();
+    record.name = "Anna Ziel";
+    DiagramItem *ziel = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    record.name = "John Smith";
+    DiagramItem *smith = scene->addPerson(record);
+
+    // The spellings should sound alike, with the exact match first.
+    PhoneticIndex &index = scene->phoneticIndex();
+    QCOMPARE(index.size(), 4);
+    QVector<PhoneticIndex::Match> matches = index.find("Zyl");
+    QCOMPARE(matches.size(), 3);
+    QCOMPARE(matches.first().person, zyl);
+    QVERIFY(matches[1].score < matches[0].score);
+
+    // Spelling mistakes should be found too.
+    matches = index.find("Smiht");
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches.first().person, smith);
+
+    // Each word adds to the score.
+    matches = index.find("Jan Zyl");
+    QCOMPARE(matches.first().person, zijl);
+    QVERIFY(matches[1].score < matches[0].score);
+
+    // Renaming and removing should update the index.
+    smith->setLastName("Smyth");
+    smith->setFirstName("Jon");
+    QCOMPARE(index.find("Smith").first().person, smith);
+    scene->removeItem(ziel);
+    QCOMPARE(index.find("Zyl").size(), 2);
+}
+
+void TestCases::textIndexTest()
+{
+    // Read a bio from GEDCOM notes, including a NOTE record.
+    QByteArray gedcom =
+            "0 HEAD\n"
+            "0 @I1@ INDI\n"
+            "1 NAME John /Smith/\n"
+            "1 BIRT\n"
+            "2 PLAC New York\n"
+            "1 NOTE A farmer who moved\n"
+            "2 CONC  to Utrecht.\n"
+            "1 NOTE @N1@\n"
+            "0 @I2@ INDI\n"
+            "1 NAME Mary /Jones/\n"
+            "1 BIRT\n"
+            "2 PLAC York\n"
+            "1 NOTE Miller in Amsterdam, later a farmer.\n"
+            "0 @N1@ NOTE Sailed to\n"
+            "1 CONT New Amsterdam.\n"
+            "0 TRLR\n";
+    QBuffer buffer(&gedcom);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    GedcomImporter importer;
+    QVERIFY(importer.read(&buffer));
+    QCOMPARE(importer.persons()[0].bio, QString("A farmer who moved to Utrecht.\n\nSailed to\nNew Amsterdam."));
+
+    DiagramScene *scene = m_mainWindow->getScene();
+    importer.populate(scene);
+
+    TextIndex &index = scene->textIndex();
+    QCOMPARE(index.size(), 2);
+    DiagramItem *john = index.find("utrecht").first().person;
+    QCOMPARE(john->getFirstName(), QString("John"));
+
+    // Words, phrases and operators.
+    QCOMPARE(index.find("FARMER").size(), 2);
+    QCOMPARE(index.find("farmer -utrecht").size(), 1);
+    QCOMPARE(index.find("farmer NOT utrecht").first().person->getFirstName(), QString("Mary"));
+    QCOMPARE(index.find("\"new york\"").size(), 1);
+    QCOMPARE(index.find("york").size(), 2);
+    QCOMPARE(index.find("utrecht OR miller").size(), 2);
+    QVERIFY(index.find("\"amsterdam new\"").isEmpty());
+
+    // The snippet highlights the match.
+    TextIndex::Hit hit = index.find("utrecht").first();
+    QCOMPARE(hit.field, TextIndex::Bio);
+    QCOMPARE(hit.highlights.size(), 1);
+    QCOMPARE(hit.snippet.mid(hit.highlights.first().first, hit.highlights.first().second), QString("Utrecht"));
+
+    // Editing the details updates the index.
+    john->setBio("A baker.");
+    index.update(john);
+    QVERIFY(index.find("utrecht").isEmpty());
+    QCOMPARE(index.find("baker").first().person, john);
+
+    // So does removing.
+    scene->removeItem(john);
+    QVERIFY(index.find("baker").isEmpty());
+    scene->addItem(john);
+    QCOMPARE(index.find("baker").size(), 1);
+
+    // While loading, persons are indexed all at once at the end.
+    scene->beginLoad(5000, 5000);
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    record.bio = "A baker.";
+    scene->addPerson(record);
+    QCOMPARE(index.size(), 0);
+    scene->buildTextIndex();
+    QCOMPARE(index.size(), 1);
+
+    record.id = QUuid::createUuid();
+    scene->addPerson(record);
+    QCOMPARE(index.find("baker").size(), 2);
+}
+
+void TestCases::sceneStatisticsTest()
+{
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(5000, 5000);
+    QVERIFY(scene->isEmpty());
+    QVERIFY(!scene->firstItem());
+
+    // Add a couple and a child.
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    record.dateOfBirth = QDate(1850, 3, 1);
+    record.hasDateOfBirth = true;
+    DiagramItem *father = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    record.hasDateOfBirth = false;
+    record.photos << "photo.png";
+    DiagramItem *mother = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    record.photos.clear();
+    record.dateOfDeath = QDate(1950, 6, 2);
+    record.hasDateOfDeath = true;
+    DiagramItem *child = scene->addPerson(record);
+
+    RelationshipRecord relationship;
+    relationship.from = father->id();
+    relationship.to = child->id();
+    QVERIFY(scene->addRelationship(relationship));
+    relationship.from = mother->id();
+    QVERIFY(scene->addRelationship(relationship));
+    scene->marry(father, mother, true);
+
+    // Check the counts.
+    const SceneStatistics &statistics = scene->statistics();
+    QCOMPARE(scene->personCount(), 3);
+    QCOMPARE(scene->relationshipCount(), 2);
+    QCOMPARE(scene->marriageCount(), 1);
+    QCOMPARE(statistics.personsWithPhotosCount(), 1);
+    QCOMPARE(statistics.generationCount(), 2);
+    QCOMPARE(statistics.earliestDate(), QDate(1850, 3, 1));
+    QCOMPARE(statistics.latestDate(), QDate(1950, 6, 2));
+    QCOMPARE(scene->firstItem(), static_cast<QGraphicsItem *>(father));
+
+    // Editing details should update them.
+    child->setDateOfDeath(DiagramItem::defaultDateOfDeath());
+    QCOMPARE(statistics.latestDate(), QDate(1850, 3, 1));
+    child->setPhotos(QStringList() << "photo.png");
+    QCOMPARE(statistics.personsWithPhotosCount(), 2);
+
+    // So should removing and adding back.
+    scene->removeMarriage(father, mother);
+    QCOMPARE(scene->marriageCount(), 0);
+    scene->removeItem(father);
+    QCOMPARE(scene->personCount(), 2);
+    QCOMPARE(scene->firstItem(), static_cast<QGraphicsItem *>(mother));
+    QVERIFY(!statistics.earliestDate().isValid());
+    scene->addItem(father);
+    QCOMPARE(scene->personCount(), 3);
+    QCOMPARE(statistics.earliestDate(), QDate(1850, 3, 1));
+}
+
+void TestCases::itemRegistryTest()
+{
+    // Removing should keep the order of the others.
+    QGraphicsRectItem values[5];
+    ItemRegistry<QGraphicsRectItem> registry;
+    for (int i = 0; i < 4; ++i) {
+        registry.insert(&values[i]);
+    }
+    registry.insert(&values[0]);
+    QCOMPARE(registry.size(), 4);
+
+    registry.remove(&values[1]);
+    QCOMPARE(registry.size(), 3);
+    QVERIFY(!registry.contains(&values[1]));
+    QCOMPARE(registry.items(), QVector<QGraphicsRectItem *>() << &values[0] << &values[2] << &values[3]);
+
+    // An item added again, as by undo, should go back to its place.
+    registry.insert(&values[1]);
+    QCOMPARE(registry.items(), QVector<QGraphicsRectItem *>() << &values[0] << &values[1] << &values[2] << &values[3]);
+
+    // So should several, added back in any order, while a new item goes last.
+    registry.remove(&values[0]);
+    registry.remove(&values[2]);
+    registry.insert(&values[4]);
+    registry.insert(&values[2]);
+    registry.insert(&values[0]);
+    QCOMPARE(registry.items(), QVector<QGraphicsRectItem *>() << &values[0] << &values[1] << &values[2] << &values[3] << &values[4]);
+
+    // Removing twice should do no harm.
+    registry.remove(&values[3]);
+    registry.remove(&values[3]);
+    registry.remove(&values[0]);
+    QCOMPARE(registry.size(), 3);
+    QCOMPARE(registry.items(), QVector<QGraphicsRectItem *>() << &values[1] << &values[2] << &values[4]);
+
+    // The place is kept by the item, so one made at the address of a deleted
+    // item goes last.
+    registry.remove(&values[1]);
+    values[1].setData(ItemRegistry<QGraphicsRectItem>::SequenceKey, QVariant());
+    registry.insert(&values[1]);
+    QCOMPARE(registry.items(), QVector<QGraphicsRectItem *>() << &values[2] << &values[4] << &values[1]);
+
+    // Check the lists of the scene.
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(5000, 5000);
+    QVERIFY(scene->persons().isEmpty());
+
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    DiagramItem *father = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    DiagramItem *mother = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    DiagramItem *child = scene->addPerson(record);
+
+    RelationshipRecord relationship;
+    relationship.from = father->id();
+    relationship.to = child->id();
+    QVERIFY(scene->addRelationship(relationship));
+    scene->marry(father, mother, true);
+
+    QCOMPARE(scene->persons().size(), 3);
+    QVERIFY(scene->persons().contains(child));
+    QCOMPARE(scene->arrows().size(), 1);
+    QCOMPARE(scene->arrows().first()->endItem(), child);
+    QCOMPARE(scene->marriages().size(), 1);
+
+    // Removing a person should leave the others listed.
+    scene->removeItem(father);
+    QCOMPARE(scene->persons().size(), 2);
+    QVERIFY(!scene->persons().contains(father));
+    QVERIFY(scene->persons().contains(mother));
+    QVERIFY(scene->persons().contains(child));
+
+    // Adding it back, as undo does, should keep the saved order.
+    scene->addItem(father);
+    QCOMPARE(scene->persons(), QVector<DiagramItem *>() << father << mother << child);
+
+    scene->removeMarriage(father, mother);
+    QCOMPARE(scene->persons().size(), 3);
+    QVERIFY(scene->marriages().isEmpty());
+}
+
+void TestCases::itemHashTest()
+{
+    QVector<DiagramItem *> persons;
+    QVector<QUuid> ids;
+    ItemHash hash;
+
+    for (int i = 0; i < 1000; ++i) {
+        persons << new DiagramItem(DiagramItem::Person, nullptr);
+        ids << QUuid::createUuid();
+        hash.insert(ids[i], persons[i]);
+    }
+    QCOMPARE(hash.size(), 1000);
+
+    // Remove every other id. The rest should still be found.
+    for (int i = 0; i < ids.size(); i += 2) {
+        hash.remove(ids[i]);
+    }
+    QCOMPARE(hash.size(), 500);
+    for (int i = 0; i < ids.size(); ++i) {
+        QCOMPARE(hash.value(ids[i]), (i % 2 == 0) ? nullptr : persons[i]);
+    }
+
+    // Looking up a missing id should not add it.
+    QVERIFY(!hash.value(QUuid::createUuid()));
+    QCOMPARE(hash.size(), 500);
+
+    // Short and long GEDCOM pointers.
+    ItemHash pointers;
+    QString longPointer = "@INDIVIDUAL123456789@";
+    pointers.insert(QString("@I1@"), persons[0]);
+    pointers.insert(QString("@I10@"), persons[1]);
+    pointers.insert(longPointer, persons[2]);
+    QCOMPARE(pointers.value(QString("@I1@")), persons[0]);
+    QCOMPARE(pointers.value(QString("@I10@")), persons[1]);
+    QCOMPARE(pointers.value(longPointer), persons[2]);
+    QVERIFY(!pointers.value(QString("@I100@")));
+    QCOMPARE(pointers.size(), 3);
+
+    qDeleteAll(persons);
+}
+
+void TestCases::arrowGeometryTest()
+{
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(5000, 5000);
+
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    record.pos = QPointF(500, 100);
+    DiagramItem *parent = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    record.pos = QPointF(500, 400);
+    DiagramItem *child = scene->addPerson(record);
+
+    RelationshipRecord relationship;
+    relationship.from = parent->id();
+    relationship.to = child->id();
+    QVERIFY(scene->addRelationship(relationship));
+    Arrow *arrow = scene->arrows().first();
+
+    // The line should run from the top of the child to the parent.
+    qreal top = child->pos().y() + child->polygon().boundingRect().top();
+    QCOMPARE(arrow->line().p1(), QPointF(500, top));
+    QCOMPARE(arrow->line().p2(), parent->pos());
+    QVERIFY(arrow->shape().contains(QPointF(500, 250)));
+
+    // Moving a person should move the arrow without painting.
+    child->setPos(800, 400);
+    QCOMPARE(arrow->line().p2(), parent->pos());
+    QVERIFY(!arrow->shape().contains(QPointF(500, 250)));
+    QVERIFY(child->sceneBoundingRect().contains(arrow->line().p1()));
+
+    // Overlapping persons have no arrow to click.
+    child->setPos(parent->pos());
+    QVERIFY(arrow->shape().isEmpty());
+}
+
+void TestCases::edgeLayerTest()
+{
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(5000, 5000);
+    scene->setBatchArrows(true);
+    QVERIFY(scene->edgeLayer());
+
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    record.pos = QPointF(500, 100);
+    DiagramItem *parent = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    record.pos = QPointF(500, 1400);
+    DiagramItem *child = scene->addPerson(record);
+
+    RelationshipRecord relationship;
+    relationship.from = parent->id();
+    relationship.to = child->id();
+    QVERIFY(scene->addRelationship(relationship));
+
+    // The arrow should be drawn by the layer, and found there.
+    EdgeLayer *layer = scene->edgeLayer();
+    Arrow *arrow = scene->arrows().first();
+    QCOMPARE(layer->arrowCount(), 1);
+    QVERIFY(!arrow->isVisible());
+    QCOMPARE(layer->arrowAt(QPointF(500, 800)), arrow);
+    QVERIFY(!layer->arrowAt(QPointF(900, 800)));
+
+    // Moving a person should move it in the grid.
+    child->setPos(2500, 1400);
+    QVERIFY(!layer->arrowAt(QPointF(500, 800)));
+    QCOMPARE(layer->arrowAt(QPointF(1500, 750)), arrow);
+
+    // A clicked arrow is shown until deselected.
+    layer->showArrow(arrow);
+    arrow->setSelected(true);
+    QVERIFY(arrow->isVisible());
+    scene->clearSelection();
+    QVERIFY(!arrow->isVisible());
+
+    // Select All and area selection should include the arrows in the layer.
+    scene->selectAll();
+    QVERIFY(arrow->isSelected());
+    scene->clearSelection();
+    QVERIFY(!arrow->isVisible());
+
+    QPainterPath area;
+    area.addRect(QRectF(1400, 700, 200, 100));
+    scene->showArrowsIn(area);
+    scene->setSelectionArea(area);
+    QVERIFY(arrow->isSelected());
+    QVERIFY(!parent->isSelected());
+    scene->clearSelection();
+    QVERIFY(!arrow->isVisible());
+
+    // Loading keeps the layer, but empties it.
+    scene->beginLoad(5000, 5000);
+    QCOMPARE(scene->edgeLayer(), layer);
+    QCOMPARE(layer->arrowCount(), 0);
+
+    scene->setBatchArrows(false);
+    QVERIFY(!scene->edgeLayer());
+}
+
+void TestCases::levelOfDetailTest()
+{
+    QImage image(1000, 1000, QImage::Format_ARGB32);
+    QPainter painter(&image);
+    QStyleOptionGraphicsItem option;
+
+    painter.scale(0.2, 0.2);
+    QCOMPARE(DiagramItem::detail(&option, &painter), DiagramItem::LowDetail);
+    painter.resetTransform();
+    painter.scale(0.5, 0.5);
+    QCOMPARE(DiagramItem::detail(&option, &painter), DiagramItem::MediumDetail);
+    painter.resetTransform();
+    QCOMPARE(DiagramItem::detail(&option, &painter), DiagramItem::FullDetail);
+    painter.end();
+
+    // Draw a married couple at each level.
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(1000, 1000);
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    record.lastName = "Smith";
+    record.name = "John Smith";
+    DiagramItem *husband = scene->addPerson(record);
+    record.id = QUuid::createUuid();
+    record.name = "Mary Smith";
+    record.pos = QPointF(600, 0);
+    DiagramItem *wife = scene->addPerson(record);
+    scene->marry(husband, wife, true);
+
+    husband->setBrush(Qt::red);
+
+    // Draw at a scale, and find the dark text pixels inside the husband's box,
+    // leaving out its border.
+    int textLeft;
+    int textRight;
+    auto countTextPixels = [&](qreal scale) {
+        image.fill(Qt::white);
+        QPainter scenePainter(&image);
+        scene->render(&scenePainter, QRectF(0, 0, 1000 * scale, 1000 * scale), QRectF(-500, -500, 1000, 1000));
+        scenePainter.end();
+
+        QRectF box = husband->sceneBoundingRect().translated(500, 500);
+        QRect inside = QRectF(box.topLeft() * scale, box.bottomRight() * scale).toAlignedRect().adjusted(2, 2, -2, -2);
+
+        int count = 0;
+        textLeft = image.width();
+        textRight = -1;
+        for (int y = inside.top(); y <= inside.bottom(); ++y) {
+            for (int x = inside.left(); x <= inside.right(); ++x) {
+                QRgb pixel = image.pixel(x, y);
+                if (qRed(pixel) < 128 && qGreen(pixel) < 128 && qBlue(pixel) < 128) {
+                    ++count;
+                    textLeft = qMin(textLeft, x);
+                    textRight = qMax(textRight, x);
+                }
+            }
+        }
+        return count;
+    };
+
+    // The full name is drawn at full detail.
+    QVERIFY(countTextPixels(1.0) > 0);
+    int fullWidth = textRight - textLeft;
+
+    // Only the surname is drawn at medium detail, so the text is narrower than
+    // half the full name.
+    QVERIFY(countTextPixels(0.5) > 0);
+    int mediumWidth = textRight - textLeft;
+    QVERIFY(mediumWidth * 2 < fullWidth * 0.8);
+
+    // Zoomed far out, the person should be a plain box, without text.
+    QCOMPARE(countTextPixels(0.1), 0);
+    QCOMPARE(image.pixel(48, 50), QColor(Qt::red).rgb());
+}
+
+void TestCases::nameEditorTest()
+{
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(1000, 1000);
+
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    record.name = "Jan Smit";
+    DiagramItem *person = scene->addPerson(record);
+
+    auto editorCount = [person]() {
+        int count = 0;
+        for (auto child: person->childItems()) {
+            if (child->type() == DiagramTextItem::Type) {
+                ++count;
+            }
+        }
+        return count;
+    };
+
+    // The name is drawn by the person, without an editor.
+    QCOMPARE(editorCount(), 0);
+    QVERIFY(!person->isEditingName());
+    QVERIFY(person->nameRect().width() > 0);
+    QVERIFY(person->boundingRect().contains(person->nameRect()));
+
+    // An editor is made to change the name, and let go afterwards.
+    person->editName();
+    QVERIFY(person->isEditingName());
+    QCOMPARE(editorCount(), 1);
+
+    DiagramTextItem *editor = nullptr;
+    for (auto child: person->childItems()) {
+        editor = qgraphicsitem_cast<DiagramTextItem *>(child);
+        if (editor) {
+            break;
+        }
+    }
+    QVERIFY(editor);
+    QCOMPARE(editor->text(), QString("Jan Smit"));
+
+    editor->setPlainText("Piet Smit");
+    person->onTextEdited();
+    QVERIFY(!person->isEditingName());
+    QCOMPARE(person->name(), QString("Piet Smit"));
+    QCOMPARE(person->getFirstName(), QString("Piet"));
+
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    QCOMPARE(editorCount(), 0);
+}
+
+void TestCases::renderCacheTest()
+{
+    DiagramScene *scene = m_mainWindow->getScene();
+    scene->beginLoad(1000, 1000);
+
+    PersonRecord record;
+    record.id = QUuid::createUuid();
+    record.name = "Jan Smit";
+    DiagramItem *person = scene->addPerson(record);
+    person->setBrush(Qt::green);
+
+    RenderCache::setEnabled(true);
+    RenderCache::clear();
+    RenderCache::resetStatistics();
+
+    QImage image(400, 400, QImage::Format_ARGB32);
+    QRectF source = person->sceneBoundingRect().adjusted(-10, -10, 10, 10);
+    auto render = [&]() {
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        scene->render(&painter, QRectF(0, 0, source.width(), source.height()), source);
+    };
+
+    // The first drawing makes the picture, and the second copies it.
+    render();
+    QCOMPARE(RenderCache::missCount(), 1);
+    QCOMPARE(RenderCache::pictureCount(), 1);
+    QVERIFY(RenderCache::memoryUsed() > 0);
+    render();
+    QCOMPARE(RenderCache::hitCount(), 1);
+    QCOMPARE(RenderCache::hitRate(), 0.5);
+
+    // The copy looks like the person.
+    QPoint corner = (person->sceneBoundingRect().topLeft() - source.topLeft()).toPoint() + QPoint(5, 5);
+    QCOMPARE(image.pixel(corner), QColor(Qt::green).rgb());
+
+    // A change of color or selection needs a new picture.
+    person->setBrush(Qt::yellow);
+    render();
+    QCOMPARE(RenderCache::missCount(), 2);
+    QCOMPARE(image.pixel(corner), QColor(Qt::yellow).rgb());
+
+    person->setSelected(true);
+    render();
+    QCOMPARE(RenderCache::missCount(), 3);
+
+    // A high resolution screen needs a sharper picture.
+    int memoryUsed = RenderCache::memoryUsed();
+    image.setDevicePixelRatio(2);
+    render();
+    QCOMPARE(RenderCache::missCount(), 4);
+    QVERIFY(RenderCache::memoryUsed() > memoryUsed);
+    image.setDevicePixelRatio(1);
+
+    // Nothing is kept while the cache is off.
+    RenderCache::setEnabled(false);
+    QCOMPARE(RenderCache::pictureCount(), 0);
+    render();
+    QCOMPARE(RenderCache::missCount(), 4);
+    QCOMPARE(image.pixel(corner), QColor(Qt::yellow).rgb());
+
+    RenderCache::setEnabled(true);
+}
+
+void TestCases::saveDuringEditTest()
+{
+    saveTestFileAs("save-during-edit-test.xml");
+
+    QUndoStack *undoStack = m_mainWindow->findChild<QUndoStack*>();
+    QVERIFY(undoStack);
+    undoStack->push(new QUndoCommand("first edit"));
+
+    // Undo and make a new edit while the save runs. The undo index is the
+    // same as when the save started, but the diagram is not.
+    QAction *action = m_mainWindow->findChild<QAction*>("saveAction");
+    QVERIFY(action);
+    action->trigger();
+    undoStack->undo();
+    undoStack->push(new QUndoCommand("second edit"));
+    m_mainWindow->waitForSave();
+
+    QVERIFY(!undoStack->isClean());
+
+    // A save with no edits during it marks the diagram clean.
+    action->trigger();
+    m_mainWindow->waitForSave();
+    QVERIFY(undoStack->isClean());
+}
+
+void TestCases::autoLayoutUndoTest()
+{
+    // Open test file.
+    openTestFile(getTestInputFilePathFor("smith-new.xml"));
+
+    DiagramScene *scene = m_mainWindow->getScene();
+    QHash<DiagramItem *, QPointF> before;
+    for (DiagramItem *person: scene->persons()) {
+        before.insert(person, person->pos());
+    }
+
+    auto anyMoved = [&]() {
+        for (auto it = before.constBegin(); it != before.constEnd(); ++it) {
+            if (it.key()->pos() != it.value()) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    QUndoStack *undoStack = m_mainWindow->findChild<QUndoStack*>();
+    QVERIFY(undoStack);
+    int count = undoStack->count();
+
+    // Undo while the persons are moving. The layout should be finished and
+    // added to the undo stack first, so that undo takes it back.
+    QAction *action = m_mainWindow->findChild<QAction*>("actionAutoLayout");
+    QVERIFY(action);
+    action->trigger();
+    QTRY_VERIFY(anyMoved());
+
+    action = m_mainWindow->findChild<QAction*>("undoAction");
+    QVERIFY(action);
+    action->trigger();
+
+    QCOMPARE(undoStack->count(), count + 1);
+    QCOMPARE(undoStack->index(), count);
+    QVERIFY(!anyMoved());
+}
+
 void TestCases::addPhotoToSelectedPerson()
 {
     auto helper = new DetailsWindowHelper();
@@ -0,0 +1,473 @@
+#include "textindex.h"
+#include "diagramitem.h"
+#include "nameindex.h"
+
+#include <QSet>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <iterator>
+
+// The number of characters to show before and after the first match.
+static const int snippetBefore = 40;
+static const int snippetAfter = 80;
+
+TextIndex::TextIndex()
+{
+
+}
+
+void TextIndex::update(DiagramItem *person)
+{
+    Document document = readDocument(person);
+
+    // Check if already listed.
+    auto existing = m_documentOf.constFind(person);
+    if (existing != m_documentOf.constEnd()) {
+        if (m_documents[existing.value()].texts == document.texts) {
+            return;
+        }
+        remove(person);
+    }
+
+    addDocument(document);
+}
+
+void TextIndex::remove(DiagramItem *person)
+{
+    int number = m_documentOf.value(person, -1);
+    if (number == -1) {
+        return;
+    }
+
+    Document &document = m_documents[number];
+
+    for (const QString &term: document.terms) {
+        auto found = m_postings.find(term);
+        if (found == m_postings.end()) {
+            continue;
+        }
+
+        QVector<int> &list = found.value();
+        auto position = std::lower_bound(list.begin(), list.end(), number);
+        if (position != list.end() && *position == number) {
+            list.erase(position);
+        }
+        if (list.isEmpty()) {
+            m_postings.erase(found);
+        }
+    }
+
+    document = Document();
+    document.person = nullptr;
+    m_documentOf.remove(person);
+    m_freeDocuments << number;
+}
+
+void TextIndex::clear()
+{
+    m_documents.clear();
+    m_freeDocuments.clear();
+    m_documentOf.clear();
+    m_postings.clear();
+}
+
+void TextIndex::build(const QList<DiagramItem *> &persons)
+{
+    clear();
+
+    // Splitting the text into words takes the most time, so do it in parallel.
+    QVector<Document> documents = QtConcurrent::blockingMapped<QVector<Document> >(persons, &TextIndex::readDocument);
+
+    // The documents are added in order, so each list stays sorted.
+    m_documents.reserve(documents.size());
+    for (const Document &document: documents) {
+        addDocument(document);
+    }
+}
+
+QVector<TextIndex::Hit> TextIndex::find(const QString &query, int maxResults) const
+{
+    QVector<Hit> result;
+    QVector<Clause> clauses = parse(query);
+
+    // Match each choice and combine them.
+    QVector<int> matches;
+    QStringList positiveTerms;
+    QVector<int> combined;
+
+    for (const Clause &clause: clauses) {
+        combined.clear();
+        QVector<int> clauseMatches = match(clause);
+        std::set_union(matches.constBegin(), matches.constEnd(),
+                       clauseMatches.constBegin(), clauseMatches.constEnd(),
+                       std::back_inserter(combined));
+        matches.swap(combined);
+
+        for (const QStringList &phrase: clause.required) {
+            positiveTerms += phrase;
+        }
+    }
+
+    // Rank by the number of matching words.
+    QSet<QString> positiveSet = QSet<QString>::fromList(positiveTerms);
+    QVector<QPair<int, int> > ranked;
+    ranked.reserve(matches.size());
+
+    for (int number: matches) {
+        int score = 0;
+        for (const Token &token: m_documents[number].tokens) {
+            if (positiveSet.contains(token.term)) {
+                ++score;
+            }
+        }
+        ranked << qMakePair(-score, number);
+    }
+
+    int count = qMin(maxResults, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end());
+
+    result.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        result << hit(m_documents[ranked[i].second], positiveTerms);
+    }
+
+    return result;
+}
+
+int TextIndex::size() const
+{
+    return m_documentOf.size();
+}
+
+///
+/// \brief TextIndex::readDocument Read and split the searched details of a person.
+/// Only reads the person, so it is safe to call on several threads at once.
+///
+TextIndex::Document TextIndex::readDocument(DiagramItem *person)
+{
+    Document document;
+    document.person = person;
+    document.texts << person->bio()
+                   << person->getPlaceOfBirth()
+                   << person->getCountryOfBirth()
+                   << person->getPlaceOfDeath();
+
+    for (int field = 0; field < FieldCount; ++field) {
+        tokenize(document.texts[field], Field(field), document.tokens);
+    }
+
+    for (const Token &token: document.tokens) {
+        document.terms << token.term;
+    }
+    document.terms.sort();
+    document.terms.removeDuplicates();
+
+    return document;
+}
+
+void TextIndex::tokenize(const QString &text, Field field, QVector<Token> &tokens)
+{
+    int i = 0;
+    while (i < text.size()) {
+        // Skip to the next word.
+        if (!text[i].isLetterOrNumber()) {
+            ++i;
+            continue;
+        }
+
+        int start = i;
+        while (i < text.size() && (text[i].isLetterOrNumber() || text[i].isMark())) {
+            ++i;
+        }
+
+        Token token;
+        token.term = NameIndex::fold(text.mid(start, i - start));
+        token.field = field;
+        token.start = start;
+        token.length = i - start;
+        tokens << token;
+    }
+}
+
+///
+/// \brief TextIndex::queryTerms Get the folded words of some query text.
+///
+QStringList TextIndex::queryTerms(const QString &text)
+{
+    QVector<Token> tokens;
+    tokenize(text, Bio, tokens);
+
+    QStringList terms;
+    for (const Token &token: tokens) {
+        terms << token.term;
+    }
+    return terms;
+}
+
+QVector<TextIndex::Clause> TextIndex::parse(const QString &query)
+{
+    QVector<Clause> clauses(1);
+    bool negateNext = false;
+    int i = 0;
+
+    while (i < query.size()) {
+        if (query[i].isSpace()) {
+            ++i;
+            continue;
+        }
+
+        // Read a phrase in quotes, or a single word.
+        bool negate = negateNext;
+        negateNext = false;
+        QString text;
+
+        if (query[i] == '-' && i + 1 < query.size() && !query[i + 1].isSpace()) {
+            negate = true;
+            ++i;
+        }
+
+        if (query[i] == '"') {
+            int end = query.indexOf('"', i + 1);
+            if (end == -1) {
+                end = query.size();
+            }
+            text = query.mid(i + 1, end - i - 1);
+            i = end + 1;
+        }
+        else {
+            int start = i;
+            while (i < query.size() && !query[i].isSpace()) {
+                ++i;
+            }
+            text = query.mid(start, i - start);
+
+            // Operators.
+            if (text == QLatin1String("OR")) {
+                if (!clauses.last().required.isEmpty() || !clauses.last().excluded.isEmpty()) {
+                    clauses.append(Clause());
+                }
+                continue;
+            }
+            if (text == QLatin1String("AND")) {
+                continue;
+            }
+            if (text == QLatin1String("NOT")) {
+                negateNext = true;
+                continue;
+            }
+        }
+
+        // A word with punctuation, e.g. "Saint-Louis", is a phrase.
+        QStringList terms = queryTerms(text);
+        if (terms.isEmpty()) {
+            continue;
+        }
+
+        if (negate) {
+            clauses.last().excluded << terms;
+        }
+        else {
+            clauses.last().required << terms;
+        }
+    }
+
+    // Drop a choice left empty, e.g. by a trailing "OR".
+    if (clauses.last().required.isEmpty() && clauses.last().excluded.isEmpty()) {
+        clauses.removeLast();
+    }
+
+    return clauses;
+}
+
+///
+/// \brief TextIndex::contains Check if the words of a phrase follow each other
+/// in one field of a document.
+///
+bool TextIndex::contains(const Document &document, const QStringList &phrase)
+{
+    // A single word is in the sorted list.
+    if (phrase.size() == 1) {
+        return std::binary_search(document.terms.constBegin(), document.terms.constEnd(), phrase.first());
+    }
+
+    const QVector<Token> &tokens = document.tokens;
+    for (int i = 0; i + phrase.size() <= tokens.size(); ++i) {
+        bool found = true;
+        for (int j = 0; j < phrase.size() && found; ++j) {
+            found = tokens[i + j].term == phrase[j] && tokens[i + j].field == tokens[i].field;
+        }
+        if (found) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TextIndex::addDocument(const Document &document)
+{
+    // Reuse a free number if possible.
+    int number;
+    if (!m_freeDocuments.isEmpty()) {
+        number = m_freeDocuments.takeLast();
+        m_documents[number] = document;
+    }
+    else {
+        number = m_documents.size();
+        m_documents << document;
+    }
+
+    m_documentOf.insert(document.person, number);
+
+    for (const QString &term: document.terms) {
+        QVector<int> &list = m_postings[term];
+        if (list.isEmpty() || list.last() < number) {
+            list << number;
+        }
+        else {
+            list.insert(std::lower_bound(list.begin(), list.end(), number), number);
+        }
+    }
+}
+
+///
+/// \brief TextIndex::documentsWithAll Get the documents that contain all the words,
+/// intersecting the shortest lists first.
+///
+QVector<int> TextIndex::documentsWithAll(const QStringList &terms) const
+{
+    QVector<const QVector<int> *> lists;
+    for (const QString &term: terms) {
+        auto found = m_postings.constFind(term);
+        if (found == m_postings.constEnd()) {
+            return QVector<int>();
+        }
+        lists << &found.value();
+    }
+
+    std::sort(lists.begin(), lists.end(), [](const QVector<int> *a, const QVector<int> *b) {
+        return a->size() < b->size();
+    });
+
+    QVector<int> result = *lists.first();
+    QVector<int> common;
+    for (int i = 1; i < lists.size() && !result.isEmpty(); ++i) {
+        common.clear();
+        std::set_intersection(result.constBegin(), result.constEnd(),
+                              lists[i]->constBegin(), lists[i]->constEnd(),
+                              std::back_inserter(common));
+        result.swap(common);
+    }
+
+    return result;
+}
+
+///
+/// \brief TextIndex::match Get the documents that match one choice of a query, in order.
+///
+QVector<int> TextIndex::match(const Clause &clause) const
+{
+    QVector<int> candidates;
+
+    if (clause.required.isEmpty()) {
+        // Only excluded words, so start with everyone.
+        for (int number = 0; number < m_documents.size(); ++number) {
+            if (m_documents[number].person) {
+                candidates << number;
+            }
+        }
+    }
+    else {
+        QStringList allTerms;
+        for (const QStringList &phrase: clause.required) {
+            allTerms += phrase;
+        }
+        allTerms.removeDuplicates();
+        candidates = documentsWithAll(allTerms);
+    }
+
+    // Check the phrases and excluded words of the few documents left.
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [this, &clause](int number) {
+        const Document &document = m_documents[number];
+        for (const QStringList &phrase: clause.required) {
+            if (phrase.size() > 1 && !contains(document, phrase)) {
+                return true;
+            }
+        }
+        for (const QStringList &phrase: clause.excluded) {
+            if (contains(document, phrase)) {
+                return true;
+            }
+        }
+        return false;
+    }), candidates.end());
+
+    return candidates;
+}
+
+///
+/// \brief TextIndex::hit Make the hit for a document, showing the text around the first match.
+///
+TextIndex::Hit TextIndex::hit(const Document &document, const QStringList &terms)
+{
+    Hit result;
+    result.person = document.person;
+    result.field = Bio;
+
+    // Find the first matching word.
+    const Token *first = nullptr;
+    for (const Token &token: document.tokens) {
+        if (terms.contains(token.term)) {
+            first = &token;
+            break;
+        }
+    }
+
+    if (!first) {
+        // Only excluded words were searched for, so show the start of the first field with text.
+        for (int field = 0; field < FieldCount && result.snippet.isEmpty(); ++field) {
+            result.field = Field(field);
+            result.snippet = document.texts[field].left(snippetAfter).simplified();
+        }
+        return result;
+    }
+
+    // Take the text around it, without cutting words.
+    result.field = first->field;
+    const QString &text = document.texts[first->field];
+
+    int start = qMax(0, first->start - snippetBefore);
+    while (start > 0 && start < first->start && !text[start - 1].isSpace()) {
+        ++start;
+    }
+
+    int end = qMin(text.size(), first->start + first->length + snippetAfter);
+    while (end < text.size() && end > first->start + first->length && !text[end].isSpace()) {
+        --end;
+    }
+
+    QString prefix = (start > 0) ? QString(QChar(0x2026)) : QString();
+    result.snippet = prefix + text.mid(start, end - start);
+    if (end < text.size()) {
+        result.snippet += QChar(0x2026);
+    }
+
+    // Keep the snippet on one line. Each line break is replaced by a space,
+    // so the matches stay in place.
+    for (QChar &c: result.snippet) {
+        if (c == '\n' || c == '\r' || c == '\t') {
+            c = ' ';
+        }
+    }
+
+    // Mark each matching word in the snippet.
+    for (const Token &token: document.tokens) {
+        if (token.field == first->field && token.start >= start && token.start + token.length <= end
+                && terms.contains(token.term)) {
+            result.highlights << qMakePair(token.start - start + prefix.size(), token.length);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,131 @@
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class DiagramItem;
+
+/**
+ * @brief The TextIndex class searches the biographies and places of persons.
+ *
+ * Each word of the text is folded to lower case without accents, and listed
+ * with the persons that use it. A search reads the lists of its words, so it
+ * does not have to read every biography.
+ *
+ * Queries are made of words, which must all be found, e.g. <tt>farmer utrecht</tt>.
+ * Words in quotes must be found together, e.g. <tt>"new york"</tt>. A word or
+ * phrase after "NOT" or "-" must not be found, and "OR" gives a choice, e.g.
+ * <tt>farmer OR miller -amsterdam</tt>. "AND" binds tighter than "OR".
+ */
+class TextIndex
+{
+public:
+    /**
+     * @brief The Field enum lists the searched details of a person.
+     */
+    enum Field
+    {
+        Bio,
+        PlaceOfBirth,
+        CountryOfBirth,
+        PlaceOfDeath,
+        FieldCount
+    };
+
+    /**
+     * @brief The Hit struct is a person found by a search, with part of the
+     * matching text to show.
+     */
+    struct Hit
+    {
+        DiagramItem *person;
+        Field field; ///< The field of the snippet.
+        QString snippet; ///< The text around the first match, on one line.
+        QVector<QPair<int, int> > highlights; ///< The start and length of each match in the snippet.
+    };
+
+    TextIndex();
+
+    /**
+     * @brief update Add a person, or read their details again if they changed.
+     * @param person The person.
+     */
+    void update(DiagramItem *person);
+
+    /**
+     * @brief remove Remove a person.
+     * @param person The person.
+     */
+    void remove(DiagramItem *person);
+
+    /**
+     * @brief clear Remove all persons.
+     */
+    void clear();
+
+    /**
+     * @brief build Replace the index with the given persons.
+     * The text of each person is split into words on several threads.
+     * @param persons The persons.
+     */
+    void build(const QList<DiagramItem *> &persons);
+
+    /**
+     * @brief find Find the persons matching a query.
+     * @param query The query.
+     * @param maxResults The most hits to return.
+     * @return The hits, with the most matches first.
+     */
+    QVector<Hit> find(const QString &query, int maxResults = 100) const;
+
+    /**
+     * @brief size Get the number of persons in the index.
+     */
+    int size() const;
+
+private:
+    struct Token
+    {
+        QString term;
+        Field field;
+        int start;
+        int length;
+    };
+
+    struct Document
+    {
+        DiagramItem *person;
+        QStringList texts; ///< The text of each field.
+        QVector<Token> tokens; ///< The words of all fields, in order.
+        QStringList terms; ///< Each word once, sorted.
+    };
+
+    /// Phrases that must and must not be found. Each phrase is a list of words.
+    struct Clause
+    {
+        QVector<QStringList> required;
+        QVector<QStringList> excluded;
+    };
+
+    static Document readDocument(DiagramItem *person);
+    static void tokenize(const QString &text, Field field, QVector<Token> &tokens);
+    static QStringList queryTerms(const QString &text);
+    static QVector<Clause> parse(const QString &query);
+    static bool contains(const Document &document, const QStringList &phrase);
+    void addDocument(const Document &document);
+    QVector<int> documentsWithAll(const QStringList &terms) const;
+    QVector<int> match(const Clause &clause) const;
+    static Hit hit(const Document &document, const QStringList &terms);
+
+    QVector<Document> m_documents;
+    QVector<int> m_freeDocuments;
+    QHash<DiagramItem *, int> m_documentOf;
+    QHash<QString, QVector<int> > m_postings; ///< Sorted document numbers for each word.
+};
+
+#endif // TEXTINDEX_H
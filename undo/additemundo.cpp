@@ -29,3 +29,8 @@ void AddItemUndo::redo()
         m_undone = false;
     }
 }
+
+QStringList AddItemUndo::photos() const
+{
+    return m_item->photos();
+}
@@ -1,6 +1,7 @@
 #ifndef ADDITEMUNDO_H
 #define ADDITEMUNDO_H
 
+#include <QStringList>
 #include <QUndoCommand>
 
 class DiagramItem;
@@ -14,6 +15,9 @@ public:
     void undo() override;
     void redo() override;
 
+    /// The photos of the added person.
+    QStringList photos() const;
+
 private:
     DiagramScene *m_scene;
     DiagramItem *m_item;
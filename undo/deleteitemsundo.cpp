@@ -52,3 +52,14 @@ void DeleteItemsUndo::redo()
         m_undone = false;
     }
 }
+
+QStringList DeleteItemsUndo::photos() const
+{
+    QStringList result;
+    for (auto item: m_items) {
+        if (item->type() == DiagramItem::Type) {
+            result << qgraphicsitem_cast<DiagramItem *> (item)->photos();
+        }
+    }
+    return result;
+}
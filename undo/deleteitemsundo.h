@@ -2,6 +2,7 @@
 #define UNDODELETEITEMS_H
 
 #include <QList>
+#include <QStringList>
 #include <QUndoCommand>
 
 class QGraphicsItem;
@@ -15,6 +16,9 @@ public:
     void undo() override;
     void redo() override;
 
+    /// The photos of the deleted persons.
+    QStringList photos() const;
+
 private:
     DiagramScene *m_scene;
     QList<QGraphicsItem *> m_items;
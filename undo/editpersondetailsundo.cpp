@@ -52,6 +52,7 @@ void EditPersonDetailsUndo::undo()
         m_item->setGender(m_originalGender);
         m_item->setBio(m_originalBio);
         m_item->setPhotos(m_originalPhotos);
+        updateTextIndex();
 
         m_undone = true;
     }
@@ -72,7 +73,21 @@ void EditPersonDetailsUndo::redo()
         m_item->setGender(m_newGender);
         m_item->setBio(m_newBio);
         m_item->setPhotos(m_newPhotos);
+        updateTextIndex();
 
         m_undone = false;
     }
 }
+
+void EditPersonDetailsUndo::updateTextIndex()
+{
+    auto scene = dynamic_cast<DiagramScene *>(m_item->scene());
+    if (scene) {
+        scene->textIndex().update(m_item);
+    }
+}
+
+QStringList EditPersonDetailsUndo::photos() const
+{
+    return m_originalPhotos + m_newPhotos;
+}
@@ -2,6 +2,7 @@
 #define EDITPERSONDETAILSUNDO_H
 
 #include <QDate>
+#include <QStringList>
 #include <QUndoCommand>
 
 class DiagramItem;
@@ -16,7 +17,12 @@ public:
     void undo() override;
     void redo() override;
 
+    /// The photos before and after the edit.
+    QStringList photos() const;
+
 private:
+    void updateTextIndex();
+
     DiagramItem *m_item;
 
     QString m_originalName;
@@ -31,7 +31,7 @@ void MoveItemsUndo::setMoveView(bool moveView)
 
 void MoveItemsUndo::moveViewsIfRequired()
 {
-    if (m_moveView) {
+    if (m_moveView && !m_scene->isEmpty()) {
         for (auto view: m_scene->views()) {
             view->centerOn(m_scene->firstItem());
         }
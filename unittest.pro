@@ -1,4 +1,4 @@
-QT += help printsupport widgets xml
+QT += concurrent help printsupport widgets xml
 QT += testlib
 
 HEADERS	    =   \
@@ -37,7 +37,26 @@ HEADERS	    =   \
     undo/undoblock.h \
     undo/changebordercolorundo.h \
     undo/changediagramsizeundo.h \
-    gui/helpwindow.h
+    gui/helpwindow.h \
+    diagramrecords.h \
+    gedcomimporter.h \
+    gedcomexporter.h \
+    diagramreader.h \
+    diagramwriter.h \
+    diagrambinary.h \
+    photostore.h \
+    kinshipgraph.h \
+    layoutengine.h \
+    generationindex.h \
+    nameindex.h \
+    phonetic.h \
+    phoneticindex.h \
+    textindex.h \
+    scenestatistics.h \
+    itemregistry.h \
+    itemhash.h \
+    edgelayer.h \
+    rendercache.h
 SOURCES	    =   \
 		diagramitem.cpp \
 		testcases.cpp \
@@ -75,7 +94,25 @@ SOURCES	    =   \
     undo/undoblock.cpp \
     undo/changebordercolorundo.cpp \
     undo/changediagramsizeundo.cpp \
-    gui/helpwindow.cpp
+    gui/helpwindow.cpp \
+    diagramrecords.cpp \
+    gedcomimporter.cpp \
+    gedcomexporter.cpp \
+    diagramreader.cpp \
+    diagramwriter.cpp \
+    diagrambinary.cpp \
+    photostore.cpp \
+    kinshipgraph.cpp \
+    layoutengine.cpp \
+    generationindex.cpp \
+    nameindex.cpp \
+    phonetic.cpp \
+    phoneticindex.cpp \
+    textindex.cpp \
+    scenestatistics.cpp \
+    itemhash.cpp \
+    edgelayer.cpp \
+    rendercache.cpp
 RESOURCES   =	genealogymaker.qrc
 
 FORMS += \